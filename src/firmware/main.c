@@ -19,6 +19,7 @@
 #include "sys/dvi_audio.h"
 #include "sys/edid.h"
 #include "sys/lfs.h"
+#include "sys/pcm.h"
 #include "sys/rev.h"
 #include "sys/sys.h"
 #include "sys/tst.h"
@@ -41,6 +42,9 @@
 #include "vic/mem.h"
 #include "vic/pen.h"
 #include "vic/pot.h"
+#include "vic/heat.h"
+#include "vic/reg_ring.h"
+#include "vic/trace.h"
 #include "vic/vic.h"
 #include "vic/cvbs.h"
 #endif
@@ -93,6 +97,9 @@ static void task(void)
     vic_task();
     cvbs_task();
     mem_task();
+    trace_task();
+    heat_task();
+    reg_ring_task();
     aud_task();
     pot_task();
     edid_task();
@@ -102,6 +109,7 @@ static void task(void)
     aud_task();
 #endif 
     dvi_audio_task();
+    pcm_task();
     //vga_task();
     //term_task();
     tud_task();
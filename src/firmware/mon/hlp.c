@@ -21,7 +21,8 @@ static const char __in_flash("helptext") hlp_text_help[] =
     "BINARY addr len crc - Write memory. Binary data follows.\n"
     "0000 (00 00 ...)    - Read or write memory.\n"
     "MODELINE ()()()..   - Test alternative DVI modes.\n"
-    "TEST                - Test input pins on device";
+    "TEST                - Test input pins on device\n"
+    "PCM (STREAM)        - Send the sound output to the host as PCM.";
 
 static const char __in_flash("helptext") hlp_text_set[] =
     "Settings:\n"
@@ -32,8 +33,12 @@ static const char __in_flash("helptext") hlp_text_set[] =
     "SET SPLASH (0|1|2)  - Query or set  splash screen disable or enable and w/sound.\n"
     "SET DVI (0|1|2|..)  - Query or set display type for DVI output.\n"
     "SET AUDIO (0|1)     - Query or set DVI audio disable or enable.\n"
+    "SET RING (0|1)      - Query or set DVI scan out from a full frame or a line ring.\n"
+    "SET LOCK (0|1)      - Query or set DVI frame timing locked to the emulation.\n"
+    "SET CHAIN (0|1)     - Query or set DVI scan out by IRQ per line or DMA blocks.\n"
 #ifdef PIVIC
     "SET BIAS (n)        - Adjust the DC bias on the analogue audio.\n"
+    "SET SYNTH (0|1)     - Query or set VIC voice synthesis, hard or band limited.\n"
 #endif
     "SET MODE (0|1|2|..) - Query or set main operational mode.\n"
     "SET DEFAULTS 1      - Set all parameters to default value."
@@ -169,6 +174,16 @@ static const char __in_flash("helptext") hlp_text_test[] =
     "toggle the input. Use care and only use safe probes and only on input\n"
     "pins marked with arrow pointing in to the middle of the board figure (> <).";
 
+static const char __in_flash("helptext") hlp_text_pcm[] =
+    "PCM streams the sound output over USB as 16 bit samples at the DVI\n"
+    "audio sample rate, for recordings and for comparing firmware builds.\n"
+    "Save the console output to a file and convert it to WAV with the\n"
+    "pcmwav host tool. Samples lost when the host is not keeping up are\n"
+    "counted and padded with silence in the WAV. Other USB console output\n"
+    "is muted while streaming.\n"
+    "  PCM                      - show last stream statistics\n"
+    "  PCM STREAM               - send samples until any key is received\n";
+
 static const char __in_flash("helptext") hlp_text_splash[] =
     "SET SPLASH enables or disables splash screen shown before the computer\n"
     "clears the screen memory at boot\n"
@@ -187,6 +202,39 @@ static const char __in_flash("helptext") hlp_text_dvi_audio[] =
     " 0 - disable DVI audio\n"
     " 1 - enable DVI audio";
 
+static const char __in_flash("helptext") hlp_text_dvi_ring[] =
+    "SET RING selects where DVI scan out reads the picture from.\n"
+    "With the ring the emulation writes into a few dozen lines and the\n"
+    "DVI frame timing is pulled in so scan out trails the beam by a fixed\n"
+    "number of lines. Less than a frame of display latency, for light pens\n"
+    "and paddles. Needs a DVI mode close to the emulated frame rate.\n"
+    "The framebuffer is sized at boot, so this takes effect at reboot.\n"
+    " 0 - full framebuffer (default)\n"
+    " 1 - scanline ring";
+
+static const char __in_flash("helptext") hlp_text_dvi_lock[] =
+    "SET LOCK locks the DVI frame timing to the emulated frames.\n"
+    "Free running, the DVI refresh drifts against the emulation, which\n"
+    "shows as tearing or a frame shown twice now and then. Locked, the\n"
+    "vertical back porch is stretched or shortened a few lines at a time\n"
+    "to keep scan out just behind the emulated beam. Needs a DVI mode\n"
+    "close to the emulated frame rate, some monitors may not accept it.\n"
+    "STATUS shows the phase error and tear counts. Always on with SET RING.\n"
+    "The framebuffer is sized at boot, so this takes effect at reboot.\n"
+    " 0 - free running (default)\n"
+    " 1 - locked";
+
+static const char __in_flash("helptext") hlp_text_dvi_chain[] =
+    "SET CHAIN selects how the DVI DMA is kept fed.\n"
+    "Per scanline, an IRQ sets up every line, twice for picture lines.\n"
+    "Chained, a list of DMA blocks for the whole frame is built once and\n"
+    "a second DMA channel loads them, leaving a few IRQs a frame for\n"
+    "expanding lines ahead and the frame lock. STATUS shows the IRQ rate\n"
+    "and load. Only without DVI audio, its data islands need the IRQs.\n"
+    "Takes effect at reboot.\n"
+    " 0 - IRQ per scanline (default)\n"
+    " 1 - chained DMA blocks";
+
 static const char __in_flash("helptext") hlp_text_mode[] =
 #ifdef PIVIC
     "SET MODE selects the type of VIC emulation\n"
@@ -218,6 +266,14 @@ static const char __in_flash("helptext") hlp_text_bias[] =
     "Audio will drop out if too low and clip if too high\n"
     "Default is 80. 64 can work for many. 128 is 50% bias\n";
 
+static const char __in_flash("helptext") hlp_text_synth[] =
+    "SET SYNTH selects how the VIC voices are turned into audio samples.\n"
+    "The square waves have edges at CPU clock resolution, which alias\n"
+    "into audible tones when sampled at 48 kHz for DVI audio.\n"
+    " 0 - Hard edges, the voices as they are at each sample (default)\n"
+    " 1 - Band limited, each edge placed at its CPU cycle with a BLEP.\n"
+    "     Less aliasing on high notes, one sample more latency.\n";
+
 static const char __in_flash("helptext") hlp_text_colour[] =
     "COLOUR|COLOR selects a single palette entry\n"
     "for tuning with the TUNE command. Use 0-15\n"
@@ -252,6 +308,44 @@ static const char __in_flash("helptext") hlp_text_save[] =
     "SAVE a named palette for the current mode\n"
     "and make it the default palette for this mode.\n"
     "Palettes are unique per mode\n";
+
+static const char __in_flash("helptext") hlp_text_profile[] =
+    "PROFILE shows how many sys clocks the VIC loop spends per F1\n"
+    "cycle, by horizontal counter value and by fetch state.\n"
+    "Columns are count, min, max and average clocks, cycles that\n"
+    "missed the next F1 edge, and a histogram in 32 clock bins.\n"
+    "Only available in builds configured with -DPIVIC_PROFILE=ON\n"
+    "  PROFILE reset - clear the collected statistics\n";
+
+static const char __in_flash("helptext") hlp_text_trace[] =
+    "TRACE captures every CPU bus access into a ring in XRAM and streams\n"
+    "the accesses over USB in a compact binary format. Decode the stream\n"
+    "with the victrace host tool. While tracing, VIC fetches from unconnected\n"
+    "memory see a stale data value.\n"
+    "  TRACE                    - show settings and last stream statistics\n"
+    "  TRACE ON|OFF             - start or stop capturing\n"
+    "  TRACE STREAM             - send binary trace until any key is received\n"
+    "  TRACE READS|WRITES|ALL   - filter on access type\n"
+    "  TRACE (lo) (hi)          - add an address range, up to 4, e.g. $1000 $100F\n"
+    "  TRACE CLEAR              - remove all address ranges\n";
+
+static const char __in_flash("helptext") hlp_text_heat[] =
+    "HEAT counts CPU bus accesses from the trace capture: reads and writes\n"
+    "per 1K page, and VIC register writes per register and raster line.\n"
+    "Shows which expansion areas and screen locations a program uses. Like\n"
+    "TRACE, VIC fetches from unconnected memory see a stale value while on.\n"
+    "  HEAT                     - show the counters\n"
+    "  HEAT ON|OFF              - start or stop counting\n"
+    "  HEAT RESET               - clear the counters\n";
+
+static const char __in_flash("helptext") hlp_text_reglog[] =
+    "REGLOG lists the latest changes to the VIC registers with the raster\n"
+    "line (VC) and cycle in the line (HC) they took effect at. Changes are\n"
+    "seen once per CPU cycle, so two writes to a register in back to back\n"
+    "cycles both show, but a write of the value already there does not.\n"
+    "The raster, light pen and paddle registers are left out.\n"
+    "  REGLOG                   - show the last 64 changes\n"
+    "  REGLOG RESET             - clear the log and change counters\n";
 #endif
 
 
@@ -274,12 +368,17 @@ static struct
     {6, "binary", hlp_text_binary},
     {8, "modeline", hlp_text_modeline},
     {4, "test", hlp_text_test},
+    {3, "pcm", hlp_text_pcm},
 #ifdef PIVIC
     {6, "colour", hlp_text_colour},
     {5, "color", hlp_text_colour},
     {4, "tune", hlp_text_tune},
     {4, "load", hlp_text_load},
     {4, "save", hlp_text_save},
+    {7, "profile", hlp_text_profile},
+    {5, "trace", hlp_text_trace},
+    {4, "heat", hlp_text_heat},
+    {6, "reglog", hlp_text_reglog},
 #endif
 };
 static const size_t COMMANDS_COUNT = sizeof COMMANDS / sizeof *COMMANDS;
@@ -297,10 +396,14 @@ static struct
     {6, "splash", hlp_text_splash},
     {3, "dvi", hlp_text_dvi},
     {5, "audio", hlp_text_dvi_audio},
+    {4, "ring", hlp_text_dvi_ring},
+    {4, "lock", hlp_text_dvi_lock},
+    {5, "chain", hlp_text_dvi_chain},
     {4, "mode", hlp_text_mode},
     {8, "defaults", hlp_text_defaults},
 #ifdef PIVIC
     {4, "bias", hlp_text_bias},
+    {5, "synth", hlp_text_synth},
 #endif
 };
 static const size_t SETTINGS_COUNT = sizeof SETTINGS / sizeof *SETTINGS;
@@ -13,10 +13,15 @@
 #include "sys/com.h"
 #include "sys/dvi.h"
 #include "sys/mem.h"
+#include "sys/pcm.h"
 #include "sys/sys.h"
 #include "sys/tst.h"
 #include "sys/vga.h"
 #include "vic/cvbs.h"
+#include "vic/heat.h"
+#include "vic/reg_ring.h"
+#include "vic/prof.h"
+#include "vic/trace.h"
 #include "pico/stdlib.h"
 #include <stdio.h>
 
@@ -40,12 +45,17 @@ static struct
     {6, "binary", ram_mon_binary},
     {8, "modeline", dvi_mon_modeline},
     {4, "test", tst_mon_test},
+    {3, "pcm", pcm_mon_pcm},
 #ifdef PIVIC
     {4, "tune", cvbs_mon_tune},
     {6, "colour", cvbs_mon_colour},
     {5, "color", cvbs_mon_colour},
     {4, "save", cvbs_mon_save},
     {4, "load", cvbs_mon_load},
+    {7, "profile", prof_mon_profile},
+    {5, "trace", trace_mon_trace},
+    {4, "heat", heat_mon_heat},
+    {6, "reglog", reg_ring_mon_reglog},
 #endif
 };
 static const size_t COMMANDS_COUNT = sizeof COMMANDS / sizeof *COMMANDS;
@@ -126,8 +136,13 @@ static void mon_enter(bool timeout, const char *buf, size_t length)
 // Anything that suspends the monitor.
 static bool mon_suspended(void)
 {
+#ifdef PIVIC
+    if (trace_active())
+        return true;
+#endif
     return //main_active() ||
-           ram_active()// ||
+           ram_active() ||
+           pcm_active()// ||
            //vga_active() ||
            //std_active()
            ;
@@ -10,6 +10,9 @@
 //#include "sys/pix.h"
 //#include "sys/ria.h"
 #include "sys/mem.h"
+#ifdef PIVIC
+#include "vic/reg_ring.h"
+#endif
 #include <stdio.h>
 
 #define TIMEOUT_MS 200
@@ -87,6 +90,9 @@ void ram_mon_address(const char *args, size_t len)
     {
         xram[rw_addr + i] = mbuf[i];
     }
+#ifdef PIVIC
+    reg_ring_wrote(rw_addr, mbuf_len);
+#endif
     return;
 }
 
@@ -103,6 +109,9 @@ static void sys_com_rx_mbuf(bool timeout, const char *buf, size_t length)
 
     for (size_t i = 0; i < rw_len; i++)
         xram[rw_addr + i] = buf[i];
+#ifdef PIVIC
+    reg_ring_wrote(rw_addr, rw_len);
+#endif
 }
 
 void ram_mon_binary(const char *args, size_t len)
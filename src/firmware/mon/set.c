@@ -191,6 +191,72 @@ static void set_dvi_audio(const char *args, size_t len)
     set_print_dvi_audio();
 }
 
+static void set_print_dvi_ring(void)
+{
+    uint8_t enable = cfg_get_dvi_ring();
+    printf("RING  : %s\n", enable ? "1 - scanline ring" : "0 - full framebuffer");
+}
+
+static void set_dvi_ring(const char *args, size_t len)
+{
+    uint32_t val;
+    if (len)
+    {
+        if (!parse_uint32(&args, &len, &val) ||
+            !parse_end(args, len) ||
+            !cfg_set_dvi_ring(val))
+        {
+            printf("?invalid argument\n");
+            return;
+        }
+    }
+    set_print_dvi_ring();
+}
+
+static void set_print_dvi_lock(void)
+{
+    uint8_t enable = cfg_get_dvi_lock();
+    printf("LOCK  : %s\n", enable ? "1 - locked to the emulation" : "0 - free running");
+}
+
+static void set_dvi_lock(const char *args, size_t len)
+{
+    uint32_t val;
+    if (len)
+    {
+        if (!parse_uint32(&args, &len, &val) ||
+            !parse_end(args, len) ||
+            !cfg_set_dvi_lock(val))
+        {
+            printf("?invalid argument\n");
+            return;
+        }
+    }
+    set_print_dvi_lock();
+}
+
+static void set_print_dvi_chain(void)
+{
+    uint8_t enable = cfg_get_dvi_chain();
+    printf("CHAIN : %s\n", enable ? "1 - chained DMA blocks" : "0 - IRQ per scanline");
+}
+
+static void set_dvi_chain(const char *args, size_t len)
+{
+    uint32_t val;
+    if (len)
+    {
+        if (!parse_uint32(&args, &len, &val) ||
+            !parse_end(args, len) ||
+            !cfg_set_dvi_chain(val))
+        {
+            printf("?invalid argument\n");
+            return;
+        }
+    }
+    set_print_dvi_chain();
+}
+
 static void set_print_mode()
 {
     const char *const mode_labels[] = {
@@ -285,6 +351,33 @@ static void set_bias(const char *args, size_t len)
     set_print_bias();
 }
 
+#ifdef PIVIC
+static void set_print_synth(void)
+{
+    const char *const synth_labels[] = {
+        "0 - Hard edges",
+        "1 - Band limited (BLEP)",
+    };
+    printf("SYNTH : %s\n", synth_labels[cfg_get_synth()]);
+}
+
+static void set_synth(const char *args, size_t len)
+{
+    uint32_t val;
+    if (len)
+    {
+        if (!parse_uint32(&args, &len, &val) ||
+            !parse_end(args, len) ||
+            !cfg_set_synth(val))
+        {
+            printf("?invalid argument\n");
+            return;
+        }
+    }
+    set_print_synth();
+}
+#endif
+
 static void set_defaults(const char *args, size_t len)
 {
     uint32_t val;
@@ -311,9 +404,15 @@ static struct
     {6, "splash", set_splash},
     {3, "dvi", set_dvi},
     {5, "audio", set_dvi_audio},
+    {4, "ring", set_dvi_ring},
+    {4, "lock", set_dvi_lock},
+    {5, "chain", set_dvi_chain},
     {4, "mode", set_mode},
     {4, "volt", set_volt},
     {4, "bias", set_bias},
+#ifdef PIVIC
+    {5, "synth", set_synth},
+#endif
     {8, "defaults", set_defaults}
 };
 static const size_t SETTERS_COUNT = sizeof SETTERS / sizeof *SETTERS;
@@ -326,9 +425,15 @@ static void set_print_all(void)
     set_print_splash();
     set_print_dvi();
     set_print_dvi_audio();
+    set_print_dvi_ring();
+    set_print_dvi_lock();
+    set_print_dvi_chain();
     set_print_mode();
     set_print_volt();
     set_print_bias();
+#ifdef PIVIC
+    set_print_synth();
+#endif
 }
 
 void set_mon_set(const char *args, size_t len)
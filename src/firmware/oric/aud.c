@@ -10,7 +10,9 @@
 #include "sys/dvi_audio.h"
 #include "sys/mem.h"
 #include "pico/stdlib.h"
+#include "hardware/clocks.h"
 #include "hardware/gpio.h"
+#include "hardware/structs/m33.h"
 #include <string.h>
 #include <stdio.h>
 
@@ -19,32 +21,176 @@
 //Assuming only the non-handshake ORA version is used for AY access. Could be wrong
 #define VIA_ORA xram[0x030F]
 
+#define AUD_PSG_CLOCK 1000000   //PHI2, one aud_tick per cycle
+
+//AY register writes from core1, stamped with the PHI2 cycle they were seen in.
+//Ring size must be power of 2
+#define AUD_AY_RING_LEN_BITS 6
+#define AUD_AY_RING_LEN (1<<AUD_AY_RING_LEN_BITS)
+
+typedef struct {
+    uint32_t cycle;
+    uint8_t reg;
+    uint8_t value;
+} aud_ay_write_t;
+
+static aud_ay_write_t aud_ay_ring[AUD_AY_RING_LEN];
+static volatile uint32_t aud_ay_head;   //Written by core1
+static volatile uint32_t aud_ay_tail;   //Written by core0
+static volatile uint32_t aud_cycle;     //PHI2 cycles seen by core1
+static uint32_t aud_ay_lost;
+
+//Samples rendered by aud_task in blocks, played out one by one by the fs callback.
+//Ring size must be power of 2
+#define AUD_BUF_LEN_BITS 8
+#define AUD_BUF_LEN (1<<AUD_BUF_LEN_BITS)
+#define AUD_BLOCK 32
+#define AUD_PRIME (2*AUD_BLOCK)         //Fill before playing, covers aud_task latency
+
+static int16_t aud_buf[AUD_BUF_LEN];
+static volatile uint32_t aud_buf_head;  //Written by aud_task
+static volatile uint32_t aud_buf_tail;  //Written by the fs callback
+static bool aud_buf_primed;
+static int16_t aud_last_sample;
+
+//Render clock, the PHI2 cycle of the next sample in 16.16
+static uint32_t aud_render_cycle;
+static uint32_t aud_render_frac;
+static uint32_t aud_render_step;
+static uint32_t aud_render_step_nom;    //PHI2 cycles per sample at DVI_AUDIO_FS
+
+//The fs timer and PHI2 don't run at exactly DVI_AUDIO_FS samples per 1 MHz, so
+//a PI loop on the buffer level steers the render step. Gains are shifts on the
+//level error in samples, sampled once per block. The step stays within
+//AUD_STEER_MAX of nominal, underruns and skips are left for the last resort.
+#define AUD_STEER_KP_SHIFT 6
+#define AUD_STEER_KI_SHIFT 5
+#define AUD_STEER_MAX_SHIFT 7           //1/128 of the nominal step
+static int32_t aud_steer_integral;
+
+//Statistics since the last status
+static uint32_t aud_underruns;
+static uint32_t aud_skips;              //Render clock jumps after aud_task fell behind
+static uint64_t aud_irq_clocks;         //sys clocks in the fs callback
+static uint64_t aud_render_clocks;      //sys clocks rendering in aud_task
+static uint32_t aud_render_samples;
+static uint32_t aud_stats_us;
+
 //Static allocation instead of using PSG_new
 PSG psg;
 volatile audio_sample_t psg_sample;
 
 void aud_update(){
-    int16_t sample = PSG_calc(&psg);
-    psg_sample.left = psg_sample.right = sample;
+    uint32_t start = m33_hw->dwt_cyccnt;
+    uint32_t tail = aud_buf_tail;
+    uint32_t level = aud_buf_head - tail;
+    if(!aud_buf_primed && level >= AUD_PRIME)
+        aud_buf_primed = true;
+    if(aud_buf_primed){
+        if(level){
+            aud_last_sample = aud_buf[tail & (AUD_BUF_LEN-1)];
+            aud_buf_tail = tail + 1;
+        }else{
+            aud_underruns++;
+            aud_buf_primed = false;
+        }
+    }
+    psg_sample.left = psg_sample.right = aud_last_sample;
+    aud_irq_clocks += m33_hw->dwt_cyccnt - start;
 }
 
 void aud_init(void){
-    PSG_setClock(&psg, 1000000);
+    PSG_setClock(&psg, AUD_PSG_CLOCK);
     PSG_setClockDivider(&psg, 0);
     PSG_setRate(&psg, DVI_AUDIO_FS);
     PSG_setVolumeMode(&psg, 2); // AY style
     PSG_setQuality(&psg, 1);
     PSG_setMask(&psg, 0x00);
     PSG_reset(&psg);
+    aud_render_step_nom = ((uint64_t)AUD_PSG_CLOCK << 16) / DVI_AUDIO_FS;
+    aud_render_step = aud_render_step_nom;
+    aud_steer_integral = 0;
+    aud_render_cycle = aud_cycle;
+    aud_render_frac = 0;
+    //DWT cycle counter for the IRQ and render cost, it is per core
+    m33_hw->demcr |= M33_DEMCR_TRCENA_BITS;
+    m33_hw->dwt_ctrl |= M33_DWT_CTRL_CYCCNTENA_BITS;
+    aud_stats_us = time_us_32();
     dvi_audio_set_sample_source(&psg_sample);
     dvi_audio_set_fs_cb(&aud_update);
 }
 
+static void aud_render_block(void){
+    uint32_t start = m33_hw->dwt_cyccnt;
+    uint32_t head = aud_buf_head;
+    uint32_t ay_head = aud_ay_head;
+    uint32_t ay_tail = aud_ay_tail;
+    __compiler_memory_barrier();
+    for(int i = 0; i < AUD_BLOCK; i++){
+        //Apply the writes from before this sample
+        while(ay_tail != ay_head && (int32_t)(aud_ay_ring[ay_tail & (AUD_AY_RING_LEN-1)].cycle - aud_render_cycle) <= 0){
+            aud_ay_write_t *w = &aud_ay_ring[ay_tail & (AUD_AY_RING_LEN-1)];
+            PSG_writeReg(&psg, w->reg, w->value);
+            ay_tail++;
+        }
+        aud_buf[head++ & (AUD_BUF_LEN-1)] = PSG_calc(&psg);
+        aud_render_frac += aud_render_step;
+        aud_render_cycle += aud_render_frac >> 16;
+        aud_render_frac &= 0xFFFF;
+    }
+    __compiler_memory_barrier();
+    aud_ay_tail = ay_tail;
+    aud_buf_head = head;
+    aud_render_clocks += m33_hw->dwt_cyccnt - start;
+    aud_render_samples += AUD_BLOCK;
+}
+
+//Level is sampled before each block, while the fs callback is playing
+static void aud_steer(uint32_t level){
+    if(!aud_buf_primed)
+        return;
+    //More samples than AUD_PRIME waiting means fs is slower than the render
+    //clock, so each sample covers more PHI2 cycles
+    int32_t err = (int32_t)level - AUD_PRIME;
+    int32_t max = aud_render_step_nom >> AUD_STEER_MAX_SHIFT;
+    aud_steer_integral += err;
+    if(aud_steer_integral > (max << AUD_STEER_KI_SHIFT))
+        aud_steer_integral = max << AUD_STEER_KI_SHIFT;
+    if(aud_steer_integral < -(max << AUD_STEER_KI_SHIFT))
+        aud_steer_integral = -(max << AUD_STEER_KI_SHIFT);
+    int32_t adj = err * (1 << AUD_STEER_KP_SHIFT) + (aud_steer_integral >> AUD_STEER_KI_SHIFT);
+    if(adj > max)
+        adj = max;
+    if(adj < -max)
+        adj = -max;
+    aud_render_step = aud_render_step_nom + adj;
+}
+
+//Render whole blocks once core1 has passed their end, so every register write
+//they cover is already in the ring
 void aud_task(void){
+    uint32_t block_cycles = ((AUD_BLOCK * aud_render_step) >> 16) + 1;
+    while(AUD_BUF_LEN - (aud_buf_head - aud_buf_tail) >= AUD_BLOCK){
+        int32_t lag = aud_cycle - aud_render_cycle;
+        if(lag < (int32_t)block_cycles)
+            break;
+        if(lag > (int32_t)(AUD_BUF_LEN * aud_render_step >> 16)){
+            //Too far behind to catch up without overrunning the playback, restart
+            //one block behind core1. Older writes are applied at the first sample.
+            aud_render_cycle = aud_cycle - block_cycles;
+            aud_skips++;
+        }
+        aud_steer(aud_buf_head - aud_buf_tail);
+        aud_render_block();
+    }
 }
 
 void aud_tick(void){
     static uint32_t ay_addr;
+    static bool ay_writing;
+    static uint8_t ay_value;
+    uint32_t cycle = aud_cycle + 1;
+    aud_cycle = cycle;
     //CA2 -> BC1
     //CB2 -> BDIR
     //VIA CA2/CB2: C = 0, E = 1
@@ -54,10 +200,47 @@ void aud_tick(void){
         ay_addr = VIA_ORA & VIA_DRA;
     }
     if((pcr & 0xEE) == 0xEC){
-        PSG_writeReg(&psg, ay_addr, VIA_ORA & VIA_DRA);
+        //Queue once per write strobe, or again if the data changes while it is held
+        uint8_t value = VIA_ORA & VIA_DRA;
+        if(!ay_writing || value != ay_value){
+            uint32_t head = aud_ay_head;
+            if(head - aud_ay_tail < AUD_AY_RING_LEN){
+                aud_ay_write_t *w = &aud_ay_ring[head & (AUD_AY_RING_LEN-1)];
+                w->cycle = cycle;
+                w->reg = ay_addr;
+                w->value = value;
+                __compiler_memory_barrier();
+                aud_ay_head = head + 1;
+            }else{
+                aud_ay_lost++;
+            }
+            ay_value = value;
+        }
+        ay_writing = true;
+    }else{
+        ay_writing = false;
     }
 }
 
 void aud_print_status(void){
-
-}
\ No newline at end of file
+    uint32_t now = time_us_32();
+    uint32_t us = now - aud_stats_us;
+    //Render time is what the fs IRQ spent when it ran PSG_calc per sample
+    uint32_t sys_mhz = clock_get_hz(clk_sys) / 1000000;
+    printf("Aud buf:%lu/%d primed:%d underruns:%lu skips:%lu ay lost:%lu\n",
+           aud_buf_head - aud_buf_tail, AUD_BUF_LEN, aud_buf_primed, aud_underruns, aud_skips, aud_ay_lost);
+    printf("    render step:%ld ppm\n",
+           (int32_t)((int64_t)((int32_t)aud_render_step - (int32_t)aud_render_step_nom) * 1000000 / aud_render_step_nom));
+    if(us){
+        printf("    fs irq:%lu us/s render:%lu us/s (%lu sys clocks/sample)\n",
+               (uint32_t)(aud_irq_clocks * 1000000 / sys_mhz / us),
+               (uint32_t)(aud_render_clocks * 1000000 / sys_mhz / us),
+               aud_render_samples ? (uint32_t)(aud_render_clocks / aud_render_samples) : 0);
+    }
+    aud_stats_us = now;                 //Clear for next status
+    aud_irq_clocks = 0;
+    aud_render_clocks = 0;
+    aud_render_samples = 0;
+    aud_underruns = 0;
+    aud_skips = 0;
+}
@@ -103,20 +103,28 @@ const uint8_t ula_rgb332_palette[8] = {
 };
 
 
-void inline __attribute__((always_inline)) ula_dvi_fb_update(uint8_t ink, uint8_t paper, uint8_t data, uint8_t fb_x, uint8_t fb_y){
+void inline __attribute__((always_inline)) ula_dvi_fb_update(uint8_t ink, uint8_t paper, uint8_t data, uint8_t fb_x, uint16_t fb_y){
     if(data & ULA_INVERT){
         ink ^= 0x7;
         paper ^= 0x7;
     }
+    volatile uint8_t *line = dvi_fb_line(fb_y);
+    if(dvi_fb_packed){
+        //Oric colour is the palette index, the 6 pixels fill 3 bytes
+        line += fb_x >> 1;
+        line[0] = (data & 0x20 ? ink : paper) | (data & 0x10 ? ink : paper) << 4;
+        line[1] = (data & 0x08 ? ink : paper) | (data & 0x04 ? ink : paper) << 4;
+        line[2] = (data & 0x02 ? ink : paper) | (data & 0x01 ? ink : paper) << 4;
+        return;
+    }
     uint8_t dvi_ink = ula_rgb332_palette[ink];
     uint8_t dvi_paper = ula_rgb332_palette[paper];
-    fb_y += 10;
-    dvi_framebuf[fb_y][fb_x++] = data & 0x20 ? dvi_ink : dvi_paper; 
-    dvi_framebuf[fb_y][fb_x++] = data & 0x10 ? dvi_ink : dvi_paper; 
-    dvi_framebuf[fb_y][fb_x++] = data & 0x08 ? dvi_ink : dvi_paper; 
-    dvi_framebuf[fb_y][fb_x++] = data & 0x04 ? dvi_ink : dvi_paper; 
-    dvi_framebuf[fb_y][fb_x++] = data & 0x02 ? dvi_ink : dvi_paper; 
-    dvi_framebuf[fb_y][fb_x++] = data & 0x01 ? dvi_ink : dvi_paper; 
+    line[fb_x++] = data & 0x20 ? dvi_ink : dvi_paper; 
+    line[fb_x++] = data & 0x10 ? dvi_ink : dvi_paper; 
+    line[fb_x++] = data & 0x08 ? dvi_ink : dvi_paper; 
+    line[fb_x++] = data & 0x04 ? dvi_ink : dvi_paper; 
+    line[fb_x++] = data & 0x02 ? dvi_ink : dvi_paper; 
+    line[fb_x++] = data & 0x01 ? dvi_ink : dvi_paper; 
 }
 
 uint32_t inline __attribute__((always_inline)) rgbs_cmd_pixel(uint8_t ink, uint8_t paper, uint8_t data){
@@ -200,6 +208,11 @@ void core1_loop(void){
     uint8_t pixel_data;     //Monochrome
     uint8_t invert_flag;
 
+    //Framebuffer line of the ULA line, 10 lines down and wrapping at the frame end
+    uint16_t dvi_y = 10;
+    const bool dvi_ring = dvi_fb_line_mask != ~0u;
+    dvi_fb_beam_lines = mode_50hz ? 312 : 264;
+
     pio_sm_put(RGBS_PIO,RGBS_SM,CMD_BLANK40); //Add some latency between PIO and this loop.
 
     while(1){
@@ -219,7 +232,11 @@ void core1_loop(void){
         }else if(hscan && vscan){
             //output pixeldata with invertion
             RGBS_TX = rgbs_cmd_pixel(ula.ink,ula.paper, (char_data & 0x3F) | invert_flag);
-            ula_dvi_fb_update(ula.ink, ula.paper, (char_data & 0x3F) | invert_flag, horizontalCounter*6, verticalCounter);
+            ula_dvi_fb_update(ula.ink, ula.paper, (char_data & 0x3F) | invert_flag, horizontalCounter*6, dvi_y);
+        }else if(dvi_ring && hscan){
+            //Border lines are drawn black in the ring, or they show lines from a lap ago
+            RGBS_TX = RGBS_CMD1(VAL_BLANK,1);
+            ula_dvi_fb_update(0, 0, 0, horizontalCounter*6, dvi_y);
         }else{
             RGBS_TX = RGBS_CMD1(VAL_BLANK,1);
         }
@@ -292,6 +309,10 @@ void core1_loop(void){
             case(50):   
                 verticalCounter++;
                 hsync = true;
+                dvi_y = verticalCounter + 10;
+                if(dvi_y >= dvi_fb_beam_lines)
+                    dvi_y -= dvi_fb_beam_lines;
+                dvi_fb_beam = dvi_y;
                 break;
             case(54):
                 hsync = false;
@@ -329,6 +350,7 @@ void core1_loop(void){
                         verticalCounter = 0;
                         flashCounter++;
                         mode_50hz = !!(ula.mode & ULA_50HZ);
+                        dvi_fb_beam_lines = mode_50hz ? 312 : 264;
                         force_txt = false;
                         break;
                     default:
@@ -355,6 +377,7 @@ void core1_loop(void){
                         verticalCounter = 0;
                         flashCounter++;
                         mode_50hz = !!(ula.mode & ULA_50HZ);
+                        dvi_fb_beam_lines = mode_50hz ? 312 : 264;
                         force_txt = false;
                         break;
                     default:
@@ -573,7 +596,7 @@ void xwrite_pio_init(void){
     //printf("XWRITE PIO init done\n");
 }
 
-#define TRACE_BUF &xram[0x10000]
+#define TRACE_BUF &xram[XRAM_TRACE_START]
 int trace_dma_chan;
 void trace_pio_init(void){
     pio_set_gpio_base (TRACE_PIO, TRACE_PIN_OFFS);
@@ -693,6 +716,7 @@ void ula_init(void){
     gpio_put(WREN_PIN, false);
     
     ula_dvi_init();
+    dvi_set_palette(ula_rgb332_palette, 8);
     
     multicore_launch_core1(core1_loop);
 }
@@ -16,7 +16,7 @@
 dvi_modeline_t ula_dvi_modes[] = {
     //VGA 640x480p60
     {
-        .pixel_format = dvi_4_rgb332,
+        .pixel_format = dvi_8_pal16,
         .scale_x = 2,
         .scale_y = 2,
         .offset_x = -36,
@@ -35,7 +35,7 @@ dvi_modeline_t ula_dvi_modes[] = {
     },
     //VGA 640x480p66
     {
-        .pixel_format = dvi_4_rgb332,
+        .pixel_format = dvi_8_pal16,
         .scale_x = 2,
         .scale_y = 2,
         .offset_x = -36,
@@ -54,7 +54,7 @@ dvi_modeline_t ula_dvi_modes[] = {
     },
     //576p 720x576p50
     {
-        .pixel_format = dvi_4_rgb332,
+        .pixel_format = dvi_8_pal16,
         .scale_x = 3,
         .scale_y = 2,
         .offset_x = 6,
@@ -73,7 +73,7 @@ dvi_modeline_t ula_dvi_modes[] = {
     },
     //576p 720x576p50
     {
-        .pixel_format = dvi_4_rgb332,
+        .pixel_format = dvi_8_pal16,
         .scale_x = 3,
         .scale_y = 2,
         .offset_x = 6,
@@ -92,7 +92,7 @@ dvi_modeline_t ula_dvi_modes[] = {
     },
     //480p 720x480p60
     {
-        .pixel_format = dvi_4_rgb332,
+        .pixel_format = dvi_8_pal16,
         .scale_x = 3,
         .scale_y = 2,
         .offset_x = 6,
@@ -111,7 +111,7 @@ dvi_modeline_t ula_dvi_modes[] = {
     },
     //480p 720x480p61
     {
-        .pixel_format = dvi_4_rgb332,
+        .pixel_format = dvi_8_pal16,
         .scale_x = 3,
         .scale_y = 2,
         .offset_x = 6,
@@ -130,10 +130,15 @@ dvi_modeline_t ula_dvi_modes[] = {
     },
 };
 
+//Framebuffer the ULA writes, 40 cells of 6 pixels and 224 lines from line 10
+#define ULA_DVI_FB_WIDTH  240
+#define ULA_DVI_FB_HEIGHT (10 + 224)
+
 void ula_dvi_init(void){
     uint8_t dvi_mode = cfg_get_dvi();
     if(dvi_mode > count_of(ula_dvi_modes))
         dvi_mode = 0;
+    dvi_set_fb_size(ULA_DVI_FB_WIDTH, ULA_DVI_FB_HEIGHT);
     dvi_set_modeline(&ula_dvi_modes[dvi_mode]);
 }
 
@@ -13,6 +13,7 @@
 #include "sys/dvi.h"
 #ifdef PIVIC
 #include "sys/rev.h"
+#include "vic/aud.h"
 #include "vic/vic.h"
 #endif
 // Configuration is a plain ASCII file on the LFS. e.g.
@@ -24,6 +25,10 @@
 // +A1         | DVI audio enable
 // +M0         | Mode (e.g. VIC PAL/NTSC for PIVIC)
 // +U0         |Core voltage override
+// +Y0         | VIC voice synthesis (PIVIC)
+// +R0         | DVI scanline ring
+// +L0         | DVI frame lock
+// +K0         | DVI chained DMA scan out
 // BASIC       | Boot ROM - Must be last
 
 #define CFG_DEFAULT_SPLASH 1
@@ -32,6 +37,10 @@
 #define CFG_DEFAULT_MODE 1
 #define CFG_DEFAULT_VOLT 0
 #define CFG_DEFAULT_BIAS 80
+#define CFG_DEFAULT_SYNTH 0
+#define CFG_DEFAULT_DVI_RING 0
+#define CFG_DEFAULT_DVI_LOCK 0
+#define CFG_DEFAULT_DVI_CHAIN 0
 
 #define CFG_VERSION 1
 static const char filename[] = "CONFIG.SYS";
@@ -44,6 +53,10 @@ static uint8_t cfg_dvi_audio = CFG_DEFAULT_DVI_AUDIO;
 static uint8_t cfg_mode = CFG_DEFAULT_MODE;
 static uint8_t cfg_volt = CFG_DEFAULT_VOLT;
 static uint8_t cfg_bias = CFG_DEFAULT_BIAS;
+static uint8_t cfg_synth = CFG_DEFAULT_SYNTH;
+static uint8_t cfg_dvi_ring = CFG_DEFAULT_DVI_RING;
+static uint8_t cfg_dvi_lock = CFG_DEFAULT_DVI_LOCK;
+static uint8_t cfg_dvi_chain = CFG_DEFAULT_DVI_CHAIN;
 
 // Optional string can replace boot string
 static void cfg_save_with_boot_opt(char *opt_str)
@@ -85,6 +98,10 @@ static void cfg_save_with_boot_opt(char *opt_str)
                                "+M%d\n"
                                "+U%d\n"
                                "+B%d\n"
+                               "+Y%d\n"
+                               "+R%d\n"
+                               "+L%d\n"
+                               "+K%d\n"
                                "%s",
                                CFG_VERSION,
                                cfg_phi2_khz,
@@ -95,6 +112,10 @@ static void cfg_save_with_boot_opt(char *opt_str)
                                cfg_mode,
                                cfg_volt,
                                cfg_bias,
+                               cfg_synth,
+                               cfg_dvi_ring,
+                               cfg_dvi_lock,
+                               cfg_dvi_chain,
                                opt_str);
         if (lfsresult < 0)
             printf("?Unable to write %s contents (%d)\n", filename, lfsresult);
@@ -156,6 +177,19 @@ static void cfg_load_with_boot_opt(bool boot_only)
                 break;
             case 'B':
                 cfg_bias = val;
+                break;
+            case 'Y':
+                cfg_synth = val;
+                break;
+            case 'R':
+                cfg_dvi_ring = val;
+                break;
+            case 'L':
+                cfg_dvi_lock = val;
+                break;
+            case 'K':
+                cfg_dvi_chain = val;
+                break;
             default:
                 break;
             }
@@ -173,6 +207,10 @@ bool cfg_set_defaults(uint8_t doit){
         cfg_mode = CFG_DEFAULT_MODE;
         cfg_volt = CFG_DEFAULT_VOLT;
         cfg_bias = CFG_DEFAULT_BIAS;
+        cfg_synth = CFG_DEFAULT_SYNTH;
+        cfg_dvi_ring = CFG_DEFAULT_DVI_RING;
+        cfg_dvi_lock = CFG_DEFAULT_DVI_LOCK;
+        cfg_dvi_chain = CFG_DEFAULT_DVI_CHAIN;
         cfg_save_with_boot_opt(NULL);
         return true;
     }else{
@@ -344,3 +382,74 @@ uint8_t cfg_get_bias(void)
 {
     return cfg_bias;
 }
+
+bool cfg_set_synth(uint8_t synth)
+{
+    if(synth > 1){
+        return false;
+    }
+    if(cfg_synth != synth){
+        cfg_synth = synth;
+#ifdef PIVIC
+        aud_set_synth(synth);
+#endif
+        cfg_save_with_boot_opt(NULL);
+    }
+    return true;
+}
+
+uint8_t cfg_get_synth(void)
+{
+    return cfg_synth;
+}
+
+bool cfg_set_dvi_ring(uint8_t enable)
+{
+    if(enable > 1){
+        return false;
+    }
+    if(cfg_dvi_ring != enable){
+        cfg_dvi_ring = enable;
+        cfg_save_with_boot_opt(NULL);
+    }
+    return true;
+}
+
+uint8_t cfg_get_dvi_ring(void)
+{
+    return cfg_dvi_ring;
+}
+
+bool cfg_set_dvi_lock(uint8_t enable)
+{
+    if(enable > 1){
+        return false;
+    }
+    if(cfg_dvi_lock != enable){
+        cfg_dvi_lock = enable;
+        cfg_save_with_boot_opt(NULL);
+    }
+    return true;
+}
+
+uint8_t cfg_get_dvi_lock(void)
+{
+    return cfg_dvi_lock;
+}
+
+bool cfg_set_dvi_chain(uint8_t enable)
+{
+    if(enable > 1){
+        return false;
+    }
+    if(cfg_dvi_chain != enable){
+        cfg_dvi_chain = enable;
+        cfg_save_with_boot_opt(NULL);
+    }
+    return true;
+}
+
+uint8_t cfg_get_dvi_chain(void)
+{
+    return cfg_dvi_chain;
+}
@@ -36,6 +36,14 @@ bool cfg_set_volt(uint8_t volt);
 uint8_t cfg_get_volt(void);
 bool cfg_set_bias(uint8_t bias);
 uint8_t cfg_get_bias(void);
+bool cfg_set_synth(uint8_t synth);
+uint8_t cfg_get_synth(void);
+bool cfg_set_dvi_ring(uint8_t enable);
+uint8_t cfg_get_dvi_ring(void);
+bool cfg_set_dvi_lock(uint8_t enable);
+uint8_t cfg_get_dvi_lock(void);
+bool cfg_set_dvi_chain(uint8_t enable);
+uint8_t cfg_get_dvi_chain(void);
 
 // Updates all variables to defaults and saves config file when doit==1
 bool cfg_set_defaults(uint8_t doit);
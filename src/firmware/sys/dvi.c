@@ -24,6 +24,7 @@
 #include "hardware/structs/bus_ctrl.h"
 #include "hardware/structs/hstx_ctrl.h"
 #include "hardware/structs/hstx_fifo.h"
+#include "hardware/structs/m33.h"
 #include "hardware/structs/sio.h"
 #include "pico/multicore.h"
 #include "pico/sem.h"
@@ -31,11 +32,107 @@
 #include <stdio.h>
 #include <string.h>
 
-volatile uint8_t dvi_framebuf[DVI_FB_HEIGHT][DVI_FB_WIDTH];
+//Core geometry for the cores that don't set one, the VIC PAL frame in 640 pixel modes
+#define DVI_FB_CORE_WIDTH 320
+#define DVI_FB_CORE_HEIGHT 312
+
+volatile uint8_t *dvi_framebuf;
+uint32_t dvi_fb_width = DVI_FB_CORE_WIDTH;
+uint32_t dvi_fb_height = DVI_FB_CORE_HEIGHT;
+static uint32_t dvi_fb_size;            //Bytes allocated, word aligned for packed writes
+//Without a framebuffer the core writes every line here and scan out shows border
+#define DVI_FB_BLANK_LEN 512            //Widest core line unpacked
+static uint8_t dvi_fb_blank_line[DVI_FB_BLANK_LEN] __attribute__ ((aligned(4)));
+static bool dvi_fb_blank;
+bool dvi_fb_packed;
+uint32_t dvi_fb_stride = DVI_FB_CORE_WIDTH;
+uint32_t dvi_fb_line_mask = ~0u;
+volatile uint32_t dvi_fb_beam;
+volatile uint32_t dvi_fb_beam_lines = DVI_FB_CORE_HEIGHT;
+
+//Packed framebuffers are expanded to RGB332 ahead of scan out, into line
+//buffers the DMA is not reading. A line ahead with the scanline IRQs, a batch
+//ahead when chained.
+#define DVI_LINE_BUF_LEN 384    //Longest h_active_pixels / scale_x, plus an odd start pixel
+#define DVI_CHAIN_BATCH 4       //Framebuffer lines per IRQ when chained
+#define DVI_LINE_BUF_ROWS (2 * DVI_CHAIN_BATCH)
+static uint8_t dvi_line_buf[DVI_LINE_BUF_ROWS][DVI_LINE_BUF_LEN] __attribute__ ((aligned(4)));
+static uint16_t dvi_pal_lut[256];       //Packed byte to its two RGB332 pixels, left one in the low byte
+static uint8_t dvi_line_sel;
+static uint32_t dvi_fb_row;             //Framebuffer line of the next scanline
+static uint32_t dvi_fb_px;              //Framebuffer pixel the next scanline starts at
+static uint dvi_fb_repeat;
+static uint32_t dvi_expand_max;         //Longest line expansion, in sys clocks
+
+//Frame lock. The lag of the first line scanned out each frame is the phase against the
+//core frame. A PI controller turns the error into back porch lines the next frame holds,
+//or skips when negative, with the part line carried over to the frame after.
+#define DVI_LOCK_SLIP_MAX 16            //Most lines added to one frame
+static bool dvi_lock_enabled;
+static int32_t dvi_lock_slip;           //Back porch lines left to hold or skip this frame
+static int32_t dvi_lock_slip_last;
+static int32_t dvi_lock_integ;          //Q8 lines per frame, the frame rate difference
+static int32_t dvi_lock_frac;           //Q8 part line for the next frame
+static int32_t dvi_lock_lag;            //Beam lines ahead of the first line of the frame
+static int32_t dvi_lock_lag_prev;
+static int32_t dvi_lock_err_min;
+static int32_t dvi_lock_err_max;
+static bool dvi_lock_first;             //Next line scanned out is the first of the frame
+static bool dvi_lock_valid;             //dvi_lock_lag_prev is from the last frame
+static bool dvi_lock_frame_late;        //Lines of this frame scanned out before or after the core
+static bool dvi_lock_frame_done;
+static bool dvi_lock_frame_overrun;
+static uint32_t dvi_lock_late;          //Lines scanned out before the core wrote them
+static uint32_t dvi_lock_overrun;       //Ring lines the core had written over with the next
+static uint32_t dvi_lock_tears;         //Frames showing lines of two core frames
+static uint32_t dvi_lock_doubled;       //Core frames scanned out twice
+static uint32_t dvi_lock_dropped;       //Core frames never scanned out
+
+//Chained scan out. Without DVI audio the data channel can be fed from a per frame list
+//of blocks by a control channel writing its alias 1 registers. Runs of identical blank
+//and border lines are one block, reading the line's command list through a read ring.
+//The data channel chains back to the control channel, and at the end of the frame to a
+//reload channel that points the control channel at the top of the list again. Only a
+//few blocks raise the IRQ: DVI_CHAIN_LEAD scanlines before the first framebuffer line,
+//every DVI_CHAIN_BATCH framebuffer lines when they need expanding or checking, and at
+//the end of the frame.
+#define DVI_CHAIN_LEAD 2                //Scanlines between the first batch IRQ and its lines
+#define DVI_CHAIN_BLOCKS_MAX 1600       //768 active lines, two blocks each, and the runs
+#define DVI_CHAIN_IRQS_MAX 128
+#define DVI_CHAIN_ACTIVE 0xFFFE         //IRQ entry of the first batch
+#define DVI_CHAIN_FRAME_END 0xFFFF
+
+typedef struct {
+    uint32_t ctrl;                      //In the order of the alias 1 registers
+    uint32_t read_addr;
+    uint32_t write_addr;
+    uint32_t count;
+} dvi_chain_block_t;
+
+static dvi_chain_block_t *dvi_chain_list;                      //From the xram pool when chained
+static dvi_chain_block_t *dvi_chain_top;                       //Read by the reload channel
+static dvi_chain_block_t *dvi_chain_bp;                         //Back porch run, for the frame lock
+static uint32_t dvi_chain_bp_lines;
+static uint32_t dvi_chain_blocks;
+static uint16_t dvi_chain_irq_row[DVI_CHAIN_IRQS_MAX];         //First line of each IRQ batch, in frame order
+static uint16_t dvi_chain_irq_block[DVI_CHAIN_IRQS_MAX];       //List index of the block raising it
+static uint32_t dvi_chain_irqs;
+static uint32_t dvi_chain_irq_next;
+static bool dvi_chain;
+//Blank and border line lists padded with NOPs to a power of 2, aligned for the read ring
+static uint32_t dvi_chain_vsync_off[8] __attribute__ ((aligned(32)));
+static uint32_t dvi_chain_vsync_on[8] __attribute__ ((aligned(32)));
+static uint32_t dvi_chain_border[16] __attribute__ ((aligned(64)));
+
+//IRQ load since the last status
+static uint64_t dvi_irq_clocks;
+static uint32_t dvi_stats_us;
+static uint32_t dvi_stats_irqs;
+static uint32_t dvi_stats_frames;
 
 //System specific configs are defined in their respective display subsystems
 dvi_modeline_t local_mode = {
-    .pixel_format = dvi_4_rgb332,
+    .pixel_format = dvi_8_pal16,
     .scale_x = 3,
     .scale_y = 2,
     .offset_x = 0,
@@ -364,6 +461,7 @@ volatile uint32_t irq_count = 0;
 volatile uint32_t audio_count = 0;
 volatile uint32_t frame_count = 0;
 volatile uint32_t acr_count = 0;
+volatile uint32_t dvi_line_count = 0;
 
 // First we ping. Then we pong. Then... we ping again.
 static bool dma_pong = false;
@@ -379,6 +477,8 @@ static bool vactive_cmdlist_posted = false;
 
 int DMACH_PING;
 int DMACH_PONG;
+static int DMACH_CTRL;
+static int DMACH_RELOAD;
 
 static uint mode_h_total_pixels;
 static uint mode_v_total_lines;
@@ -387,22 +487,172 @@ static uint mode_v_blank_end;
 static uint mode_v_border_top_end;
 static uint mode_v_fb_end;
 static uint mode_v_front_porch;
-static uintptr_t mode_fb_start;
+static uint32_t mode_fb_row;            //Framebuffer line and pixel of the first scanline
+static uint32_t mode_fb_x;
 static bool dvi_audio_enabled;
 static uint prev_audio_count;
 static uint audio_packets_per_frame;
 static uint audio_samples_per_line_24;
 static uint acr_packets_per_line_24;
 
+static void dvi_fb_expand(uint8_t *dst, uint32_t px){
+    uint32_t start = m33_hw->dwt_cyccnt;
+    uint32_t first = px >> 1;
+    uint32_t bytes = (fb_mode_transfers + (px & 1) + 1) >> 1;
+    if(bytes > DVI_LINE_BUF_LEN / 2)
+        bytes = DVI_LINE_BUF_LEN / 2;
+    if(first >= dvi_fb_size)
+        bytes = 0;
+    else if(first + bytes > dvi_fb_size)
+        bytes = dvi_fb_size - first;
+    const volatile uint8_t *src = &dvi_framebuf[first];
+    uint16_t *d = (uint16_t *)dst;
+    for(uint32_t i = 0; i < bytes; i++)
+        d[i] = dvi_pal_lut[src[i]];
+    uint32_t clocks = m33_hw->dwt_cyccnt - start;
+    if(clocks > dvi_expand_max)
+        dvi_expand_max = clocks;
+}
+
+static inline __attribute__((always_inline)) uint32_t dvi_fb_row_px(void){
+    return (dvi_fb_row & dvi_fb_line_mask) * dvi_fb_width + mode_fb_x;
+}
+
+//Lines the beam is ahead of framebuffer line y, negative when scan out is ahead
+static inline __attribute__((always_inline)) int32_t dvi_lock_lag_of(uint32_t y){
+    int32_t lines = dvi_fb_beam_lines;
+    int32_t lag = (int32_t)dvi_fb_beam - (int32_t)y;
+    if(lag >= lines / 2)
+        lag -= lines;
+    else if(lag < -lines / 2)
+        lag += lines;
+    return lag;
+}
+
+//Newest framebuffer line read, by the DMA or to expand it
+static inline __attribute__((always_inline)) void dvi_lock_check(uint32_t row){
+    int32_t lag = dvi_lock_lag_of(row);
+    if(lag < 1){
+        dvi_lock_late++;
+        dvi_lock_frame_late = true;
+    }else{
+        dvi_lock_frame_done = true;
+        if(lag >= DVI_FB_RING_LINES && dvi_fb_line_mask != ~0u){
+            dvi_lock_overrun++;
+            dvi_lock_frame_overrun = true;
+        }
+    }
+    if(dvi_lock_first){
+        dvi_lock_lag = lag;
+        dvi_lock_first = false;
+    }
+}
+
+//Phase error in core lines to back porch lines. A core line is mode_v_total_lines /
+//dvi_fb_beam_lines scanlines when the frame rates match.
+static void dvi_lock_step(int32_t err){
+    int32_t e = -err * (int32_t)(mode_v_total_lines << 8) / (int32_t)dvi_fb_beam_lines;
+    int32_t out = e / 2 + dvi_lock_integ + dvi_lock_frac;
+    int32_t slip = out >> 8;
+    int32_t skip_max = dvi_mode->v_back_porch > 2 ? dvi_mode->v_back_porch - 2 : 0;
+    if(slip > DVI_LOCK_SLIP_MAX || slip < -skip_max){
+        //Saturated, hold the integrator
+        slip = slip > 0 ? DVI_LOCK_SLIP_MAX : -skip_max;
+        dvi_lock_frac = 0;
+    }else{
+        dvi_lock_frac = out - (slip << 8);
+        dvi_lock_integ += e / 8;
+        if(dvi_lock_integ > (DVI_LOCK_SLIP_MAX << 8))
+            dvi_lock_integ = DVI_LOCK_SLIP_MAX << 8;
+        else if(dvi_lock_integ < -(skip_max << 8))
+            dvi_lock_integ = -(skip_max << 8);
+    }
+    dvi_lock_slip = dvi_lock_slip_last = slip;
+}
+
+//Once a frame, count how the last frame met the beam and set this frame's back porch
+static void dvi_lock_frame(void){
+    if(!dvi_lock_first){
+        int32_t lines = dvi_fb_beam_lines;
+        int32_t err = dvi_lock_lag - DVI_FB_LOCK_LAG;
+        if(dvi_lock_valid){
+            //The phase wraps when a whole core frame is gained or lost
+            int32_t d = dvi_lock_lag - dvi_lock_lag_prev;
+            if(d > lines / 2)
+                dvi_lock_doubled++;
+            else if(d < -lines / 2)
+                dvi_lock_dropped++;
+        }
+        dvi_lock_lag_prev = dvi_lock_lag;
+        dvi_lock_valid = true;
+        if((dvi_lock_frame_late && dvi_lock_frame_done) || dvi_lock_frame_overrun)
+            dvi_lock_tears++;
+        if(err < dvi_lock_err_min)
+            dvi_lock_err_min = err;
+        if(err > dvi_lock_err_max)
+            dvi_lock_err_max = err;
+        if(dvi_lock_enabled)
+            dvi_lock_step(err);
+    }
+    dvi_lock_first = true;
+    dvi_lock_frame_late = false;
+    dvi_lock_frame_done = false;
+    dvi_lock_frame_overrun = false;
+}
+
+//Hold or skip lines at the start of the back porch, before the scanline count steps
+static inline __attribute__((always_inline)) void dvi_lock_slip_line(void){
+    if(v_scanline != mode_v_sync_end || !dvi_lock_slip)
+        return;
+    if(dvi_lock_slip > 0){
+        dvi_lock_slip--;
+        v_scanline--;
+    }else{
+        v_scanline -= dvi_lock_slip;
+        dvi_lock_slip = 0;
+    }
+}
+
+//Data channel source of the current framebuffer line
+static inline __attribute__((always_inline)) uintptr_t dvi_fb_line_addr(void){
+    //Packed lines were expanded a line earlier
+    if(!dvi_fb_repeat)
+        dvi_lock_check(dvi_fb_row + dvi_fb_packed);
+    if(dvi_fb_packed)
+        return (uintptr_t)dvi_line_buf[dvi_line_sel] + (dvi_fb_px & 1);
+    return (uintptr_t)&dvi_framebuf[dvi_fb_px];
+}
+
+//After the line is posted, step to the next after scale_y scanlines
+static inline __attribute__((always_inline)) void dvi_fb_line_done(void){
+    if(++dvi_fb_repeat >= dvi_mode->scale_y){
+        dvi_fb_row++;
+        dvi_fb_px = dvi_fb_row_px();
+        dvi_fb_repeat = 0;
+        if(dvi_fb_packed){
+            dvi_line_sel ^= 1;
+            dvi_fb_expand(dvi_line_buf[dvi_line_sel], dvi_fb_px);
+        }
+    }
+}
+
+static inline __attribute__((always_inline)) void dvi_fb_frame_start(void){
+    dvi_fb_row = mode_fb_row;
+    dvi_fb_px = dvi_fb_row_px();
+    dvi_fb_repeat = 0;
+    dvi_lock_frame();
+    if(dvi_fb_packed)
+        dvi_fb_expand(dvi_line_buf[dvi_line_sel], dvi_fb_px);
+}
+
 static void dma_irq_handler() {
 
+    uint32_t start = m33_hw->dwt_cyccnt;
     irq_count++;
 
     // dma_pong indicates the channel that just finished, which is the one
     // we're about to reload.
     uint ch_num = dma_pong ? DMACH_PONG : DMACH_PING;
-    static uintptr_t fb_ptr = (uintptr_t)&dvi_framebuf;
-    static uint repeat = 0;
     static uint32_t line_count = 0;
 
     dma_channel_hw_t *ch = &dma_hw->ch[ch_num];
@@ -411,13 +661,10 @@ static void dma_irq_handler() {
 
     if (vactive_cmdlist_posted){
         hw_clear_bits(&ch->al1_ctrl, 0x3 << DMA_CH0_CTRL_TRIG_DATA_SIZE_LSB);   //DMA_SIZE_8
-        ch->read_addr = fb_ptr;
+        ch->read_addr = dvi_fb_line_addr();
         ch->transfer_count = fb_mode_transfers;
         vactive_cmdlist_posted = false;
-        if(++repeat >= dvi_mode->scale_y){
-            fb_ptr += DVI_FB_WIDTH;
-            repeat = 0;
-        }
+        dvi_fb_line_done();
     } else if (v_scanline < dvi_mode->v_front_porch) {
         hw_set_bits(&ch->al1_ctrl, DMA_SIZE_32 << DMA_CH0_CTRL_TRIG_DATA_SIZE_LSB);        
         ch->read_addr = (uintptr_t)vblank_line_vsync_off;
@@ -443,22 +690,23 @@ static void dma_irq_handler() {
 
     if (!vactive_cmdlist_posted) {
         line_count++;
+        dvi_lock_slip_line();
         if(++v_scanline >= mode_v_total_lines){
             v_scanline = 0;
-            fb_ptr = mode_fb_start;
             frame_count++;
             if(switch_dvi_mode){
                 dvi_set_modeline(next_dvi_mode);
                 switch_dvi_mode = false;
             }
+            dvi_fb_frame_start();
         }
     }
+    dvi_irq_clocks += m33_hw->dwt_cyccnt - start;
 }
 
 static void __scratch_y("") dma_irq_handler_audio() {
 
-    static uintptr_t fb_ptr = (uintptr_t)&dvi_framebuf;
-    static uint repeat = 0;
+    uint32_t start = m33_hw->dwt_cyccnt;
     static bool send_sample = false;
     static uint32_t acr_pos;
     static bool send_acr = false; 
@@ -474,13 +722,10 @@ static void __scratch_y("") dma_irq_handler_audio() {
 
     if (vactive_cmdlist_posted){
         hw_clear_bits(&ch->al1_ctrl, 0x3 << DMA_CH0_CTRL_TRIG_DATA_SIZE_LSB);   //DMA_SIZE_8
-        ch->read_addr = fb_ptr;
+        ch->read_addr = dvi_fb_line_addr();
         ch->transfer_count = fb_mode_transfers;
         vactive_cmdlist_posted = false;
-        if(++repeat >= dvi_mode->scale_y){
-            fb_ptr += DVI_FB_WIDTH;
-            repeat = 0;
-        }
+        dvi_fb_line_done();
     } else if (v_scanline == 0){
         hw_set_bits(&ch->al1_ctrl, DMA_SIZE_32 << DMA_CH0_CTRL_TRIG_DATA_SIZE_LSB);        
         if(frame_count & 1)
@@ -571,13 +816,14 @@ static void __scratch_y("") dma_irq_handler_audio() {
     }
 
     if (!vactive_cmdlist_posted) {
+        dvi_line_count++;
         send_sample = !dvi_audio_di_buf_is_empty();
         acr_pos += acr_packets_per_line_24;
         send_acr = (acr_pos >> 24);
 
+        dvi_lock_slip_line();
         if(++v_scanline >= mode_v_total_lines){
             v_scanline = 0;
-            fb_ptr = mode_fb_start;
             frame_count++;
             audio_packets_per_frame = audio_count - prev_audio_count;
             prev_audio_count = audio_count;
@@ -585,13 +831,265 @@ static void __scratch_y("") dma_irq_handler_audio() {
                 dvi_set_modeline(next_dvi_mode);
                 switch_dvi_mode = false;
             }
+            dvi_fb_frame_start();
+        }
+    }
+    irq_count++;
+    dvi_irq_clocks += m33_hw->dwt_cyccnt - start;
+}
+
+static dvi_chain_block_t *dvi_chain_put(dvi_chain_block_t *b, const void *src, uint32_t count,
+                                        enum dma_channel_transfer_size size, uint ring_bits){
+    dma_channel_config c = dma_channel_get_default_config(DMACH_PING);
+    channel_config_set_transfer_data_size(&c, size);
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, false);
+    channel_config_set_ring(&c, false, ring_bits);
+    channel_config_set_dreq(&c, DREQ_HSTX);
+    channel_config_set_chain_to(&c, DMACH_CTRL);
+    channel_config_set_high_priority(&c, true);
+    channel_config_set_irq_quiet(&c, true);
+    b->ctrl = channel_config_get_ctrl_value(&c);
+    b->read_addr = (uintptr_t)src;
+    b->write_addr = (uintptr_t)&hstx_fifo_hw->fifo;
+    b->count = count;
+    return b + 1;
+}
+
+static void dvi_chain_irq(dvi_chain_block_t *b, uint16_t row){
+    b->ctrl &= ~DMA_CH0_CTRL_TRIG_IRQ_QUIET_BITS;
+    dvi_chain_irq_block[dvi_chain_irqs] = b - dvi_chain_list;
+    dvi_chain_irq_row[dvi_chain_irqs++] = row;
+}
+
+//Block list of one frame, line by line as dma_irq_handler posts them
+static void dvi_chain_build(void){
+    memcpy(dvi_chain_vsync_off, vblank_line_vsync_off, sizeof(vblank_line_vsync_off));
+    memcpy(dvi_chain_vsync_on, vblank_line_vsync_on, sizeof(vblank_line_vsync_on));
+    memcpy(dvi_chain_border, vborder_line, sizeof(vborder_line));
+    for(uint i = count_of(vblank_line_vsync_off); i < count_of(dvi_chain_vsync_off); i++)
+        dvi_chain_vsync_off[i] = dvi_chain_vsync_on[i] = HSTX_CMD_NOP;
+    for(uint i = count_of(vborder_line); i < count_of(dvi_chain_border); i++)
+        dvi_chain_border[i] = HSTX_CMD_NOP;
+
+    uint first_active = mode_v_total_lines;
+    for(uint v = mode_v_blank_end; v < mode_v_total_lines; v++){
+        if(v >= mode_v_border_top_end && v < mode_v_fb_end){
+            first_active = v;
+            break;
+        }
+    }
+    //Batches are only needed to expand packed lines and catch ring overruns
+    bool batches = dvi_fb_packed || dvi_fb_line_mask != ~0u;
+    dvi_chain_block_t *b = dvi_chain_list;
+    const uint32_t *run = NULL;
+    uint32_t row = mode_fb_row;
+    uint repeat = 0;
+    dvi_chain_irqs = 0;
+    dvi_chain_bp = NULL;
+    for(uint v = 0; v < mode_v_total_lines; v++){
+        const uint32_t *line = NULL;
+        uint ring_bits = 5;
+        if(v < mode_v_front_porch || (v >= mode_v_sync_end && v < mode_v_blank_end)){
+            line = dvi_chain_vsync_off;
+        }else if(v < mode_v_sync_end){
+            line = dvi_chain_vsync_on;
+        }else if(v < mode_v_border_top_end || v >= mode_v_fb_end ||
+                  b - dvi_chain_list >= DVI_CHAIN_BLOCKS_MAX - 8){
+            //Lines past the end of the list are shown as border, keeping the timing
+            line = dvi_chain_border;
+            ring_bits = 6;
+        }
+        if(v + DVI_CHAIN_LEAD == first_active && b > dvi_chain_list){
+            //Break the run here, the block before raises the first batch IRQ
+            dvi_chain_irq(b - 1, DVI_CHAIN_ACTIVE);
+            run = NULL;
+        }
+        if(line){
+            uint32_t words = 1u << (ring_bits - 2);
+            if(line == run){
+                b[-1].count += words;
+            }else{
+                if(v == mode_v_sync_end)
+                    dvi_chain_bp = b;
+                b = dvi_chain_put(b, line, words, DMA_SIZE_32, ring_bits);
+                run = line;
+            }
+            if(b - 1 == dvi_chain_bp)
+                dvi_chain_bp_lines = b[-1].count / words;
+            continue;
+        }
+        run = NULL;
+        b = dvi_chain_put(b, vactive_line, count_of(vactive_line), DMA_SIZE_32, 0);
+        uintptr_t src;
+        if(dvi_fb_packed)
+            src = (uintptr_t)dvi_line_buf[(row - mode_fb_row) % DVI_LINE_BUF_ROWS] + (mode_fb_x & 1);
+        else
+            src = (uintptr_t)&dvi_framebuf[(row & dvi_fb_line_mask) * dvi_fb_width + mode_fb_x];
+        b = dvi_chain_put(b, (const void *)src, fb_mode_transfers, DMA_SIZE_8, 0);
+        //The first batch is done from the lead IRQ
+        if(batches && !repeat && row != mode_fb_row && !((row - mode_fb_row) % DVI_CHAIN_BATCH) &&
+           dvi_chain_irqs < DVI_CHAIN_IRQS_MAX - 1)
+            dvi_chain_irq(b - 1, row);
+        if(++repeat >= dvi_mode->scale_y){
+            repeat = 0;
+            row++;
         }
     }
+    //The last block ends the frame and chains to the reload channel
+    if(!(b[-1].ctrl & DMA_CH0_CTRL_TRIG_IRQ_QUIET_BITS))
+        dvi_chain_irqs--;
+    dvi_chain_irq(b - 1, DVI_CHAIN_FRAME_END);
+    b[-1].ctrl = (b[-1].ctrl & ~DMA_CH0_CTRL_TRIG_CHAIN_TO_BITS) | (DMACH_RELOAD << DMA_CH0_CTRL_TRIG_CHAIN_TO_LSB);
+    dvi_chain_blocks = b - dvi_chain_list;
+    dvi_chain_irq_next = 0;
+}
+
+//Expand a batch of packed lines from row on, and check the newest against the beam
+static void dvi_chain_batch(uint32_t row){
+    if(dvi_fb_packed){
+        for(uint32_t i = 0; i < DVI_CHAIN_BATCH; i++, row++)
+            dvi_fb_expand(dvi_line_buf[(row - mode_fb_row) % DVI_LINE_BUF_ROWS],
+                          (row & dvi_fb_line_mask) * dvi_fb_width + mode_fb_x);
+        row--;
+    }
+    dvi_lock_check(row);
+}
+
+static void dvi_chain_start(void){
+    dvi_chain_irq_next = 0;
+    dma_channel_set_read_addr(DMACH_CTRL, dvi_chain_list, true);
+}
+
+//IRQ table entry to handle, from where the control channel is in the list.
+//IRQs that coalesced are skipped, so the table can't fall out of step.
+static uint32_t dvi_chain_irq_entry(void){
+    //Blocks fetched so far, a block part way through loading counts
+    uint32_t pos = (dma_hw->ch[DMACH_CTRL].read_addr - (uintptr_t)dvi_chain_list
+                    + sizeof(dvi_chain_block_t) - 1) / sizeof(dvi_chain_block_t);
+    uint32_t last = dvi_chain_irqs - 1;
+    uint32_t next = dvi_chain_irq_next;
+    //The list restarted before the expected block ran, the frame end was missed
+    if(next > last || pos <= dvi_chain_irq_block[next])
+        return last;
+    while(next + 1 < last && dvi_chain_irq_block[next + 1] + 2 <= pos)
+        next++;
+    return next;
+}
+
+static void dma_irq_handler_chain() {
+
+    uint32_t start = m33_hw->dwt_cyccnt;
     irq_count++;
+    dma_hw->intr = 1u << DMACH_PING;
+
+    uint32_t entry = dvi_chain_irq_entry();
+    dvi_chain_irq_next = entry + 1;
+    uint16_t row = dvi_chain_irq_row[entry];
+    if(row == DVI_CHAIN_FRAME_END){
+        frame_count++;
+        if(switch_dvi_mode){
+            //New timing and list, start over from the top of the frame
+            dma_channel_abort(DMACH_CTRL);
+            dma_channel_abort(DMACH_PING);
+            dvi_set_modeline(next_dvi_mode);
+            switch_dvi_mode = false;
+            dvi_lock_frame();
+            dvi_chain_start();
+        }else{
+            dvi_chain_irq_next = 0;
+            dvi_lock_frame();
+        }
+        //Front porch and vsync lines are still to go before the back porch block loads
+        if(dvi_chain_bp){
+            int32_t lines = (int32_t)dvi_chain_bp_lines + dvi_lock_slip;
+            dvi_chain_bp->count = (lines > 0 ? lines : 1) * count_of(dvi_chain_vsync_off);
+            dvi_lock_slip = 0;
+        }
+    }else if(row == DVI_CHAIN_ACTIVE){
+        dvi_chain_batch(mode_fb_row);
+    }else{
+        //Scan out just started on row, its batch was expanded at the last IRQ
+        if(dvi_fb_packed)
+            dvi_chain_batch(row + DVI_CHAIN_BATCH);
+        else
+            dvi_lock_check(row);
+    }
+    dvi_irq_clocks += m33_hw->dwt_cyccnt - start;
+}
+
+uint32_t dvi_get_line_count(void){
+    return dvi_line_count;
+}
+
+uint32_t dvi_get_audio_samples_per_line_24(void){
+    return audio_samples_per_line_24;
 }
 
 void dvi_fb_clear(void){
-    memset((void*)dvi_framebuf, 0x00, sizeof(dvi_framebuf));
+    memset((void*)dvi_framebuf, 0x00, dvi_fb_size);
+}
+
+void dvi_set_palette(const uint8_t *rgb332, uint8_t count){
+    for(int i = 0; i < 256; i++){
+        uint8_t left = (i & 0xF) < count ? rgb332[i & 0xF] : 0;
+        uint8_t right = (i >> 4) < count ? rgb332[i >> 4] : 0;
+        dvi_pal_lut[i] = left | (right << 8);
+    }
+}
+
+//Data channel fed by the control channel, which the reload channel restarts each frame.
+//Returns false when the list doesn't fit the xram pool, leaving the scanline IRQs.
+static bool dvi_chain_init(void){
+    dvi_chain_list = mem_xram_alloc("dvi chain", DVI_CHAIN_BLOCKS_MAX * sizeof(dvi_chain_block_t), 16);
+    if(!dvi_chain_list)
+        return false;
+    dvi_chain_top = dvi_chain_list;
+    DMACH_PING = dma_claim_unused_channel(true);
+    DMACH_CTRL = dma_claim_unused_channel(true);
+    DMACH_RELOAD = dma_claim_unused_channel(true);
+    dma_channel_config c;
+    c = dma_channel_get_default_config(DMACH_CTRL);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, true);
+    channel_config_set_ring(&c, true, 4);       //The four alias 1 registers
+    channel_config_set_high_priority(&c, true);
+    dma_channel_configure(
+        DMACH_CTRL,
+        &c,
+        &dma_hw->ch[DMACH_PING].al1_ctrl,
+        dvi_chain_list,
+        sizeof(dvi_chain_block_t) / sizeof(uint32_t),
+        false
+    );
+    c = dma_channel_get_default_config(DMACH_RELOAD);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+    channel_config_set_read_increment(&c, false);
+    channel_config_set_write_increment(&c, false);
+    channel_config_set_high_priority(&c, true);
+    dma_channel_configure(
+        DMACH_RELOAD,
+        &c,
+        &dma_hw->ch[DMACH_CTRL].al3_read_addr_trig,
+        &dvi_chain_top,
+        1,
+        false
+    );
+
+    dvi_chain = true;
+    dvi_chain_build();
+
+    dma_hw->ints1 = 1u << DMACH_PING;
+    dma_hw->inte1 = 1u << DMACH_PING;
+    irq_set_exclusive_handler(DMA_IRQ_1, dma_irq_handler_chain);
+    irq_set_enabled(DMA_IRQ_1, true);
+
+    bus_ctrl_hw->priority = BUSCTRL_BUS_PRIORITY_DMA_W_BITS | BUSCTRL_BUS_PRIORITY_DMA_R_BITS;
+
+    dvi_fb_clear();
+    dvi_chain_start();
+    return true;
 }
 
 void dvi_init(void){
@@ -643,7 +1141,8 @@ void dvi_init(void){
     dvi_audio_enabled = cfg_get_dvi_audio() != 0;
     uint32_t pixel_clk = clock_get_hz(clk_hstx) / 5;
     acr_cts = (uint32_t)((uint64_t)pixel_clk * DVI_AUDIO_ACR_N / (128ULL * DVI_AUDIO_FS));
-    audio_samples_per_line_24 = ((uint64_t)DVI_AUDIO_FS * (1u<<24) * mode_h_total_pixels) / (clock_get_hz(clk_hstx) / 5);
+    //Rate the sink recovers from the ACR N/CTS pair, the reference for the audio clock lock
+    audio_samples_per_line_24 = ((uint64_t)DVI_AUDIO_ACR_N * (1u<<24) * mode_h_total_pixels) / (128ULL * acr_cts);
     acr_packets_per_line_24 = ((uint64_t)(1000 * (1ULL<<24) * mode_h_total_pixels) / pixel_clk); //Assuming standard 1000Hz ACR rate
     hstx_packet_t p;
     bool vpol, hpol;
@@ -657,6 +1156,15 @@ void dvi_init(void){
     hstx_packet_set_avi_infoframe(&p, dvi_get_modeline_vic(), 0);
     hstx_encode_data_island(&di_avi,&p,vpol,hpol);
 
+    //DWT cycle counter for the IRQ load, it is per core
+    m33_hw->demcr |= M33_DEMCR_TRCENA_BITS;
+    m33_hw->dwt_ctrl |= M33_DWT_CTRL_CYCCNTENA_BITS;
+    dvi_stats_us = time_us_32();
+
+    //Audio data islands go in every line with room, they need the scanline IRQs
+    if(cfg_get_dvi_chain() && !dvi_audio_enabled && dvi_chain_init())
+        return;
+
     // Both channels are set up identically, to transfer a whole scanline and
     // then chain to the opposite channel. Each time a channel finishes, we
     // reconfigure the one that just finished, meanwhile the opposite channel
@@ -702,6 +1210,7 @@ void dvi_init(void){
     bus_ctrl_hw->priority = BUSCTRL_BUS_PRIORITY_DMA_W_BITS | BUSCTRL_BUS_PRIORITY_DMA_R_BITS;
 
     dvi_fb_clear();
+    dvi_fb_frame_start();
 
     dma_channel_start(DMACH_PING);
 }
@@ -714,6 +1223,45 @@ void dvi_task(void){
     // }
 }
 
+void dvi_set_fb_size(uint16_t width, uint16_t height){
+    if(dvi_framebuf)
+        return;
+    dvi_fb_width = width;
+    dvi_fb_height = height;
+}
+
+//Size the framebuffer for the lines the core writes and the wider of its line and
+//the pixels the modeline scans out from offset_x, so scan out stays within a line.
+//The cores pick the layout and the ring up per line, it is all in place before core1 starts.
+static void dvi_fb_set_blank(void){
+    printf("?no room for the DVI framebuffer, DVI shows border only\n");
+    dvi_framebuf = dvi_fb_blank_line;
+    dvi_fb_size = sizeof(dvi_fb_blank_line);
+    dvi_fb_line_mask = 0;
+    dvi_fb_blank = true;
+}
+
+static void dvi_fb_alloc(void){
+    uint32_t scan = fb_mode_transfers + (dvi_mode->offset_x > 0 ? dvi_mode->offset_x : 0);
+    if(scan > dvi_fb_width)
+        dvi_fb_width = scan;
+    dvi_fb_width = (dvi_fb_width + 3) & ~3u;    //Word aligned lines, packed or not
+    uint32_t stride = dvi_fb_packed ? dvi_fb_width / 2 : dvi_fb_width;
+    dvi_framebuf = cfg_get_dvi_ring() ? NULL : mem_xram_alloc("dvi fb", stride * dvi_fb_height, 4);
+    if(dvi_framebuf){
+        dvi_fb_size = stride * dvi_fb_height;
+        dvi_fb_line_mask = ~0u;
+    }else{
+        //The ring fits any modeline, and stands in when a whole frame doesn't
+        dvi_fb_size = stride * DVI_FB_RING_LINES;
+        dvi_framebuf = mem_xram_alloc("dvi fb ring", dvi_fb_size, 4);
+        dvi_fb_line_mask = DVI_FB_RING_LINES - 1;
+    }
+    if(!dvi_framebuf)
+        dvi_fb_set_blank();
+    memset((void*)dvi_framebuf, 0x00, dvi_fb_size);
+}
+
 void dvi_set_modeline(dvi_modeline_t *ml){
     dvi_mode = ml;
     clock_configure(clk_hstx, 0, CLOCKS_CLK_HSTX_CTRL_AUXSRC_VALUE_CLK_SYS, 
@@ -739,6 +1287,9 @@ void dvi_set_modeline(dvi_modeline_t *ml){
 
     dvi_build_hstx_lists(dvi_mode);
 
+    //Only the packed palette format is expanded, the rest scan out as RGB332
+    dvi_fb_packed = dvi_mode->pixel_format == dvi_8_pal16;
+
     switch(dvi_mode->scale_x){
         case(2):
             fb_mode_transfers = dvi_mode->h_active_pixels / 2;
@@ -760,6 +1311,15 @@ void dvi_set_modeline(dvi_modeline_t *ml){
             break;
     }
 
+    //Sized once, later modelines scan out the same framebuffer
+    if(!dvi_framebuf)
+        dvi_fb_alloc();
+    dvi_fb_stride = dvi_fb_packed ? dvi_fb_width / 2 : dvi_fb_width;
+    //An RGB332 modeline after a packed one needs more than was allocated
+    uint32_t fb_lines = dvi_fb_line_mask == ~0u ? dvi_fb_height : dvi_fb_line_mask + 1;
+    if(!dvi_fb_blank && dvi_fb_stride * fb_lines > dvi_fb_size)
+        dvi_fb_set_blank();
+
     fb_mode_offset = (dvi_mode->offset_y - (mode_v_total_lines - dvi_mode->v_active_lines));
 
     mode_v_sync_end = 
@@ -768,23 +1328,42 @@ void dvi_set_modeline(dvi_modeline_t *ml){
 
     mode_v_blank_end = mode_v_total_lines - dvi_mode->v_active_lines;
     mode_v_border_top_end = (dvi_mode->offset_y > 0) ? 0 : (mode_v_blank_end - (dvi_mode->offset_y * dvi_mode->scale_y));
-    mode_v_fb_end = mode_v_blank_end + (DVI_FB_HEIGHT * dvi_mode->scale_y) - dvi_mode->offset_y;
-    mode_fb_start = (uintptr_t)&(dvi_framebuf[(dvi_mode->offset_y > 0 ) ? dvi_mode->offset_y : 0][dvi_mode->offset_x]);
+    mode_v_fb_end = mode_v_blank_end + (dvi_fb_height * dvi_mode->scale_y) - dvi_mode->offset_y;
+    uint32_t fb_start = ((dvi_mode->offset_y > 0 ) ? dvi_mode->offset_y : 0) * dvi_fb_width + dvi_mode->offset_x;
     mode_v_front_porch = dvi_mode->v_front_porch;
     if(dvi_mode->offset_x < 0){
         mode_v_border_top_end += 1;
-        mode_fb_start += DVI_FB_WIDTH;
+        fb_start += dvi_fb_width;
     }
+    mode_fb_row = fb_start / dvi_fb_width;
+    mode_fb_x = fb_start % dvi_fb_width;
+    if(dvi_fb_blank)
+        mode_v_fb_end = mode_v_border_top_end;
+
+    //The ring only works locked, blank has nothing to lock to
+    dvi_lock_enabled = !dvi_fb_blank && (dvi_fb_line_mask != ~0u || cfg_get_dvi_lock());
+    dvi_lock_slip = 0;
+    dvi_lock_integ = 0;
+    dvi_lock_frac = 0;
+    dvi_lock_first = true;
+    dvi_lock_valid = false;
+    dvi_lock_err_min = INT32_MAX;
+    dvi_lock_err_max = INT32_MIN;
+
+    if(dvi_chain)
+        dvi_chain_build();
 }
 
 void dvi_print_modeline(dvi_modeline_t *ml){
     uint dotclk = clock_get_hz(clk_sys) / (ml->hstx_div * 5); // Dot clk is DDR 10 bit per pixel 
     uint htot = ml->h_active_pixels + ml->h_front_porch + ml->h_sync_width + ml->h_back_porch;
     uint vtot = ml->v_active_lines + ml->v_front_porch + ml->v_sync_width + ml->v_back_porch;
-    printf(" %dx%d @ %.2f scale %dx%d\n", 
+    static const char *formats[] = {"rgb111", "rgb332", "rgb565", "rgb888", "pal16"};
+    printf(" %dx%d @ %.2f scale %dx%d %s\n", 
         ml->h_active_pixels, ml->v_active_lines, 
         dotclk / (htot * vtot * 1.0),
-        ml->scale_x, ml->scale_y
+        ml->scale_x, ml->scale_y,
+        ml->pixel_format < count_of(formats) ? formats[ml->pixel_format] : "?"
     );
 }
 
@@ -826,11 +1405,46 @@ void dvi_print_hstx_packet(hstx_packet_t *p){
 
 
 void dvi_print_status(void){
-    printf("DVI status\n PING:%08x\n PONG:%08x\n", dma_hw->ch[DMACH_PING].al1_ctrl, dma_hw->ch[DMACH_PONG].al1_ctrl);
+    printf("DVI status\n PING:%08x\n %s:%08x\n", dma_hw->ch[DMACH_PING].al1_ctrl,
+           dvi_chain ? "CTRL" : "PONG", dma_hw->ch[dvi_chain ? DMACH_CTRL : DMACH_PONG].al1_ctrl);
     printf(" HSTX clock:%ld\r\n", clock_get_hz(clk_hstx));
     printf(" HSTX stat:%08x\n", hstx_fifo_hw->stat);
     printf(" IRQ count:%08x\n", irq_count);
+    uint32_t now = time_us_32();
+    uint32_t us = now - dvi_stats_us;
+    uint32_t irqs = irq_count - dvi_stats_irqs;
+    uint32_t frames = frame_count - dvi_stats_frames;
+    if(us && frames){
+        uint32_t sys_mhz = clock_get_hz(clk_sys) / 1000000;
+        printf(" scan out %s: %lu IRQs/s, %lu per frame, %lu us/s on core0\n",
+               dvi_chain ? "chained" : "per line IRQ",
+               (uint32_t)((uint64_t)irqs * 1000000 / us), irqs / frames,
+               (uint32_t)(dvi_irq_clocks * 1000000 / sys_mhz / us));
+    }
+    if(dvi_chain)
+        printf(" chain %lu blocks, %lu IRQs per frame\n", dvi_chain_blocks, dvi_chain_irqs);
+    dvi_stats_us = now;                 //Clear for next status
+    dvi_stats_irqs = irq_count;
+    dvi_stats_frames = frame_count;
+    dvi_irq_clocks = 0;
     printf(" fb_mode_transfers:%d\n", fb_mode_transfers);
+    printf(" framebuffer %s %lux%lu: %lu bytes", dvi_fb_packed ? "packed" : "rgb332",
+           dvi_fb_width, dvi_fb_height, dvi_fb_size);
+    if(dvi_fb_blank)
+        printf(", blank");
+    if(dvi_fb_packed)
+        printf(", line expand max:%lu sys clocks", dvi_expand_max);
+    printf("\n");
+    dvi_expand_max = 0;                 //Clear for next status
+    printf(" frame lock %s, lag:%ld target:%d phase error min:%ld max:%ld\n",
+           dvi_lock_enabled ? "on" : "off", dvi_lock_lag, DVI_FB_LOCK_LAG, dvi_lock_err_min, dvi_lock_err_max);
+    printf(" lock slip:%ld trim:%.2f lines/frame, tears:%lu doubled:%lu dropped:%lu late lines:%lu\n",
+           dvi_lock_slip_last, (float)dvi_lock_integ / 256, dvi_lock_tears, dvi_lock_doubled,
+           dvi_lock_dropped, dvi_lock_late);
+    if(dvi_fb_line_mask != ~0u)
+        printf(" ring %d lines, overrun lines:%lu\n", DVI_FB_RING_LINES, dvi_lock_overrun);
+    dvi_lock_err_min = INT32_MAX;       //Clear for next status
+    dvi_lock_err_max = INT32_MIN;
     printf(" audio_count_per_frame:%d / %d = %f \n", audio_count, frame_count, (float)audio_count/frame_count);
     printf(" acr_count_per_frame:%d / %d = %d \n", acr_count, frame_count, acr_count/frame_count);
     printf(" audio acr cts:%d n:%d %d\n", acr_cts, DVI_AUDIO_ACR_N, acr_line_incr);
@@ -913,6 +1527,7 @@ void dvi_mon_modeline(const char *args, size_t len){
             local_mode.offset_y = dvi_mode->offset_y;
             local_mode.scale_x = dvi_mode->scale_x;
             local_mode.scale_y = dvi_mode->scale_y;
+            local_mode.pixel_format = dvi_mode->pixel_format;     //The cores only set up their writes at init
 
             dvi_print_modeline(&local_mode);
             next_dvi_mode = &local_mode;
@@ -16,9 +16,10 @@
 typedef enum
 {
     dvi_6_rgb111,   //Oric standard bit depth
-    dvi_4_rgb332,   //Currently the only supported DVI buffert type
+    dvi_4_rgb332,   //Scanned out as is
     dvi_2_rgb565,
     dvi_1_rgb888,
+    dvi_8_pal16,    //Packed 4 bit palette index, expanded to RGB332 a line ahead of scan out
 } dvi_pixel_format_t;
 
 typedef enum
@@ -31,7 +32,7 @@ typedef enum
 
 typedef struct
 {
-    dvi_pixel_format_t pixel_format;    //Only RGB332 supported for now
+    dvi_pixel_format_t pixel_format;    //Only RGB332 and PAL16 supported for now
     uint8_t scale_x;                    //Only 2,3 or 4 supported for now
     uint8_t scale_y;                    //Only 1 or 2 supported for now
     int16_t offset_x;                   
@@ -49,11 +50,38 @@ typedef struct
     uint8_t vic;                        //Video format ID code
 } dvi_modeline_t;
 
-//TODO Make DVI mode dynamic
-//Framebuffer size works when 8bpp and 2x/3x scaling used
-#define DVI_FB_WIDTH 320
-#define DVI_FB_HEIGHT 312
-extern volatile uint8_t dvi_framebuf[DVI_FB_HEIGHT][DVI_FB_WIDTH];
+//Framebuffer sized at the first dvi_set_modeline from the core geometry and the
+//pixels the modeline scans out per line, then allocated from the xram pool.
+//dvi_fb_height is the lines the core writes, the ring keeps fewer in memory.
+extern volatile uint8_t *dvi_framebuf;
+extern uint32_t dvi_fb_width;
+extern uint32_t dvi_fb_height;
+
+//Framebuffer layout of the modeline pixel format. Lines are dvi_fb_stride bytes
+//apart, one RGB332 byte per pixel, or packed two palette indices to a byte with
+//the left pixel in the low nibble.
+extern bool dvi_fb_packed;
+extern uint32_t dvi_fb_stride;
+
+//Racing the beam. With the ring on (SET RING) line y is kept in slot y & dvi_fb_line_mask
+//of a DVI_FB_RING_LINES line ring, and only the ring is allocated. The core
+//publishes the line it is writing, and with the frame lock on (SET LOCK, or the ring)
+//the DVI frame timing is pulled in to scan out DVI_FB_LOCK_LAG lines behind it.
+#define DVI_FB_RING_LINES 32            //Power of 2
+#define DVI_FB_LOCK_LAG 8               //Target lines between the beam and scan out
+extern uint32_t dvi_fb_line_mask;       //All ones without the ring
+extern volatile uint32_t dvi_fb_beam;   //Framebuffer line the core is writing
+extern volatile uint32_t dvi_fb_beam_lines; //Core lines per frame, where the beam wraps
+
+static inline volatile uint8_t *dvi_fb_line(uint32_t y){
+    return &dvi_framebuf[(y & dvi_fb_line_mask) * dvi_fb_stride];
+}
+
+//RGB332 colours of the packed palette indices
+void dvi_set_palette(const uint8_t *rgb332, uint8_t count);
+
+//Pixels per line and lines the core writes, set before the first dvi_set_modeline
+void dvi_set_fb_size(uint16_t width, uint16_t height);
 
 //Modes and modelines are defined and set from the primary display systems (e.g. VIC or ULA)
 void dvi_set_modeline(dvi_modeline_t *ml);
@@ -63,6 +91,10 @@ uint8_t dvi_get_modeline_vic(void);
 void dvi_init(void);
 void dvi_task(void);
 
+//Scanlines sent with DVI audio on, and the ACR sample rate per scanline in 8.24
+uint32_t dvi_get_line_count(void);
+uint32_t dvi_get_audio_samples_per_line_24(void);
+
 void dvi_print_status(void);
 
 void dvi_mon_modeline(const char *args, size_t len);
@@ -8,6 +8,7 @@
 #include "sys/cfg.h"
 #include "sys/dvi.h"
 #include "sys/dvi_audio.h"
+#include "sys/pcm.h"
 #include "pico_hdmi/hstx_packet.h"
 #include "hardware/clocks.h"
 #include "hardware/dma.h"
@@ -145,13 +146,49 @@ void dvi_audio_set_fs_cb(irq_handler_t fn){
     audio_fs_cb = fn;
 }
 
+bool dvi_audio_enabled = false;
+
+//Audio clock lock. The sample timer is steered so the samples sent follow the
+//rate the sink recovers from the ACR packets, counted in scanlines sent. The
+//timer period is X/Y with X=2, Y in 16.16 dithered per sample by the fs IRQ.
+#define DVI_AUDIO_LOCK_MS 10            // Controller update interval
+#define DVI_AUDIO_LOCK_RANGE 64         // Phase error in samples that forces a relock
+#define DVI_AUDIO_LOCK_LIMIT 100        // Period trim limit, 1/LIMIT of nominal
+
+static volatile uint32_t fs_count;
+static volatile bool fs_lock_active;
+static volatile uint32_t fs_period_16;
+static uint32_t fs_period_acc;
+static uint32_t fs_nominal_16;
+static uint32_t fs_kp;
+static int32_t fs_integ;
+static int64_t fs_phase_24;             // Samples sent ahead of the ACR rate, 8.24
+static uint32_t fs_last_lines;
+static uint32_t fs_last_sent;
+static int32_t fs_err_max;              // Largest phase error since last status, Q8 samples
+static uint32_t fs_lock_steps;
+static uint32_t fs_relocks;
+static uint32_t fs_overruns;
+
 static absolute_time_t irq_time_stamp;
 static void irq_handler(void){
     dma_hw->ints2 = dma_hw->ints2;
+    fs_count++;
+    if(fs_lock_active){
+        uint32_t period = fs_period_16;
+        uint32_t acc = fs_period_acc + (period & 0xFFFF);
+        dma_hw->timer[sample_timer] = (2u << 16) | ((period >> 16) + (acc >> 16));
+        fs_period_acc = acc & 0xFFFF;
+    }
     audio_fs_cb();
+    if(pcm_streaming)
+        pcm_push(source_sample->left);
 }
 
-bool dvi_audio_enabled = false;
+//Sample period in half sys clocks. Assumes 1/2 integer divisable sys_clk to fs ratio
+uint32_t dvi_audio_fs_period_x2(void){
+    return (2*clock_get_hz(clk_sys))/(DVI_AUDIO_FS+64);
+}
 
 void dvi_audio_init(void){
     // Audio sources may use the audio_fs_cb which requires this DMA and IRQ setup regardless dvi_audio is enabled or not.
@@ -160,7 +197,7 @@ void dvi_audio_init(void){
     dma_channel_config sample_dma = dma_channel_get_default_config(dma_sample_chan_idx);
     sample_timer = dma_claim_unused_timer(true);
     
-    dma_timer_set_fraction(sample_timer, 2, (2*clock_get_hz(clk_sys))/(DVI_AUDIO_FS+64));    //Assumes 1/2 integer divisable sys_clk to fs ratio
+    dma_timer_set_fraction(sample_timer, 2, dvi_audio_fs_period_x2());
     channel_config_set_dreq(&sample_dma, dma_get_timer_dreq(sample_timer));
     channel_config_set_read_increment(&sample_dma, false);
     channel_config_set_write_increment(&sample_dma, true);
@@ -206,6 +243,82 @@ void dvi_audio_init(void){
 
 uint32_t dvi_audio_count=0;
 
+static inline uint16_t dvi_audio_di_buf_level(void){
+    return (di_head_idx - di_tail_idx) & (DI_BUF_LEN-1);
+}
+
+//Rate the fs timer takes samples at, in Hz. Locked it is the nominal period
+//with the integral trim, which follows the rate the sink recovers.
+uint32_t dvi_audio_fs_rate(void){
+    uint64_t clocks_16 = (2ull * clock_get_hz(clk_sys)) << 16;
+    uint32_t period_16 = fs_lock_active ? fs_nominal_16 + fs_integ : dvi_audio_fs_period_x2() << 16;
+    return (clocks_16 + period_16 / 2) / period_16;
+}
+
+static void dvi_audio_lock_reset(void){
+    fs_phase_24 = 0;
+    fs_last_lines = dvi_get_line_count();
+    fs_last_sent = fs_count - dvi_audio_get_buflen() - dvi_audio_di_buf_level() * 4;
+}
+
+static void dvi_audio_lock_task(void){
+    static absolute_time_t timer = 0;
+    if(absolute_time_diff_us(get_absolute_time(), timer) > 0)
+        return;
+    timer = delayed_by_ms(get_absolute_time(), DVI_AUDIO_LOCK_MS);
+
+    if(!fs_lock_active){
+        fs_nominal_16 = (uint32_t)(((2ull * clock_get_hz(clk_sys)) << 16) / DVI_AUDIO_FS);
+        fs_kp = fs_nominal_16 >> 22;    // About 60 ppm per sample of phase error
+        fs_integ = 0;
+        fs_period_16 = fs_nominal_16;
+        dvi_audio_lock_reset();
+        fs_lock_active = true;
+        return;
+    }
+
+    //Samples sent are those produced less those still queued. Read together
+    //with the scanline count so a packet is not counted on one side only.
+    uint32_t save = save_and_disable_interrupts();
+    uint32_t lines = dvi_get_line_count();
+    uint32_t sent = fs_count - dvi_audio_get_buflen() - dvi_audio_di_buf_level() * 4;
+    restore_interrupts(save);
+
+    if(dvi_audio_get_buflen() >= DVI_AUDIO_BUF_LEN - 4)
+        fs_overruns++;
+    fs_phase_24 += ((int64_t)(int32_t)(sent - fs_last_sent) << 24)
+                 - (int64_t)(lines - fs_last_lines) * dvi_get_audio_samples_per_line_24();
+    fs_last_sent = sent;
+    fs_last_lines = lines;
+    fs_lock_steps++;
+
+    int32_t err = (int32_t)(fs_phase_24 >> 16);
+    if(err > DVI_AUDIO_LOCK_RANGE << 8 || err < -(DVI_AUDIO_LOCK_RANGE << 8)){
+        //Mode change or stall, start over from the current position
+        fs_relocks++;
+        dvi_audio_lock_reset();
+        return;
+    }
+    int32_t abs_err = err < 0 ? -err : err;
+    if(abs_err > fs_err_max)
+        fs_err_max = abs_err;
+
+    //PI on the phase error, ahead means a longer sample period
+    int32_t limit = (int32_t)(fs_nominal_16 / DVI_AUDIO_LOCK_LIMIT);
+    int32_t p = err * (int32_t)fs_kp;
+    fs_integ += p >> 8;
+    if(fs_integ > limit)
+        fs_integ = limit;
+    if(fs_integ < -limit)
+        fs_integ = -limit;
+    int32_t trim = fs_integ + p;
+    if(trim > limit)
+        trim = limit;
+    if(trim < -limit)
+        trim = -limit;
+    fs_period_16 = fs_nominal_16 + trim;
+}
+
 void dvi_audio_task(void){
     //SW interrupt monitoring of fs clock to not disturb DVI interrupt system
     static int audio_frame_cnt = 0;
@@ -222,6 +335,9 @@ void dvi_audio_task(void){
         dvi_audio_push_di(NULL);
         dvi_audio_count++;
     }
+
+    if(dvi_audio_enabled)
+        dvi_audio_lock_task();
 }
 
 void dvi_audio_print_status(void){
@@ -234,4 +350,13 @@ void dvi_audio_print_status(void){
     printf(" dma rd:%08x wr:%08x cnt:%08x\n", dma_sample_chan->read_addr, dma_sample_chan->write_addr, dma_sample_chan->transfer_count);
     printf(" sample timer: %d / %d\n", dma_hw->timer[sample_timer]>>16, dma_hw->timer[sample_timer] & 0xFFFF);
     printf(" sample %d %d\n", audio_buf[tail_idx].left, audio_buf[tail_idx].right);
+    if(fs_lock_active){
+        int32_t drift = (int32_t)(-(int64_t)fs_integ * 1000000 / fs_nominal_16);
+        printf(" clock lock drift:%ld ppm period:%lu.%04lu\n", drift,
+               fs_period_16 >> 16, ((fs_period_16 & 0xFFFF) * 10000) >> 16);
+        printf(" phase err:%ld/256 max:%ld/256 samples\n", (int32_t)(fs_phase_24 >> 16), fs_err_max);
+        printf(" lock steps:%lu relocks:%lu overruns:%lu underflows:%lu\n",
+               fs_lock_steps, fs_relocks, fs_overruns, dvi_audio_pop_underflow);
+        fs_err_max = 0;                 //Clear for next status
+    }
 }
\ No newline at end of file
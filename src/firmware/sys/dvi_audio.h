@@ -34,6 +34,8 @@ bool dvi_audio_pop_di(uint32_t *di);
 void dvi_audio_cpy_di(uint32_t *di_out, hstx_data_island_t *di_in);
 
 void dvi_audio_set_fs_cb(irq_handler_t fn);
+uint32_t dvi_audio_fs_period_x2(void);
+uint32_t dvi_audio_fs_rate(void);
 
 void dvi_audio_print_status(void);
 
@@ -5,9 +5,56 @@
  */
 
 #include "mem.h"
+#include <stdio.h>
+
+#define MEM_XRAM_REGIONS 8
+
+typedef struct {
+    const char *name;
+    uint32_t start;
+    uint32_t size;
+} mem_region_t;
+
+// Linker symbols bounding the static data and the heap in RAM, which starts after xram
+extern char __end__;
+extern char __HeapLimit;
 
 uint8_t xstack[XSTACK_SIZE + 1];
 size_t volatile xstack_ptr;
 
 uint8_t mbuf[MBUF_SIZE] __attribute__((aligned(4)));
 size_t mbuf_len;
+
+static mem_region_t mem_xram_regions[MEM_XRAM_REGIONS];
+static uint32_t mem_xram_region_count;
+static uint32_t mem_xram_top = XRAM_POOL_START;
+
+void *mem_xram_alloc(const char *name, size_t size, size_t align)
+{
+    uint32_t start = (mem_xram_top + align - 1) & ~(align - 1);
+    if (mem_xram_region_count >= MEM_XRAM_REGIONS ||
+        start + size > sizeof(xram))
+    {
+        printf("?xram pool full, %s needs %u bytes\n", name, size);
+        return NULL;
+    }
+    mem_region_t *r = &mem_xram_regions[mem_xram_region_count++];
+    r->name = name;
+    r->start = start;
+    r->size = size;
+    mem_xram_top = start + size;
+    return (void *)&xram[start];
+}
+
+void mem_print_status(void)
+{
+    uint32_t ram = (uintptr_t)xram + sizeof(xram);
+    uint32_t end = (uintptr_t)&__end__;
+    uint32_t limit = (uintptr_t)&__HeapLimit;
+    printf("XRAM %u bytes, CPU %u, trace %u, pool %lu free\n", sizeof(xram), XRAM_TRACE_START,
+           XRAM_POOL_START - XRAM_TRACE_START, sizeof(xram) - mem_xram_top);
+    for (uint32_t i = 0; i < mem_xram_region_count; i++)
+        printf(" %05lX %6lu %s\n", mem_xram_regions[i].start, mem_xram_regions[i].size,
+               mem_xram_regions[i].name);
+    printf("RAM %lu bytes, static %lu, heap %lu\n", limit - ram, end - ram, limit - end);
+}
@@ -13,7 +13,10 @@
 
 // 256KB Extended RAM
 extern volatile uint8_t xram[0x40000];
+// Host builds (src/host) link xram as a regular array
+#ifdef __arm__
 asm(".equ xram, 0x20000000");
+#endif
 // The xstack is:
 // 512 bytes, enough to hold a CC65 stack frame, two strings for a
 // file rename, or a disk sector
@@ -28,7 +31,9 @@ extern volatile size_t xstack_ptr;
 extern uint8_t regs[0x20];
 #define REGS(addr) regs[(addr) & 0x1F]
 #define REGSW(addr) ((uint16_t *)&REGS(addr))[0]
+#ifdef __arm__
 asm(".equ regs, 0x20080000");
+#endif
 
 // Misc memory buffer for moving things around.
 // 6502 <-> RAM, USB <-> RAM, UART <-> RAM, etc.
@@ -36,4 +41,16 @@ asm(".equ regs, 0x20080000");
 extern uint8_t mbuf[];
 extern size_t mbuf_len;
 
+// xram above the 6502 address space. The first 32KB is the bus trace ring,
+// the largest a DMA write ring wraps, the rest is a pool handed out at init
+// to buffers sized at run time.
+#define XRAM_TRACE_START 0x10000
+#define XRAM_POOL_START 0x18000
+
+// Allocate size bytes of the pool aligned to align, a power of 2.
+// Regions are kept until reboot. Returns NULL when the pool is full.
+void *mem_xram_alloc(const char *name, size_t size, size_t align);
+
+void mem_print_status(void);
+
 #endif /* _MEM_H_ */
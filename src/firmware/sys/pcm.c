@@ -0,0 +1,145 @@
+/*
+ * Copyright (c) 2026 Sodiumlightbaby
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "main.h"
+#include "str.h"
+#include "sys/com.h"
+#include "sys/dvi_audio.h"
+#include "sys/pcm.h"
+#include "usb/cdc.h"
+#include "pico/stdlib.h"
+#include "tusb.h"
+#include <stdio.h>
+
+#define PCM_HEADER_SIZE 12
+
+int16_t pcm_ring[PCM_RING_LEN];
+volatile uint32_t pcm_head;
+volatile uint32_t pcm_tail;
+volatile uint32_t pcm_lost;
+volatile bool pcm_streaming;
+
+static bool pcm_header_pending;
+static bool pcm_end_pending;
+static uint8_t pcm_key;
+static uint32_t pcm_lost_sent;          // pcm_lost as last reported in a block
+
+static uint32_t pcm_stat_samples;
+static uint32_t pcm_stat_blocks;
+static uint32_t pcm_stat_lost;
+
+static void pcm_com_rx(bool timeout, const char *buf, size_t length){
+    (void)timeout;
+    (void)buf;
+    (void)length;
+    pcm_streaming = false;
+    pcm_end_pending = true;
+    pcm_stat_lost = pcm_lost;
+}
+
+//The end block is retried until it fits, console output stays muted until then
+static void pcm_send_end(void){
+    uint8_t end[4] = {0, 0, 0, 0};
+    if(tud_cdc_connected()){
+        if(tud_cdc_write_available() < sizeof(end))
+            return;
+        tud_cdc_write(end, sizeof(end));
+    }
+    pcm_end_pending = false;
+    cdc_stdio_mute(false);
+}
+
+static void pcm_send_header(void){
+#ifdef PIVIC
+    uint8_t source = PCM_SOURCE_VIC;
+#else
+    uint8_t source = PCM_SOURCE_AY;
+#endif
+    //The timer rate, DVI_AUDIO_FS only when the DVI audio lock runs
+    uint32_t rate = dvi_audio_fs_rate();
+    uint8_t header[PCM_HEADER_SIZE] = {'P', 'V', 'P', 'C', PCM_STREAM_VERSION, source, 1, 16,
+                                       rate, rate >> 8, rate >> 16, rate >> 24};
+    tud_cdc_write(header, sizeof(header));
+}
+
+void pcm_task(void){
+    if(pcm_end_pending)
+        pcm_send_end();
+    if(!pcm_streaming)
+        return;
+    if(pcm_header_pending){
+        if(tud_cdc_write_available() < PCM_HEADER_SIZE)
+            return;
+        pcm_send_header();
+        pcm_header_pending = false;
+    }
+
+    //Drops counted before head is read sit before the samples sent here
+    uint32_t lost = pcm_lost;
+    uint32_t head = pcm_head;
+    uint32_t tail = pcm_tail;
+    while(tail != head){
+        uint32_t count = head - tail;
+        if(count > PCM_BLOCK_MAX)
+            count = PCM_BLOCK_MAX;
+        if(tud_cdc_write_available() < 4 + count * 2)
+            break;
+        uint32_t dropped = lost - pcm_lost_sent;
+        if(dropped > 0xFFFF)
+            dropped = 0xFFFF;
+        pcm_lost_sent += dropped;
+        uint8_t block[4] = {count, count >> 8, dropped, dropped >> 8};
+        tud_cdc_write(block, sizeof(block));
+        //Samples are little endian in memory, send straight from the ring
+        uint32_t idx = tail & (PCM_RING_LEN-1);
+        uint32_t to_end = PCM_RING_LEN - idx;
+        if(to_end >= count){
+            tud_cdc_write(&pcm_ring[idx], count * 2);
+        }else{
+            tud_cdc_write(&pcm_ring[idx], to_end * 2);
+            tud_cdc_write(&pcm_ring[0], (count - to_end) * 2);
+        }
+        tail += count;
+        pcm_stat_samples += count;
+        pcm_stat_blocks++;
+    }
+    pcm_tail = tail;
+}
+
+bool pcm_active(void){
+    return pcm_streaming || pcm_end_pending;
+}
+
+static void pcm_stream_start(void){
+    pcm_stat_samples = pcm_stat_blocks = pcm_stat_lost = 0;
+    pcm_lost = pcm_lost_sent = 0;
+    pcm_tail = pcm_head;
+    pcm_header_pending = true;
+    pcm_end_pending = false;
+    pcm_streaming = true;
+    // Console output would corrupt the binary stream
+    cdc_stdio_mute(true);
+    // Any key ends the stream
+    com_read_binary(0, pcm_com_rx, &pcm_key, 1);
+}
+
+static void pcm_print_status(void){
+    printf("PCM %lu Hz 16 bit mono, ring %d samples\n", dvi_audio_fs_rate(), PCM_RING_LEN);
+    printf("Last stream %lu samples, %lu blocks, %lu samples lost\n",
+           pcm_stat_samples, pcm_stat_blocks, pcm_stat_lost);
+}
+
+void pcm_mon_pcm(const char *args, size_t len){
+    if(!len){
+        pcm_print_status();
+        return;
+    }
+    if(!strnicmp(args, "stream", len)){
+        pcm_stream_start();
+        return;
+    }
+    printf("?invalid argument\n");
+}
@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) 2026 Sodiumlightbaby
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef _PCM_H_
+#define _PCM_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Sound capture stream, sent over USB CDC by PCM STREAM and written to a WAV
+// file by src/host/pcmwav. The samples are the DVI audio sample source, as
+// the fs callback leaves it for the next DVI audio sample. Little endian.
+//   Header: "PVPC", version, source (PCM_SOURCE_*), channels, bits per
+//     sample, fs timer sample rate in Hz as 4 bytes
+//   Block: sample count and samples dropped since the previous block, 2 bytes
+//     each, then the samples. A block with count 0 ends the stream.
+// Other stdio output to the CDC is dropped from the start of the stream until
+// the end block is sent.
+#define PCM_STREAM_VERSION 1
+#define PCM_SOURCE_VIC 0
+#define PCM_SOURCE_AY  1
+#define PCM_BLOCK_MAX  64       // Samples per block
+
+//Ring size must be power of 2
+#define PCM_RING_LEN_BITS 10
+#define PCM_RING_LEN (1<<PCM_RING_LEN_BITS)
+
+extern int16_t pcm_ring[PCM_RING_LEN];
+extern volatile uint32_t pcm_head;      //Written by the fs IRQ
+extern volatile uint32_t pcm_tail;      //Written by pcm_task
+extern volatile uint32_t pcm_lost;      //Samples dropped on a full ring
+extern volatile bool pcm_streaming;
+
+void pcm_task(void);
+bool pcm_active(void);
+void pcm_mon_pcm(const char *args, size_t len);
+
+//Called by the fs IRQ after the audio source has made the next sample
+static inline __attribute__((always_inline)) void pcm_push(int16_t sample){
+    uint32_t head = pcm_head;
+    if(head - pcm_tail >= PCM_RING_LEN){
+        pcm_lost++;
+        return;
+    }
+    pcm_ring[head & (PCM_RING_LEN-1)] = sample;
+    pcm_head = head + 1;
+}
+
+#endif /* _PCM_H_ */
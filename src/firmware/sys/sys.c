@@ -10,6 +10,7 @@
 #include "sys/dvi.h"
 #include "sys/edid.h"
 #include "sys/lfs.h"
+#include "sys/mem.h"
 #ifdef PIVIC
 #include "vic/aud.h"
 #include "vic/pen.h"
@@ -18,6 +19,7 @@
 #include "vic/cvbs.h"
 #endif
 #ifdef OCULA
+#include "oric/aud.h"
 #include "oric/ula.h"
 #endif
 #include "pico/stdlib.h"
@@ -54,6 +56,7 @@ void sys_mon_status(const char *args, size_t len)
     (void)(len);
     sys_print_status();
     clk_print_status();
+    mem_print_status();
     dvi_print_status();
     lfs_print_status();
 #ifdef PIVIC
@@ -66,6 +69,7 @@ void sys_mon_status(const char *args, size_t len)
 #endif
 #ifdef OCULA
     ula_print_status();
+    aud_print_status();
 #endif
 }
 
@@ -70,7 +70,8 @@ extern "C"
 #define CFG_TUD_VENDOR 0
 
 #define CFG_TUD_CDC_RX_BUFSIZE 64
-#define CFG_TUD_CDC_TX_BUFSIZE 64
+// Room for TRACE STREAM and PCM STREAM to queue data between USB frames
+#define CFG_TUD_CDC_TX_BUFSIZE 1024
 
 #ifndef TUD_OPT_RP2040_USB_DEVICE_UFRAME_FIX
 #define TUD_OPT_RP2040_USB_DEVICE_UFRAME_FIX 1
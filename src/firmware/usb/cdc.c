@@ -13,6 +13,7 @@
 static absolute_time_t break_timer;
 static absolute_time_t faux_break_timer;
 static bool is_breaking = false;
+static bool cdc_stdio_muted = false;
 //static uint8_t read_buf[STD_IN_BUF_SIZE];
 
 static void send_break_ms(uint16_t duration_ms)
@@ -55,7 +56,7 @@ static stdio_driver_t cdc_stdio_app = {
 void cdc_stdio_out_chars(const char *buf, int length)
 {
 
-    if(tud_cdc_connected()){
+    if(tud_cdc_connected() && !cdc_stdio_muted){
         //tuh_cdc_write(i, buf, length);
         
         int sent = 0;
@@ -85,6 +86,11 @@ static int cdc_stdio_in_chars(char *buf, int length)
 }
 
 
+void cdc_stdio_mute(bool mute)
+{
+    cdc_stdio_muted = mute;
+}
+
 void cdc_init(void)
 {
     tud_cdc_configure_fifo_t cfg;
@@ -7,7 +7,11 @@
 #ifndef CDC_H
 #define CDC_H
 
+#include <stdbool.h>
+
 void cdc_init(void);
 void cdc_task(void);
+// Drops stdio output while a binary stream owns the CDC
+void cdc_stdio_mute(bool mute);
 
 #endif
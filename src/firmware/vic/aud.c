@@ -7,7 +7,11 @@
 
 #include "main.h"
 #include "vic/aud.h"
+#include "vic/aud_blep.h"
 #include "vic/aud_splash.h"
+#include "vic/aud_voice.h"
+#include "vic/reg_ring.h"
+#include "vic/vic.h"
 #include "sys/cfg.h"
 #include "sys/dvi_audio.h"
 #include "sys/mem.h"
@@ -15,19 +19,46 @@
 #include "hardware/gpio.h"
 #include "hardware/pwm.h"
 #include "hardware/clocks.h"
+#include "hardware/structs/m33.h"
 #include "pico/multicore.h"
 #include <stdbool.h>
 #include <stdio.h>
 
-//Audio shift registers
-uint8_t aud_noise_sr;    //Ch 0-2 SR are kept in aud_sr
-uint8_t aud_val[4];
-uint16_t aud_lfsr;
-
 volatile aud_union_t aud_counters;
 volatile aud_union_t aud_ticks;
 volatile aud_union_t aud_regs;
 volatile aud_union_t aud_sr;
+volatile uint32_t aud_noise_count;
+
+aud_event_t aud_ev_ring[AUD_EV_RING_LEN];
+volatile uint32_t aud_ev_head;
+volatile uint32_t aud_ev_tail;
+volatile uint32_t aud_ev_lost;
+
+static aud_blep_t aud_blep;
+static volatile uint8_t aud_synth;      //Requested by SET SYNTH
+static uint8_t aud_synth_active;        //In use by the fs callback
+
+//Cost of the fs callback per sample, in sys clocks
+static uint32_t aud_cb_count;
+static uint32_t aud_cb_max;
+static uint64_t aud_cb_sum;
+
+//Noise steps done by aud_task and its cost, in sys clocks
+static uint32_t aud_noise_done;         //aud_noise_count as last stepped
+static uint32_t aud_noise_steps;
+static uint32_t aud_noise_batch_max;
+static uint64_t aud_task_clocks;
+static uint32_t aud_stats_us;
+
+//Event ring as seen by aud_task
+static uint8_t aud_noise_reg;           //CRD in effect for the steps not yet done
+static uint32_t aud_ev_regs;            //Registers after the last event
+static uint32_t aud_ev_lost_seen;
+static uint32_t aud_ev_count;
+static uint32_t aud_ev_hwm;             //Most events waiting at one aud_task
+static uint32_t aud_ev_age_max;         //Longest an event waited, in us
+static uint32_t aud_ev_voice[4];        //Events per voice register
 
 //TODO Unify with/import vic/vic.c/h definitions
 #define VIC_CRA xram[0x100A]
@@ -36,50 +67,48 @@ volatile aud_union_t aud_sr;
 #define VIC_CRD xram[0x100D]
 #define VIC_CRE xram[0x100E]
 
-void aud_calc_voice(uint8_t idx, uint8_t reg){
-    uint8_t enable = reg >> 7;  //Keep enable bit in LSB
-    uint8_t next_bit = aud_sr.ch[idx] & 0x01;
-    aud_val[idx] = (enable ? (next_bit ? 4 : 0) : 1);  //High=4 ,half=1, low=0
-}
-
-void aud_step_noise(uint8_t reg){
-    uint8_t prev = aud_noise_sr;
-    uint8_t enable = reg >> 7;  //Keep enable bit in LSB
-    uint16_t tmp = aud_lfsr;
-    //XOR together LFSR bits 15,14,12,3 to get next LSB, but set to '1' if not channel enabled 
-    uint8_t next_lfsr_bit = ((((tmp >> 3) ^ (tmp >> 12) ^ (tmp >> 14) ^ (tmp >> 15)) | ~enable) & 1u);
-    uint8_t old_lfsr_bit = aud_lfsr & 0x1;
-    aud_lfsr = (tmp << 1) | next_lfsr_bit;
-    //LFSR bit clocks the waveform shift register
-    if(next_lfsr_bit == 1 && old_lfsr_bit == 0){
-        uint8_t next_sr_bit = (~prev >> 7) & enable;    //Shift register MSB & register enable bit
-        aud_noise_sr = (prev << 1) | next_sr_bit;
-        aud_val[3] = (enable ? (next_sr_bit ? 4 : 0) : 1);    //High=3, half=1, low=0. TODO - confirm enable is used to gate the noise channel
-    }
-}
-
 audio_sample_t pwm_sample;
 //volatile audio_sample_t dvi_sample;
 #define LPF_ALPHA 15
 
 void aud_update_pwm(void){
     uint8_t vol = VIC_CRE & 0x0F;
-    uint16_t sample = (uint16_t)( aud_val[0] + aud_val[1] + aud_val[2] + aud_val[3] ) * vol;
-    uint16_t pwm_value = (sample + cfg_get_bias());  //DC offset required for bias of mainboard audio circuit
-    pwm_set_chan_level(AUDIO_PWM_SLICE, AUDIO_PWM_CH, pwm_value);    
+    if(aud_synth_active != aud_synth){
+        //Pick up the voices where the core1 counters are
+        aud_synth_active = aud_synth;
+        aud_blep_seed(&aud_blep, aud_counters.all, aud_ticks.all, aud_regs.all, aud_sr.all, aud_noise_sr, aud_lfsr);
+    }
+    int32_t level;  //Voice sum in Q8
+    if(aud_synth_active == AUD_SYNTH_BLEP)
+        level = aud_blep_render(&aud_blep, &VIC_CRA);
+    else
+        level = (aud_val[0] + aud_val[1] + aud_val[2] + aud_val[3]) << 8;
+    int32_t sample = level * vol;
+    int32_t pwm_value = (sample >> 8) + cfg_get_bias();   //DC offset required for bias of mainboard audio circuit
+    pwm_set_chan_level(AUDIO_PWM_SLICE, AUDIO_PWM_CH, pwm_value < 0 ? 0 : pwm_value);
     // static int16_t lpf_sample;
     // lpf_sample = (LPF_ALPHA * (lpf_sample>>4)) + ((16-LPF_ALPHA) * ((sample<<2)-(vol<<4)));   //Low-pass over 16 values. Boost vol <<2. Subtract DC.
     // //lpf_sample = (lpf_sample - (lpf_sample>>4)) + pwm_value;
     // pwm_sample.left = pwm_sample.right = (int16_t)((lpf_sample));
-    pwm_sample.left = pwm_sample.right = ((int16_t)(sample<<6)-(vol<<8));
+    pwm_sample.left = pwm_sample.right = (int16_t)((sample>>2)-(vol<<8));
 }
 
 void aud_splash_init(void);
 void aud_splash_task(void);
 
 void aud_dvi_audio_fs_cb(void){
+    uint32_t start = m33_hw->dwt_cyccnt;
     aud_update_pwm();
     aud_splash_task();
+    uint32_t cycles = m33_hw->dwt_cyccnt - start;
+    aud_cb_count++;
+    aud_cb_sum += cycles;
+    if(cycles > aud_cb_max)
+        aud_cb_max = cycles;
+}
+
+void aud_set_synth(uint8_t synth){
+    aud_synth = synth;
 }
 
 void aud_init(void){
@@ -93,25 +122,35 @@ void aud_init(void){
     pwm_set_chan_level(AUDIO_PWM_SLICE, AUDIO_PWM_CH, 0);
     pwm_set_enabled(AUDIO_PWM_SLICE, true);
 
-    // Init the three voices to zero
-    for(int i=0; i < 3; i++){
-        aud_sr.ch[i] = 0;
-        aud_val[i] = 0;
-    }
-    // Init noise separately
-    aud_noise_sr = 0x00;
-    aud_val[3] = 0x01;
-    aud_lfsr = 0xFFFF;
+    aud_voice_reset();
 
     //Init tick system
     aud_ticks.all = 0;
 
+    //Band limited synthesis steps the voices by CPU cycles per sample in 16.16
+    uint32_t step = ((uint64_t)dvi_audio_fs_period_x2() << 15) / vic_get_cycle_sys_clocks();
+    aud_blep_init(&aud_blep, step, true);
+    aud_synth_active = AUD_SYNTH_HARD;
+    aud_synth = cfg_get_synth();
+
+    //DWT cycle counter for the fs callback cost, it is per core
+    m33_hw->demcr |= M33_DEMCR_TRCENA_BITS;
+    m33_hw->dwt_ctrl |= M33_DWT_CTRL_CYCCNTENA_BITS;
+
     //VIC audio registers reset values. TODO: should be done central in vic.c?
     VIC_CRA = 0x00;
     VIC_CRB = 0x00;
     VIC_CRC = 0x00;
     VIC_CRD = 0x00;
     VIC_CRE = 0x8;
+    reg_ring_wrote(0x100A, 5);
+
+    aud_noise_done = aud_noise_count;
+    aud_noise_reg = aud_regs.ch[3];
+    aud_ev_regs = aud_regs.all;
+    aud_ev_lost_seen = aud_ev_lost;
+    aud_ev_tail = aud_ev_head;
+    aud_stats_us = time_us_32();
 
     dvi_audio_set_sample_source(&pwm_sample);
     dvi_audio_set_fs_cb(aud_dvi_audio_fs_cb);
@@ -122,16 +161,59 @@ void aud_init(void){
 
 static int64_t last_sample_time_diff;
 static uint32_t lost_samples = 0;
+//Noise overflows up to count in one go, however long core0 was away
+static void aud_noise_to(uint32_t count, uint8_t reg){
+    uint32_t steps = count - aud_noise_done;
+    if((int32_t)steps <= 0)
+        return;
+    aud_noise_done = count;
+    aud_step_noise_n(steps, reg);
+    aud_noise_steps += steps;
+    if(steps > aud_noise_batch_max)
+        aud_noise_batch_max = steps;
+}
+
 // Raw update values are calculated here, final output values are calculated in the irq driven dvi_audio_fs_cb 
 void aud_task(void){
-    while(multicore_fifo_rvalid()){
-        uint32_t upd = sio_hw->fifo_rd;
-        aud_calc_voice(0, aud_regs.ch[0]);
-        aud_calc_voice(1, aud_regs.ch[1]);
-        aud_calc_voice(2, aud_regs.ch[2]);
-        if(upd & 0x08)
-            aud_step_noise(upd >> 24);
+    uint32_t start = m33_hw->dwt_cyccnt;
+    uint32_t count = aud_noise_count;
+    uint32_t now = time_us_32();
+    uint32_t head = aud_ev_head;
+    uint32_t tail = aud_ev_tail;
+    if(head - tail > aud_ev_hwm)
+        aud_ev_hwm = head - tail;
+    __dmb();                            //Entries up to head as core1 wrote them
+    for(; tail != head; tail++){
+        aud_event_t *ev = &aud_ev_ring[tail & (AUD_EV_RING_LEN-1)];
+        uint32_t changed = ev->regs ^ aud_ev_regs;
+        if(changed & 0xFF000000){
+            //The overflow that latched the new CRD still stepped with the old one
+            aud_noise_to(ev->noise_count - 1, aud_noise_reg);
+            aud_noise_reg = ev->regs >> 24;
+        }
+        for(int v = 0; v < 4; v++)
+            if(changed & (0xFFu << (v * 8)))
+                aud_ev_voice[v]++;
+        uint32_t age = now - ev->us;
+        if((int32_t)age > 0 && age > aud_ev_age_max)
+            aud_ev_age_max = age;
+        aud_ev_regs = ev->regs;
+        aud_ev_count++;
+    }
+    __dmb();                            //Entries read before core1 can reuse them
+    aud_ev_tail = tail;
+    //With events dropped the timing of CRD is gone, carry on from the latest latch
+    uint32_t lost = aud_ev_lost;
+    if(lost != aud_ev_lost_seen){
+        aud_ev_lost_seen = lost;
+        aud_ev_regs = aud_regs.all;
+        aud_noise_reg = aud_ev_regs >> 24;
     }
+    aud_calc_voice(0, aud_regs.ch[0]);
+    aud_calc_voice(1, aud_regs.ch[1]);
+    aud_calc_voice(2, aud_regs.ch[2]);
+    aud_noise_to(count, aud_noise_reg);
+    aud_task_clocks += m33_hw->dwt_cyccnt - start;
 }
 
 void aud_print_status(void){
@@ -142,6 +224,30 @@ void aud_print_status(void){
         );
     printf("    tck:%08x cnt:%08x upd:%01x\n", aud_ticks.all, aud_counters.all, sio_hw->doorbell_in_set);
     printf("    pwm intr:%08x cc:%d top:%d\n", pwm_hw->intr, pwm_hw->slice[AUDIO_PWM_SLICE].cc, pwm_hw->slice[AUDIO_PWM_SLICE].top);
+    printf("    synth:%s fs cb avg:%lu max:%lu of %lu sys clocks\n",
+            aud_synth_active == AUD_SYNTH_BLEP ? "blep" : "hard",
+            aud_cb_count ? (uint32_t)(aud_cb_sum / aud_cb_count) : 0, aud_cb_max,
+            dvi_audio_fs_period_x2() / 2);
+    uint32_t now = time_us_32();
+    uint32_t ms = (now - aud_stats_us) / 1000;
+    printf("    noise steps:%lu max batch:%lu task:%lu sys clocks/ms\n",
+            aud_noise_steps, aud_noise_batch_max,
+            ms ? (uint32_t)(aud_task_clocks / ms) : 0);
+    printf("    events:%lu (CRA-CRD %lu %lu %lu %lu) pending max:%lu/%d lost:%lu age max:%lu us\n",
+            aud_ev_count, aud_ev_voice[0], aud_ev_voice[1], aud_ev_voice[2], aud_ev_voice[3],
+            aud_ev_hwm, AUD_EV_RING_LEN, aud_ev_lost, aud_ev_age_max);
+    aud_cb_count = 0;                   //Clear for next status
+    aud_cb_sum = 0;
+    aud_cb_max = 0;
+    aud_noise_steps = 0;
+    aud_noise_batch_max = 0;
+    aud_ev_count = 0;
+    aud_ev_hwm = 0;
+    aud_ev_age_max = 0;
+    for(int v = 0; v < 4; v++)
+        aud_ev_voice[v] = 0;
+    aud_task_clocks = 0;
+    aud_stats_us = now;
     // printf("    last_sample_periode_us: %lld\n", last_sample_time_diff);
     // printf("    DVI lost samples: %d\n", lost_samples);
 }
@@ -153,6 +259,7 @@ void aud_print_status(void){
 bool aud_splash_active;
 void aud_splash_init(void){
     VIC_CRA = AUD_SPLASH_MAGIC;
+    reg_ring_wrote(0x100A, 1);
     aud_splash_active = true;
 }
 
@@ -186,6 +293,7 @@ void aud_splash_task(void){
                     state = attack;
                     break;
             }
+            reg_ring_wrote(0x100C, 1);
             if(VIC_CRA != AUD_SPLASH_MAGIC){
                 aud_splash_active = false;
             }
@@ -9,7 +9,9 @@
  #define _AUD_H_
 
  #include "sys/mem.h"
+ #include "hardware/sync.h"
  #include "pico/multicore.h"
+ #include "pico/stdlib.h"
  #include <stdio.h>
 
 typedef union {
@@ -22,16 +24,57 @@ extern volatile aud_union_t aud_counters;
 extern volatile aud_union_t aud_ticks;
 extern volatile aud_union_t aud_regs;
 extern volatile aud_union_t aud_sr;
+extern volatile uint32_t aud_noise_count;     //Noise counter overflows, free running
+
+//Voice register latches from core1 to aud_task, stamped with the time they
+//were taken at. Replaces the SIO FIFO, which holds 4 words and dropped the
+//rest unseen whenever core0 was held up.
+//Ring size must be power of 2
+#define AUD_EV_RING_LEN_BITS 6
+#define AUD_EV_RING_LEN (1<<AUD_EV_RING_LEN_BITS)
+
+typedef struct {
+    uint32_t us;                //time_us_32 of the latch
+    uint32_t regs;              //aud_regs after the latch
+    uint32_t noise_count;       //aud_noise_count after the latch
+} aud_event_t;
+
+extern aud_event_t aud_ev_ring[AUD_EV_RING_LEN];
+extern volatile uint32_t aud_ev_head;         //Written by core1
+extern volatile uint32_t aud_ev_tail;         //Written by core0
+extern volatile uint32_t aud_ev_lost;         //Latches dropped on a full ring, written by core1
+
+static inline __attribute__((always_inline)) void aud_ev_push(uint32_t regs){
+    uint32_t head = aud_ev_head;
+    if(head - aud_ev_tail >= AUD_EV_RING_LEN){
+        aud_ev_lost++;
+        return;
+    }
+    aud_event_t *ev = &aud_ev_ring[head & (AUD_EV_RING_LEN-1)];
+    ev->us = time_us_32();
+    ev->regs = regs;
+    ev->noise_count = aud_noise_count;
+    __dmb();                                    //Entry visible to core0 before head
+    aud_ev_head = head + 1;
+}
+
+ #define AUD_SYNTH_HARD 0
+ #define AUD_SYNTH_BLEP 1
 
  void aud_init(void);
  void aud_task(void);
+ void aud_set_synth(uint8_t synth);
 
  void aud_print_status(void);
  
  // Per CPU clock tick audio progress
- // Assembly version. Assumes running on other core than aud_task(), uses doorbell signaling
- void inline __attribute__((always_inline)) aud_tick_inline(uint32_t *regs){
+ // Assembly version. Assumes running on other core than aud_task(), passes register latches in aud_ev_ring
+ // Past the asm the noise overflow and register change tests stay in registers
+ static inline __attribute__((always_inline)) void aud_tick_inline(uint32_t *regs){
+    uint32_t latched = aud_regs.all;
+    uint32_t aregs = latched;
     //Running 4 separate tick and channel counters in packed 32 bit words
+#ifdef __arm__
     uint32_t tmp,tmp2,zero,one,upd;
     const uint32_t mask = 0x0103070F;
     //uint32_t *regs = (uint32_t*)(&xram[0x100a]);
@@ -59,7 +102,7 @@ extern volatile aud_union_t aud_sr;
         "sel %[sr], %[sr], %[tmp]\n\t"              //Update SR for channels where counter has overflown
         : [tick] "+r" (aud_ticks.all),
           [cntr] "+r" (aud_counters.all),
-          [aregs]"+r" (aud_regs.all),
+          [aregs]"+r" (aregs),
           [sr]   "+r" (aud_sr.all),
           [tmp]  "=r" (tmp),
           [tmp2] "=r" (tmp2),
@@ -70,7 +113,30 @@ extern volatile aud_union_t aud_sr;
           [regs] "m" (*(uint32_t(*))regs)
         : "cc"                                      //Conditional flags clobbered
     );
+    aud_regs.all = aregs;
+#else
+    //Plain C equivalent of the above for host builds, one byte lane per channel
+    static const uint8_t mask[4] = { 0x0F, 0x07, 0x03, 0x01 };
+    uint32_t upd = 0;
+    for(int i = 0; i < 4; i++){
+        uint8_t reg = ((volatile uint8_t*)regs)[i];
+        aud_ticks.ch[i]++;
+        if((aud_ticks.ch[i] & mask[i]) == 0)
+            aud_counters.ch[i]++;
+        if(aud_counters.ch[i] & 0x80){
+            upd |= 1u << i;
+            aud_regs.ch[i] = reg;
+            aud_counters.ch[i] = ((reg & 0x7F) + 1) & 0x7F;
+            aud_sr.ch[i] = ((aud_sr.ch[i] & 0x7F) << 1) | ((reg & ~aud_sr.ch[i] & 0x80) >> 7);
+        }
+    }
+    aregs = aud_regs.all;
+#endif
     //sio_hw->doorbell_out_set = upd & 0xF;           //Using RP2350 doorbells 0-3 to signal updates needed
-    sio_hw->fifo_wr = (aud_regs.all & 0xFFFFFFF0) | (upd & 0xF);
+    if(__builtin_expect(upd & 8, 0))
+        aud_noise_count++;
+    //Only a new register value at an overflow is an event, the rest aud_task works out from the count
+    if(__builtin_expect(aregs != latched, 0))
+        aud_ev_push(aregs);
 }
  #endif /* _AUD_H_ */
\ No newline at end of file
@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) 2026 Sodiumlightbaby
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "vic/aud_blep.h"
+
+// CPU cycles per counter tick, as the tick masks in aud_tick_inline
+static const uint8_t aud_blep_prescale[AUD_BLEP_VOICES] = { 16, 8, 4, 2 };
+
+// Counter ticks between overflows. The counter reloads with reg+1 and
+// overflows when it reaches 0x80.
+static inline uint32_t aud_blep_period(int v, uint8_t reg){
+    return aud_blep_prescale[v] * (0x80 - ((reg + 1) & 0x7F));
+}
+
+static inline uint8_t aud_blep_level(uint8_t reg, uint8_t bit){
+    return (reg & 0x80) ? (bit ? 4 : 0) : 1;
+}
+
+void aud_blep_init(aud_blep_t *b, uint32_t step, bool blep){
+    for(int v = 0; v < AUD_BLEP_VOICES; v++){
+        b->next[v] = 0;
+        b->latch[v] = 0;
+        b->sr[v] = 0;
+        b->level[v] = v < 3 ? 0 : 1;
+    }
+    b->lfsr = 0xFFFF;
+    b->step = step;
+    b->inv_step = (uint32_t)((1ull << 47) / step);
+    b->naive = 0;
+    b->resid = 0;
+    b->blep = blep;
+}
+
+void aud_blep_seed(aud_blep_t *b, uint32_t counters, uint32_t ticks, uint32_t regs,
+                   uint32_t sr, uint8_t noise_sr, uint16_t lfsr){
+    for(int v = 0; v < AUD_BLEP_VOICES; v++){
+        uint32_t prescale = aud_blep_prescale[v];
+        uint8_t counter = (counters >> (v * 8)) & 0x7F;
+        uint8_t tick = (ticks >> (v * 8)) & (prescale - 1);
+        // Cycles to the next counter increment, then the rest of the increments to 0x80
+        uint32_t cycles = (prescale - tick) + (0x7F - counter) * prescale;
+        b->next[v] = cycles << 16;
+        b->latch[v] = regs >> (v * 8);
+        b->sr[v] = v < 3 ? (uint8_t)(sr >> (v * 8)) : noise_sr;
+        if(v < 3)
+            b->level[v] = aud_blep_level(b->latch[v], b->sr[v] & 1);
+    }
+    b->lfsr = lfsr;
+    b->naive = (b->level[0] + b->level[1] + b->level[2] + b->level[3]) << 8;
+    b->resid = 0;
+}
+
+// Counter overflow of voice v, returns the change in its output level
+static inline int aud_blep_overflow(aud_blep_t *b, int v, uint8_t reg){
+    uint8_t enable = reg >> 7;
+    uint8_t old = b->level[v];
+    b->latch[v] = reg;
+    if(v < 3){
+        b->sr[v] = (b->sr[v] << 1) | ((reg & ~b->sr[v] & 0x80) >> 7);
+        b->level[v] = aud_blep_level(reg, b->sr[v] & 1);
+    }else{
+        // As aud_step_noise, the LFSR rising edge clocks the shift register
+        uint16_t tmp = b->lfsr;
+        uint8_t next_lfsr_bit = ((((tmp >> 3) ^ (tmp >> 12) ^ (tmp >> 14) ^ (tmp >> 15)) | ~enable) & 1u);
+        uint8_t old_lfsr_bit = tmp & 1u;
+        b->lfsr = (tmp << 1) | next_lfsr_bit;
+        if(next_lfsr_bit == 1 && old_lfsr_bit == 0){
+            uint8_t next_sr_bit = (~b->sr[3] >> 7) & enable;
+            b->sr[3] = (b->sr[3] << 1) | next_sr_bit;
+            b->level[3] = aud_blep_level(reg, next_sr_bit);
+        }
+    }
+    return b->level[v] - old;
+}
+
+int32_t aud_blep_render(aud_blep_t *b, const volatile uint8_t *regs){
+    // Residuals of the edges since the last sample, in level x Q15. For a
+    // change d at x samples before this one, the last sample gets d/2 x^2
+    // and this one -d/2 (1-x)^2.
+    int32_t before = 0;
+    int32_t after = 0;
+    uint32_t step = b->step;
+    for(int v = 0; v < AUD_BLEP_VOICES; v++){
+        uint32_t t = b->next[v];
+        if(t >= step){
+            b->next[v] = t - step;
+            continue;
+        }
+        uint8_t reg = regs[v];
+        uint32_t period = aud_blep_period(v, reg) << 16;
+        do{
+            int d = aud_blep_overflow(b, v, reg);
+            if(d && b->blep){
+                int32_t x = (int32_t)(((uint64_t)(step - t) * b->inv_step) >> 32);
+                int32_t y = 32768 - x;
+                before += d * ((x * x) >> 15);
+                after -= d * ((y * y) >> 15);
+            }
+            t += period;
+        }while(t < step);
+        b->next[v] = t - step;
+    }
+    int32_t sum = (b->level[0] + b->level[1] + b->level[2] + b->level[3]) << 8;
+    if(!b->blep)
+        return sum;
+    // Half of level x Q15 to level x Q8
+    int32_t out = b->naive + b->resid + (before >> 8);
+    b->naive = sum;
+    b->resid = after >> 8;
+    return out;
+}
@@ -0,0 +1,45 @@
+/*
+ * Copyright (c) 2026 Sodiumlightbaby
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+// Sample rate model of the VIC voices for band limited output. Runs the same
+// counters, shift registers and LFSR as aud_tick_inline, but steps from one
+// counter overflow to the next instead of every CPU cycle, so each output
+// level change has an exact time within the sample period. With BLEP on the
+// changes are smoothed with a 2 sample polynomial BLEP, which costs one
+// sample of latency. No SDK dependencies, the host tools build it as is.
+
+#ifndef _AUD_BLEP_H_
+#define _AUD_BLEP_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define AUD_BLEP_VOICES 4
+
+typedef struct {
+    uint32_t next[AUD_BLEP_VOICES];     // 16.16 CPU cycles from the last sample to the next overflow
+    uint8_t latch[AUD_BLEP_VOICES];     // Register value reloaded at the last overflow
+    uint8_t sr[AUD_BLEP_VOICES];        // Waveform shift registers, noise in [3]
+    uint8_t level[AUD_BLEP_VOICES];     // Voice output, 0 or 4 when enabled, 1 when not
+    uint16_t lfsr;
+    uint32_t step;                      // 16.16 CPU cycles per sample
+    uint32_t inv_step;                  // 2^47 / step, for the edge position in Q15
+    int32_t naive;                      // Q8 voice sum at the last sample
+    int32_t resid;                      // Q8 BLEP residual carried into the next sample
+    bool blep;
+} aud_blep_t;
+
+void aud_blep_init(aud_blep_t *b, uint32_t step, bool blep);
+
+// Take over the voice state from the aud_tick_inline counters
+void aud_blep_seed(aud_blep_t *b, uint32_t counters, uint32_t ticks, uint32_t regs,
+                   uint32_t sr, uint8_t noise_sr, uint16_t lfsr);
+
+// Advance one sample with the voice registers CRA-CRD in regs[0..3].
+// Returns the sum of the four voices in Q8, 0 to 16 levels plus BLEP overshoot.
+int32_t aud_blep_render(aud_blep_t *b, const volatile uint8_t *regs);
+
+#endif /* _AUD_BLEP_H_ */
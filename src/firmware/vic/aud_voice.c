@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2025 dreamseal
+ * Copyright (c) 2026 Sodiumlightbaby
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "vic/aud.h"
+#include "vic/aud_voice.h"
+#include <stdbool.h>
+
+//Audio shift registers
+uint8_t aud_noise_sr;
+uint8_t aud_val[4];
+uint16_t aud_lfsr;
+
+//LFSR state 16 enabled steps on, the XOR of the entries for its low and high
+//byte. With the feedback forced off the LFSR is linear, so this holds for
+//every state, and the 16 output bits are the new state with the oldest in bit 15.
+static uint16_t aud_lfsr_jump[2][256];
+static bool aud_lfsr_jump_ready;
+
+static void aud_lfsr_jump_init(void){
+    for(int half = 0; half < 2; half++){
+        for(int b = 0; b < 256; b++){
+            uint16_t tmp = b << (half * 8);
+            for(int i = 0; i < 16; i++)
+                tmp = (tmp << 1) | (((tmp >> 3) ^ (tmp >> 12) ^ (tmp >> 14) ^ (tmp >> 15)) & 1u);
+            aud_lfsr_jump[half][b] = tmp;
+        }
+    }
+    aud_lfsr_jump_ready = true;
+}
+
+void aud_voice_reset(void){
+    if(!aud_lfsr_jump_ready)
+        aud_lfsr_jump_init();
+    // Init the three voices to zero
+    for(int i=0; i < 3; i++){
+        aud_sr.ch[i] = 0;
+        aud_val[i] = 0;
+    }
+    // Init noise separately
+    aud_noise_sr = 0x00;
+    aud_val[3] = 0x01;
+    aud_lfsr = 0xFFFF;
+}
+
+void aud_calc_voice(uint8_t idx, uint8_t reg){
+    uint8_t enable = reg >> 7;  //Keep enable bit in LSB
+    uint8_t next_bit = aud_sr.ch[idx] & 0x01;
+    aud_val[idx] = (enable ? (next_bit ? 4 : 0) : 1);  //High=4 ,half=1, low=0
+}
+
+void aud_step_noise(uint8_t reg){
+    uint8_t prev = aud_noise_sr;
+    uint8_t enable = reg >> 7;  //Keep enable bit in LSB
+    uint16_t tmp = aud_lfsr;
+    //XOR together LFSR bits 15,14,12,3 to get next LSB, but set to '1' if not channel enabled 
+    uint8_t next_lfsr_bit = ((((tmp >> 3) ^ (tmp >> 12) ^ (tmp >> 14) ^ (tmp >> 15)) | ~enable) & 1u);
+    uint8_t old_lfsr_bit = aud_lfsr & 0x1;
+    aud_lfsr = (tmp << 1) | next_lfsr_bit;
+    //LFSR bit clocks the waveform shift register
+    if(next_lfsr_bit == 1 && old_lfsr_bit == 0){
+        uint8_t next_sr_bit = (~prev >> 7) & enable;    //Shift register MSB & register enable bit
+        aud_noise_sr = (prev << 1) | next_sr_bit;
+        aud_val[3] = (enable ? (next_sr_bit ? 4 : 0) : 1);    //High=3, half=1, low=0. TODO - confirm enable is used to gate the noise channel
+    }
+}
+
+void aud_step_noise_n(uint32_t steps, uint8_t reg){
+    if(!(reg & 0x80)){
+        //Disabled, ones shift into the LFSR. Once it is all ones nothing changes.
+        while(steps-- && aud_lfsr != 0xFFFF)
+            aud_step_noise(reg);
+        return;
+    }
+    uint16_t lfsr = aud_lfsr;
+    uint32_t clocks = 0;    //LFSR rising edges, each clocks the shift register
+    while(steps >= 16){
+        uint16_t next = aud_lfsr_jump[0][lfsr & 0xFF] ^ aud_lfsr_jump[1][lfsr >> 8];
+        clocks += __builtin_popcount(next & ~((next >> 1) | ((lfsr & 1u) << 15)));
+        lfsr = next;
+        steps -= 16;
+    }
+    while(steps >= 4){
+        //The shortest tap is 4 back, so 4 new bits only depend on the current state
+        uint16_t nib = (lfsr ^ (lfsr >> 9) ^ (lfsr >> 11) ^ (lfsr >> 12)) & 0xF;
+        clocks += __builtin_popcount(nib & ~((nib >> 1) | ((lfsr & 1u) << 3)));
+        lfsr = (lfsr << 4) | nib;
+        steps -= 4;
+    }
+    while(steps--){
+        uint16_t bit = ((lfsr >> 3) ^ (lfsr >> 12) ^ (lfsr >> 14) ^ (lfsr >> 15)) & 1u;
+        clocks += bit & ~lfsr;
+        lfsr = (lfsr << 1) | bit;
+    }
+    aud_lfsr = lfsr;
+    if(!clocks)
+        return;
+    //The shift register feeds back its inverted MSB, so 8 clocks invert it
+    //and 16 bring it back. Fewer than 8 shift in the inverted top bits.
+    uint8_t sr = aud_noise_sr;
+    clocks &= 15;
+    if(clocks >= 8){
+        sr = ~sr;
+        clocks -= 8;
+    }
+    if(clocks)
+        sr = (sr << clocks) | ((uint8_t)~sr >> (8 - clocks));
+    aud_noise_sr = sr;
+    aud_val[3] = (sr & 1) ? 4 : 0;
+}
@@ -0,0 +1,35 @@
+/*
+ * Copyright (c) 2025 dreamseal
+ * Copyright (c) 2026 Sodiumlightbaby
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+// VIC voice output levels and the noise channel LFSR, stepped by aud_task
+// from the aud_tick_inline updates. No SDK dependencies, the host tools
+// build it as is.
+
+#ifndef _AUD_VOICE_H_
+#define _AUD_VOICE_H_
+
+#include <stdint.h>
+
+extern uint8_t aud_noise_sr;    //Ch 0-2 SR are kept in aud_sr
+extern uint8_t aud_val[4];      //Voice output, 0 or 4 when enabled, 1 when not
+extern uint16_t aud_lfsr;
+
+//Also builds the LFSR jump tables on first use
+void aud_voice_reset(void);
+
+//Level of tone voice idx from its shift register and register enable bit
+void aud_calc_voice(uint8_t idx, uint8_t reg);
+
+//One noise counter overflow with the noise register value reg
+void aud_step_noise(uint8_t reg);
+
+//Any number of noise counter overflows with the same register value, same
+//result as calling aud_step_noise steps times. Runs the LFSR 16 steps per
+//table lookup and the shift register by the number of clocks in one go.
+void aud_step_noise_n(uint32_t steps, uint8_t reg);
+
+#endif /* _AUD_VOICE_H_ */
@@ -11,6 +11,7 @@
 #include "vic/cvbs.h"
 #include "vic/cvbs_ntsc.h"
 #include "vic/cvbs_pal.h"
+#include "vic/cvbs_ring.h"
 #include "sys/cfg.h"
 #include "sys/lfs.h"
 #include "sys/mem.h"
@@ -28,10 +29,7 @@
 //We'll use 4 periodes as ca 1uS time unit reference
 
 static uint8_t cvbs_mode;
-uint32_t cvbs_burst_cmd_odd; 
-uint32_t cvbs_burst_cmd_even;
 cvbs_palette_t cvbs_source_palette;
-uint32_t cvbs_palette[8][16];
 
 //Colodore colours, approximated
 uint32_t pal_test_vsync[] = {
@@ -200,6 +198,7 @@ void cvbs_pio_mode_init(void){
    //pio_sm_put(CVBS_PIO, CVBS_SM, 0x84210FFF);    
    pio_sm_exec_wait_blocking(CVBS_PIO, CVBS_SM, pio_encode_jmp(entry));
    pio_sm_set_enabled(CVBS_PIO, CVBS_SM, true);   
+   cvbs_ring_init();
    printf("CVBS mode init done\n");
 }
 
@@ -332,163 +331,6 @@ void cvbs_test_loop_pal(void){
    }
 }
 
-uint8_t cvbs_luma_chroma_to_dac(uint8_t luma, int8_t chroma, bool is_svideo){
-   //Assumes luma is a 5 bit limit and chroma is 3 bit.
-   if(is_svideo){
-      if(chroma < 0){
-         return luma << 2; 
-      }else{
-         return (luma << 2) | (chroma >> 1);
-      }
-   }else{   // 5 bit CVBS DAC
-      return (luma + chroma) << 2;
-   }
-}
-
-uint32_t cvbs_colour_to_pixel_pal(cvbs_colour_t col, bool is_odd, bool is_svideo, uint8_t truncate){
-   uint8_t L0;
-   uint8_t L1;
-   uint8_t delay0;
-   uint8_t delay1;
-   if(is_odd || col.delay == 36){
-      delay0 = col.delay;
-      L0 = cvbs_luma_chroma_to_dac(col.luma, +col.chroma, is_svideo);
-      L1 = cvbs_luma_chroma_to_dac(col.luma, -col.chroma, is_svideo);
-   }else{
-      delay0 = 36 - col.delay;
-      L0 = cvbs_luma_chroma_to_dac(col.luma, -col.chroma, is_svideo);
-      L1 = cvbs_luma_chroma_to_dac(col.luma, +col.chroma, is_svideo);
-   }
-   delay1 = 72 - delay0;
-   if(delay1 > 36){
-      delay1 = 36;
-   }else{
-      delay1 = 6;    //Special value to not output L0 again
-   }
-   return CVBS_CMD_PAL_PIXEL(L0, delay0, L1, delay1, truncate);
-}
-
-uint32_t cvbs_colour_to_burst_pal(cvbs_colour_t col, bool is_odd, bool is_svideo){
-   uint8_t L0;
-   uint8_t L1;
-   uint8_t DC;
-   uint8_t tmp;
-   uint8_t delay;
-   L0 = cvbs_luma_chroma_to_dac(col.luma, +col.chroma, is_svideo);
-   L1 = cvbs_luma_chroma_to_dac(col.luma, -col.chroma, is_svideo);
-   DC = cvbs_luma_chroma_to_dac(col.luma, 0, is_svideo);
-   if(is_odd){
-      delay = col.delay;
-   }else{
-      delay = col.delay + 18;
-   }
-   if(delay > 36){
-      delay -= 36;
-      tmp = L0; L0 = L1; L1 = tmp;  //Swap L0 and L1   delay1 = 36 - delay0;
-   }
-   return CVBS_CMD_PAL_BURST(L0, L1, DC, delay, 0);
-}
-
-uint32_t cvbs_colour_to_pixel_ntsc(cvbs_colour_t col, uint8_t idx, bool is_svideo){
-   uint8_t L0;
-   uint8_t L1;
-   uint8_t tmp;
-   uint8_t delay0;
-   uint8_t delay1;
-   uint32_t cmd;
-   L0 = cvbs_luma_chroma_to_dac(col.luma, +col.chroma, is_svideo);
-   L1 = cvbs_luma_chroma_to_dac(col.luma, -col.chroma, is_svideo);
-   if(idx >= 4){
-      idx -= 4;
-      tmp = L0; L0 = L1; L1 = tmp;  //Swap L0 and L1
-   }
-   delay0 = col.delay + (idx * 11);
-   while(delay0 > 44){
-      delay0 -= 44;
-      tmp = L0; L0 = L1; L1 = tmp;  //Swap L0 and L1
-   }
-   if(delay0 < 3){
-      delay0 = 3;
-   }
-   delay1 = 44;
-   if((delay0 + delay1) >= 77){
-      delay1 = 4;    //Special value to not output L0 again
-   }
-   return CVBS_CMD_PIXEL(L0, delay0, L1, delay1, 0);
-}
-
-uint32_t cvbs_colour_to_burst_ntsc(cvbs_colour_t col, bool is_odd, bool is_svideo){
-   uint8_t L0;
-   uint8_t L1;
-   uint8_t DC;
-   uint8_t tmp;
-   uint8_t delay = col.delay;
-   L0 = cvbs_luma_chroma_to_dac(col.luma, +col.chroma, is_svideo);
-   L1 = cvbs_luma_chroma_to_dac(col.luma, -col.chroma, is_svideo);
-   DC = cvbs_luma_chroma_to_dac(col.luma, 0, is_svideo);
-   if(!is_odd){
-      tmp = L0; L0 = L1; L1 = tmp;  //Swap L0 and L1   delay1 = 36 - delay0;
-   }
-   while(delay > 44){
-      delay -= 44;
-      tmp = L0; L0 = L1; L1 = tmp;  //Swap L0 and L1   delay1 = 36 - delay0;
-   }
-   return CVBS_CMD_BURST(L0, L1, DC, delay, 17);
-}
-
-bool cvbs_calc_palette(uint8_t mode, cvbs_palette_t *src){
-   cvbs_colour_t col;
-   switch(mode){
-      case(VIC_MODE_NTSC_SVIDEO):
-         for(int i=0; i<8; i++){
-            for(int j=0; j<16; j++){
-               col = src->colours[j];
-               cvbs_palette[i][j] = cvbs_colour_to_pixel_ntsc(col,i,true);
-            }
-         }
-         cvbs_burst_cmd_odd  = cvbs_colour_to_burst_ntsc(src->burst, true, true);
-         cvbs_burst_cmd_even = cvbs_colour_to_burst_ntsc(src->burst, false, true);
-         break;
-      case(VIC_MODE_NTSC):
-         for(int i=0; i<8; i++){
-            for(int j=0; j<16; j++){
-               col = src->colours[j];
-               cvbs_palette[i][j] = cvbs_colour_to_pixel_ntsc(col,i,false);
-            }
-         }
-         cvbs_burst_cmd_odd  = cvbs_colour_to_burst_ntsc(src->burst, true, false);
-         cvbs_burst_cmd_even = cvbs_colour_to_burst_ntsc(src->burst, false, false);
-         break;
-      case(VIC_MODE_PAL_SVIDEO):
-         //memcpy(&cvbs_source_palette, &palette_default_pal, sizeof(cvbs_palette_t));
-         for(int i=0; i<16; i++){
-            col = src->colours[i];
-            cvbs_palette[0][i] = cvbs_colour_to_pixel_pal(col,true,true,false);
-            cvbs_palette[1][i] = cvbs_colour_to_pixel_pal(col,false,true,false);
-            cvbs_palette[2][i] = cvbs_colour_to_pixel_pal(col,true,true,true);
-            cvbs_palette[3][i] = cvbs_colour_to_pixel_pal(col,false,true,true);
-         }
-         cvbs_burst_cmd_odd  = cvbs_colour_to_burst_pal(src->burst, true, true);
-         cvbs_burst_cmd_even = cvbs_colour_to_burst_pal(src->burst, false, true);
-         break;
-      case(VIC_MODE_PAL):
-         //memcpy(&cvbs_source_palette, &palette_default_pal, sizeof(cvbs_palette_t));
-         for(int i=0; i<16; i++){
-            col = src->colours[i];
-            cvbs_palette[0][i] = cvbs_colour_to_pixel_pal(col,true,false,false);
-            cvbs_palette[1][i] = cvbs_colour_to_pixel_pal(col,false,false,false);
-            cvbs_palette[2][i] = cvbs_colour_to_pixel_pal(col,true,false,true);
-            cvbs_palette[3][i] = cvbs_colour_to_pixel_pal(col,false,false,true);
-         }
-         cvbs_burst_cmd_odd  = cvbs_colour_to_burst_pal(src->burst, true, false);
-         cvbs_burst_cmd_even = cvbs_colour_to_burst_pal(src->burst, false, false);
-         break;
-      default:
-         return false;
-   }
-   return true;
-}
-
 void cvbs_default_palette(uint8_t mode, const char *path){
    lfs_file_t lfs_file;
    LFS_FILE_CONFIG(lfs_file_config);
@@ -746,6 +588,7 @@ bool active = false;
 void cvbs_print_status(void){
    printf("CVBS FIFO debug:%08x level:%d\n", CVBS_PIO->fdebug, pio_sm_get_tx_fifo_level(CVBS_PIO, (CVBS_SM)));
    CVBS_PIO->fdebug = CVBS_PIO->fdebug;            //Clear FIFO status
+   cvbs_ring_print_status();
 
    printf("Default palettes:\n");
    for(int i=0; i<VIC_MODE_COUNT; i++){
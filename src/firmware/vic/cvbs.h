@@ -37,5 +37,21 @@
    cvbs_colour_t burst;
  } cvbs_palette_t;
 
+ // CVBS command and DVI pixel of one colour side by side, so a single
+ // palette lookup in the VIC loops feeds both outputs.
+ // PAL rows: odd, even, truncated odd, truncated even. NTSC rows: chroma phase.
+ typedef struct cvbs_fused_struct {
+   uint32_t cvbs;
+   uint32_t rgb332;
+ } cvbs_fused_t;
+
+ extern cvbs_fused_t cvbs_fused[8][16];
+ extern const uint8_t cvbs_rgb332[16];
+
+ bool cvbs_calc_palette(uint8_t mode, cvbs_palette_t *src);
+
+ // Fuse the colour index instead of its RGB332 value, for a packed DVI framebuffer
+ void cvbs_set_dvi_index(bool index);
+
  #endif /* _CVBS_H_ */
  
\ No newline at end of file
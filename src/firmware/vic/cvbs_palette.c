@@ -0,0 +1,216 @@
+/*
+* Copyright (c) 2025 Sodiumlightbaby
+*
+* SPDX-License-Identifier: BSD-3-Clause
+*/
+
+// Palette to PIO command calculation. Kept free of hardware dependencies
+// so it can also be built into the host side simulator.
+
+#include "main.h"
+#include "vic/vic.h"
+#include "vic/cvbs.h"
+#include "vic/cvbs_ntsc.h"
+#include "vic/cvbs_pal.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+uint32_t cvbs_burst_cmd_odd; 
+uint32_t cvbs_burst_cmd_even;
+uint32_t cvbs_palette[8][16];
+cvbs_fused_t cvbs_fused[8][16];
+static bool cvbs_fused_index;           //DVI pixels are palette indices, for a packed framebuffer
+
+//For DVI output
+//TODO PAL is currently using NTSC based colours - needs to be adjusted
+const uint8_t cvbs_rgb332[16] = {
+    0x00,   //Black
+    0xff,   //White
+    0x84,   //Red
+    0x9f,   //Cyan
+    0x66,   //Purple
+    0x75,   //Green
+    0x22,   //Blue
+    0xfd,   //Yellow
+    0x88,   //Orange
+    0xfa,   //LOrange
+    0xd2,   //Pink
+    0xdf,   //LCyan
+    0xf7,   //LPurple
+    0xbe,   //LGreen
+    0xb7,   //LBlue
+    0xfe    //LYellow
+};
+
+uint8_t cvbs_luma_chroma_to_dac(uint8_t luma, int8_t chroma, bool is_svideo){
+   //Assumes luma is a 5 bit limit and chroma is 3 bit.
+   if(is_svideo){
+      if(chroma < 0){
+         return luma << 2; 
+      }else{
+         return (luma << 2) | (chroma >> 1);
+      }
+   }else{   // 5 bit CVBS DAC
+      return (luma + chroma) << 2;
+   }
+}
+
+uint32_t cvbs_colour_to_pixel_pal(cvbs_colour_t col, bool is_odd, bool is_svideo, uint8_t truncate){
+   uint8_t L0;
+   uint8_t L1;
+   uint8_t delay0;
+   uint8_t delay1;
+   if(is_odd || col.delay == 36){
+      delay0 = col.delay;
+      L0 = cvbs_luma_chroma_to_dac(col.luma, +col.chroma, is_svideo);
+      L1 = cvbs_luma_chroma_to_dac(col.luma, -col.chroma, is_svideo);
+   }else{
+      delay0 = 36 - col.delay;
+      L0 = cvbs_luma_chroma_to_dac(col.luma, -col.chroma, is_svideo);
+      L1 = cvbs_luma_chroma_to_dac(col.luma, +col.chroma, is_svideo);
+   }
+   delay1 = 72 - delay0;
+   if(delay1 > 36){
+      delay1 = 36;
+   }else{
+      delay1 = 6;    //Special value to not output L0 again
+   }
+   return CVBS_CMD_PAL_PIXEL(L0, delay0, L1, delay1, truncate);
+}
+
+uint32_t cvbs_colour_to_burst_pal(cvbs_colour_t col, bool is_odd, bool is_svideo){
+   uint8_t L0;
+   uint8_t L1;
+   uint8_t DC;
+   uint8_t tmp;
+   uint8_t delay;
+   L0 = cvbs_luma_chroma_to_dac(col.luma, +col.chroma, is_svideo);
+   L1 = cvbs_luma_chroma_to_dac(col.luma, -col.chroma, is_svideo);
+   DC = cvbs_luma_chroma_to_dac(col.luma, 0, is_svideo);
+   if(is_odd){
+      delay = col.delay;
+   }else{
+      delay = col.delay + 18;
+   }
+   if(delay > 36){
+      delay -= 36;
+      tmp = L0; L0 = L1; L1 = tmp;  //Swap L0 and L1   delay1 = 36 - delay0;
+   }
+   return CVBS_CMD_PAL_BURST(L0, L1, DC, delay, 0);
+}
+
+uint32_t cvbs_colour_to_pixel_ntsc(cvbs_colour_t col, uint8_t idx, bool is_svideo){
+   uint8_t L0;
+   uint8_t L1;
+   uint8_t tmp;
+   uint8_t delay0;
+   uint8_t delay1;
+   uint32_t cmd;
+   L0 = cvbs_luma_chroma_to_dac(col.luma, +col.chroma, is_svideo);
+   L1 = cvbs_luma_chroma_to_dac(col.luma, -col.chroma, is_svideo);
+   if(idx >= 4){
+      idx -= 4;
+      tmp = L0; L0 = L1; L1 = tmp;  //Swap L0 and L1
+   }
+   delay0 = col.delay + (idx * 11);
+   while(delay0 > 44){
+      delay0 -= 44;
+      tmp = L0; L0 = L1; L1 = tmp;  //Swap L0 and L1
+   }
+   if(delay0 < 3){
+      delay0 = 3;
+   }
+   delay1 = 44;
+   if((delay0 + delay1) >= 77){
+      delay1 = 4;    //Special value to not output L0 again
+   }
+   return CVBS_CMD_PIXEL(L0, delay0, L1, delay1, 0);
+}
+
+uint32_t cvbs_colour_to_burst_ntsc(cvbs_colour_t col, bool is_odd, bool is_svideo){
+   uint8_t L0;
+   uint8_t L1;
+   uint8_t DC;
+   uint8_t tmp;
+   uint8_t delay = col.delay;
+   L0 = cvbs_luma_chroma_to_dac(col.luma, +col.chroma, is_svideo);
+   L1 = cvbs_luma_chroma_to_dac(col.luma, -col.chroma, is_svideo);
+   DC = cvbs_luma_chroma_to_dac(col.luma, 0, is_svideo);
+   if(!is_odd){
+      tmp = L0; L0 = L1; L1 = tmp;  //Swap L0 and L1   delay1 = 36 - delay0;
+   }
+   while(delay > 44){
+      delay -= 44;
+      tmp = L0; L0 = L1; L1 = tmp;  //Swap L0 and L1   delay1 = 36 - delay0;
+   }
+   return CVBS_CMD_BURST(L0, L1, DC, delay, 17);
+}
+
+//Pairs each CVBS command with its DVI pixel for the VIC loops
+static void cvbs_calc_fused(void){
+   for(int i=0; i<8; i++){
+      for(int j=0; j<16; j++){
+         cvbs_fused[i][j].cvbs = cvbs_palette[i][j];
+         cvbs_fused[i][j].rgb332 = cvbs_fused_index ? j : cvbs_rgb332[j];
+      }
+   }
+}
+
+void cvbs_set_dvi_index(bool index){
+   cvbs_fused_index = index;
+   cvbs_calc_fused();
+}
+
+bool cvbs_calc_palette(uint8_t mode, cvbs_palette_t *src){
+   cvbs_colour_t col;
+   switch(mode){
+      case(VIC_MODE_NTSC_SVIDEO):
+         for(int i=0; i<8; i++){
+            for(int j=0; j<16; j++){
+               col = src->colours[j];
+               cvbs_palette[i][j] = cvbs_colour_to_pixel_ntsc(col,i,true);
+            }
+         }
+         cvbs_burst_cmd_odd  = cvbs_colour_to_burst_ntsc(src->burst, true, true);
+         cvbs_burst_cmd_even = cvbs_colour_to_burst_ntsc(src->burst, false, true);
+         break;
+      case(VIC_MODE_NTSC):
+         for(int i=0; i<8; i++){
+            for(int j=0; j<16; j++){
+               col = src->colours[j];
+               cvbs_palette[i][j] = cvbs_colour_to_pixel_ntsc(col,i,false);
+            }
+         }
+         cvbs_burst_cmd_odd  = cvbs_colour_to_burst_ntsc(src->burst, true, false);
+         cvbs_burst_cmd_even = cvbs_colour_to_burst_ntsc(src->burst, false, false);
+         break;
+      case(VIC_MODE_PAL_SVIDEO):
+         //memcpy(&cvbs_source_palette, &palette_default_pal, sizeof(cvbs_palette_t));
+         for(int i=0; i<16; i++){
+            col = src->colours[i];
+            cvbs_palette[0][i] = cvbs_colour_to_pixel_pal(col,true,true,false);
+            cvbs_palette[1][i] = cvbs_colour_to_pixel_pal(col,false,true,false);
+            cvbs_palette[2][i] = cvbs_colour_to_pixel_pal(col,true,true,true);
+            cvbs_palette[3][i] = cvbs_colour_to_pixel_pal(col,false,true,true);
+         }
+         cvbs_burst_cmd_odd  = cvbs_colour_to_burst_pal(src->burst, true, true);
+         cvbs_burst_cmd_even = cvbs_colour_to_burst_pal(src->burst, false, true);
+         break;
+      case(VIC_MODE_PAL):
+         //memcpy(&cvbs_source_palette, &palette_default_pal, sizeof(cvbs_palette_t));
+         for(int i=0; i<16; i++){
+            col = src->colours[i];
+            cvbs_palette[0][i] = cvbs_colour_to_pixel_pal(col,true,false,false);
+            cvbs_palette[1][i] = cvbs_colour_to_pixel_pal(col,false,false,false);
+            cvbs_palette[2][i] = cvbs_colour_to_pixel_pal(col,true,false,true);
+            cvbs_palette[3][i] = cvbs_colour_to_pixel_pal(col,false,false,true);
+         }
+         cvbs_burst_cmd_odd  = cvbs_colour_to_burst_pal(src->burst, true, false);
+         cvbs_burst_cmd_even = cvbs_colour_to_burst_pal(src->burst, false, false);
+         break;
+      default:
+         return false;
+   }
+   cvbs_calc_fused();
+   return true;
+}
@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2026 Sodiumlightbaby
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "main.h"
+#include "vic/cvbs_ring.h"
+#include "hardware/dma.h"
+#include "hardware/pio.h"
+#include <stdio.h>
+
+uint32_t cvbs_ring[CVBS_RING_LEN] __attribute__ ((aligned(CVBS_RING_SIZE)));
+
+dma_channel_hw_t *cvbs_ring_chan;
+uint32_t cvbs_ring_tail;
+uint32_t cvbs_ring_hwm;
+uint32_t cvbs_ring_deferred;
+uint32_t cvbs_ring_overruns;
+
+static int cvbs_ring_chan_idx = -1;
+
+//Called after the CVBS SM is set up, before core1 starts the VIC loop
+void cvbs_ring_init(void){
+    if(cvbs_ring_chan_idx < 0){
+        cvbs_ring_chan_idx = dma_claim_unused_channel(true);
+    }
+    dma_channel_abort(cvbs_ring_chan_idx);
+    dma_channel_config c = dma_channel_get_default_config(cvbs_ring_chan_idx);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, false);
+    channel_config_set_ring(&c, false, CVBS_RING_SIZE_BITS);
+    channel_config_set_dreq(&c, pio_get_dreq(CVBS_PIO, CVBS_SM, true));
+    dma_channel_configure(
+        cvbs_ring_chan_idx,
+        &c,
+        &CVBS_PIO->txf[CVBS_SM],
+        cvbs_ring,
+        0,
+        false
+    );
+    cvbs_ring_chan = dma_channel_hw_addr(cvbs_ring_chan_idx);
+    cvbs_ring_tail = 0;
+    cvbs_ring_hwm = 0;
+    cvbs_ring_deferred = 0;
+    cvbs_ring_overruns = 0;
+}
+
+//Stop the DMA and restart it at head, dropping the words still queued
+void cvbs_ring_resync(uint32_t head){
+    dma_channel_abort(cvbs_ring_chan_idx);
+    cvbs_ring_chan->read_addr = (uintptr_t)&cvbs_ring[head & (CVBS_RING_LEN-1)];
+    cvbs_ring_tail = head;
+    cvbs_ring_overruns++;
+}
+
+void cvbs_ring_print_status(void){
+    printf("CVBS ring %d words, pending max:%lu deferred:%lu overruns:%lu\n",
+           CVBS_RING_LEN, cvbs_ring_hwm, cvbs_ring_deferred, cvbs_ring_overruns);
+    cvbs_ring_hwm = 0;                  //Clear for next status
+    cvbs_ring_deferred = 0;
+    cvbs_ring_overruns = 0;
+}
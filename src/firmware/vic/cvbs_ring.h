@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2026 Sodiumlightbaby
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+// CVBS command ring. The core1 loops write command words into a ring in
+// SRAM and a DMA channel paced by the CVBS SM TX DREQ drains it into the
+// PIO, so a full TX FIFO stalls the DMA instead of core1.
+
+#ifndef _CVBS_RING_H_
+#define _CVBS_RING_H_
+
+#include "hardware/dma.h"
+#include <stdint.h>
+
+//Ring size must be power of 2
+//Alignment for DMA read ring wrap
+#define CVBS_RING_LEN_BITS 8
+#define CVBS_RING_LEN (1<<CVBS_RING_LEN_BITS)
+#define CVBS_RING_SIZE_BITS (CVBS_RING_LEN_BITS+2)
+#define CVBS_RING_SIZE (1<<CVBS_RING_SIZE_BITS)
+//Most words one F1 cycle puts, with margin. The loops put up to 5.
+#define CVBS_RING_CYCLE_MAX 16
+
+extern uint32_t cvbs_ring[CVBS_RING_LEN];
+extern dma_channel_hw_t *cvbs_ring_chan;
+extern uint32_t cvbs_ring_tail;        //Words handed to the DMA
+extern uint32_t cvbs_ring_hwm;         //Most words waiting for the DMA at one flush
+extern uint32_t cvbs_ring_deferred;    //Flushes skipped because the DMA was still busy
+extern uint32_t cvbs_ring_overruns;    //Resyncs that dropped queued words
+
+void cvbs_ring_init(void);
+void cvbs_ring_print_status(void);
+void cvbs_ring_resync(uint32_t head);
+
+//Core1 loops keep the ring head in a local "cvbs_head" so it stays in a register
+#define CVBS_RING_PUT(cmd) (cvbs_ring[cvbs_head++ & (CVBS_RING_LEN-1)] = (cmd))
+
+//Hand everything written since the last flush to the DMA. Called once per F1 cycle.
+//If the previous batch is still draining the words stay queued for the next cycle,
+//unless the next cycle's words could lap ones the DMA hasn't read. Then the queued
+//words are dropped by cvbs_ring_resync rather than sent stale.
+static inline __attribute__((always_inline)) void cvbs_ring_flush(uint32_t head){
+    uint32_t pending = head - cvbs_ring_tail;
+    if(pending > cvbs_ring_hwm)
+        cvbs_ring_hwm = pending;
+    if(pending){
+        if(cvbs_ring_chan->al1_ctrl & DMA_CH0_CTRL_TRIG_BUSY_BITS){
+            cvbs_ring_deferred++;
+            if(pending + cvbs_ring_chan->transfer_count > CVBS_RING_LEN - CVBS_RING_CYCLE_MAX)
+                cvbs_ring_resync(head);
+        }else if(pending > CVBS_RING_LEN){
+            cvbs_ring_resync(head);
+        }else{
+            __compiler_memory_barrier();
+            cvbs_ring_chan->al1_transfer_count_trig = pending;
+            cvbs_ring_tail = head;
+        }
+    }
+}
+
+#endif /* _CVBS_RING_H_ */
@@ -0,0 +1,150 @@
+/*
+ * Copyright (c) 2026 Sodiumlightbaby
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "main.h"
+#include "str.h"
+#include "sys/cfg.h"
+#include "vic/heat.h"
+#include "vic/mem.h"
+#include "vic/trace.h"
+#include "vic/vic.h"
+#include "pico/stdlib.h"
+#include "hardware/dma.h"
+#include <stdio.h>
+#include <string.h>
+
+#define HEAT_TASK_WORDS 2048    // Ring words counted per heat_task call
+#define HEAT_LAG_MAX    (TRACE_RING_WORDS * 3 / 4)
+#define HEAT_GAP_US     5000    // The ring holds ~7ms of CPU cycles
+
+heat_stats_t heat_stats;
+
+static bool heat_on;
+static uint32_t heat_tail;              // Next ring word to count
+static uint32_t heat_task_us;
+static uint32_t heat_mark_count;
+static uint32_t heat_mark;              // Ring index of the next frame start
+static bool heat_mark_pending;
+static bool heat_synced;                // A frame start has been seen since the last gap
+static uint32_t heat_line_cycle;        // Cycles since the frame start
+static uint8_t heat_line_cycles;        // CPU cycles per raster line
+
+static void heat_count(uint32_t word){
+    uint16_t addr = word & 0x3FFF;
+    if(word & (1u << 14)){
+        heat_stats.reads[addr >> 10]++;
+        return;
+    }
+    heat_stats.writes[addr >> 10]++;
+    // VIC chip select, see vic.h
+    if((addr & 0x3F00) != 0x1000)
+        return;
+    heat_stats.reg_writes[addr & 0xF]++;
+    if(heat_synced){
+        uint32_t line = heat_line_cycle / heat_line_cycles;
+        if(line < HEAT_LINES)
+            heat_stats.line_writes[line]++;
+    }
+}
+
+void heat_task(void){
+    if(!heat_on)
+        return;
+    uint32_t now = time_us_32();
+    uint32_t head = trace_ring_index(dma_channel_hw_addr(trace_dma_chan)->write_addr);
+    uint32_t lag = (head - heat_tail) & (TRACE_RING_WORDS - 1);
+    if(now - heat_task_us > HEAT_GAP_US || lag > HEAT_LAG_MAX){
+        // Lapped or falling behind. Restart at the head and wait for the
+        // next frame start to place raster lines again.
+        if(now - heat_task_us > HEAT_GAP_US)
+            heat_stats.gaps++;
+        else
+            heat_stats.lost += lag;
+        heat_tail = head;
+        heat_synced = false;
+        lag = 0;
+    }
+    heat_task_us = now;
+
+    uint32_t count = trace_frame_count;
+    if(count != heat_mark_count){
+        heat_mark_count = count;
+        heat_mark = trace_ring_index(trace_frame_addr);
+        heat_mark_pending = ((heat_mark - heat_tail) & (TRACE_RING_WORDS - 1)) <= lag;
+    }
+
+    for(uint32_t i = 0; i < HEAT_TASK_WORDS && heat_tail != head; i++){
+        if(heat_mark_pending && heat_tail == heat_mark){
+            heat_line_cycle = 0;
+            heat_synced = true;
+            heat_mark_pending = false;
+        }
+        heat_count(TRACE_BUF[heat_tail]);
+        heat_tail = (heat_tail + 1) & (TRACE_RING_WORDS - 1);
+        heat_line_cycle++;
+        heat_stats.cycles++;
+    }
+}
+
+static void heat_start(void){
+    uint8_t mode = cfg_get_mode();
+    heat_line_cycles = (mode == VIC_MODE_PAL || mode == VIC_MODE_PAL_SVIDEO) ? 71 : 65;
+    trace_capture(TRACE_USER_HEAT, true);
+    heat_tail = trace_ring_index(dma_channel_hw_addr(trace_dma_chan)->write_addr);
+    heat_mark_count = trace_frame_count;
+    heat_mark_pending = false;
+    heat_synced = false;
+    heat_task_us = time_us_32();
+    heat_on = true;
+}
+
+static void heat_print(void){
+    printf("Heat %s, %lu cycles, %lu lost, %lu gaps\n", heat_on ? "on" : "off",
+           heat_stats.cycles, heat_stats.lost, heat_stats.gaps);
+    // In VIC-20 address order, VIC $2000-$3FFF is $0000-$1FFF
+    printf("Address         Reads     Writes\n");
+    for(int i = 0; i < HEAT_PAGES; i++){
+        int page = (i + HEAT_PAGES / 2) % HEAT_PAGES;
+        uint16_t cpu = ((page << 10) & 0x1FFF) | (page < HEAT_PAGES / 2 ? 0x8000 : 0);
+        printf("$%04X-$%04X %10lu %10lu\n", cpu, cpu + 0x3FF,
+               heat_stats.reads[page], heat_stats.writes[page]);
+    }
+    printf("VIC register writes\n");
+    for(int i = 0; i < 16; i++)
+        printf("$90%02X %-9lu%s", i, heat_stats.reg_writes[i], (i & 3) == 3 ? "\n" : "");
+    printf("VIC register writes by raster line\n");
+    int n = 0;
+    for(int i = 0; i < HEAT_LINES; i++)
+        if(heat_stats.line_writes[i])
+            printf("%3d:%-8lu%s", i, heat_stats.line_writes[i], (++n & 7) ? "" : "\n");
+    if(n & 7)
+        printf("\n");
+}
+
+void heat_mon_heat(const char *args, size_t len){
+    if(!len){
+        heat_print();
+        return;
+    }
+    if(!strnicmp(args, "on", len)){
+        if(!heat_on)
+            heat_start();
+        return;
+    }
+    if(!strnicmp(args, "off", len)){
+        if(heat_on){
+            heat_on = false;
+            trace_capture(TRACE_USER_HEAT, false);
+        }
+        return;
+    }
+    if(!strnicmp(args, "reset", len)){
+        memset(&heat_stats, 0, sizeof(heat_stats));
+        heat_synced = false;
+        return;
+    }
+    printf("?invalid argument\n");
+}
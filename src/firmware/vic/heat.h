@@ -0,0 +1,34 @@
+/*
+ * Copyright (c) 2026 Sodiumlightbaby
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef _HEAT_H_
+#define _HEAT_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Bus activity counters fed from the trace ring: reads and writes per 1KB
+// page of the VIC address space, and VIC register writes per register and
+// per raster line. Lines are counted from the VC reset frame mark.
+#define HEAT_PAGES 16
+#define HEAT_LINES 312
+
+typedef struct {
+    uint32_t reads[HEAT_PAGES];
+    uint32_t writes[HEAT_PAGES];
+    uint32_t reg_writes[16];
+    uint32_t line_writes[HEAT_LINES];
+    uint32_t cycles;
+    uint32_t lost;              // Cycles skipped while behind the ring
+    uint32_t gaps;              // Times the ring may have lapped
+} heat_stats_t;
+
+extern heat_stats_t heat_stats;
+
+void heat_task(void);
+void heat_mon_heat(const char *args, size_t len);
+
+#endif /* _HEAT_H_ */
@@ -194,36 +194,28 @@ void xwrite_pio_init(void){
         true);  
 }
 
-#define TRACE_BUF &xram[0x10000]
 int trace_dma_chan;
+static uint trace_offset;
 void trace_pio_init(void){
-    pio_set_gpio_base (TRACE_PIO, TRACE_PIN_OFFS);
-
-    uint offset = pio_add_program(TRACE_PIO, &trace_program);
-    pio_sm_config config = trace_program_get_default_config(offset);
-    //Pin counts and autopush/autopull set in program
-    sm_config_set_in_pin_base(&config, DATA_PIN_BASE);  
-    pio_sm_init(TRACE_PIO, TRACE_SM, offset, &config);
-    //pio_sm_set_enabled(TRACE_PIO, TRACE_SM, true);
-
-    // Set up two DMA channels for fetching address then data
+    // Only the DMA ring is set up here. The trace program is swapped in for
+    // xuncon while tracing, see mem_trace_start
     int trace_chan = dma_claim_unused_channel(true);
     trace_dma_chan = trace_chan;
 
-    // DMA move the requested memory data to PIO for output
+    // DMA move the captured bus words from PIO into the trace ring
     dma_channel_config trace_dma = dma_channel_get_default_config(trace_chan);
     channel_config_set_high_priority(&trace_dma, true);
     channel_config_set_dreq(&trace_dma, pio_get_dreq(TRACE_PIO, TRACE_SM, false));
     channel_config_set_read_increment(&trace_dma, false);
     channel_config_set_write_increment(&trace_dma, true);
-    channel_config_set_ring(&trace_dma, true, 12);
+    channel_config_set_ring(&trace_dma, true, TRACE_RING_BITS);
     dma_channel_configure(
         trace_chan,
         &trace_dma,
         TRACE_BUF,                        // dst
         &TRACE_PIO->rxf[TRACE_SM],        // src
         0xf0001000,                       // continuous
-        true);    
+        false);
 }
 
 void xdir_pio_init(void){
@@ -241,12 +233,35 @@ void xdir_pio_init(void){
     //pio_sm_set_enabled(XDIR_PIO, XDIR_SM, true);   
 }
 
+static uint xuncon_offset;
 void xuncon_pio_init(void){
     pio_set_gpio_base (XUNCON_PIO, XUNCON_PIN_OFFS);
-    uint offset = pio_add_program(XUNCON_PIO, &xuncon_program);
-    pio_sm_config config = xuncon_program_get_default_config(offset);
+    xuncon_offset = pio_add_program(XUNCON_PIO, &xuncon_program);
+    pio_sm_config config = xuncon_program_get_default_config(xuncon_offset);
     sm_config_set_in_pin_base(&config, DATA_PIN_BASE);
-    pio_sm_init(XUNCON_PIO, XUNCON_SM, offset, &config);
+    pio_sm_init(XUNCON_PIO, XUNCON_SM, xuncon_offset, &config);
+}
+
+// The trace and xuncon programs share SM and instruction memory, pio2 is full.
+// Unconnected memory reads by the VIC see a stale value while tracing.
+void mem_trace_start(void){
+    pio_sm_set_enabled(XUNCON_PIO, XUNCON_SM, false);
+    pio_remove_program(XUNCON_PIO, &xuncon_program, xuncon_offset);
+    trace_offset = pio_add_program(TRACE_PIO, &trace_program);
+    pio_sm_config config = trace_program_get_default_config(trace_offset);
+    //Pin counts and autopush set in program
+    sm_config_set_in_pin_base(&config, DATA_PIN_BASE);
+    pio_sm_init(TRACE_PIO, TRACE_SM, trace_offset, &config);
+    dma_channel_set_write_addr(trace_dma_chan, TRACE_BUF, true);
+    pio_sm_set_enabled(TRACE_PIO, TRACE_SM, true);
+}
+
+void mem_trace_stop(void){
+    pio_sm_set_enabled(TRACE_PIO, TRACE_SM, false);
+    dma_channel_abort(trace_dma_chan);
+    pio_remove_program(TRACE_PIO, &trace_program, trace_offset);
+    xuncon_pio_init();
+    pio_sm_set_enabled(XUNCON_PIO, XUNCON_SM, true);
 }
 
 void mem_init(void){
@@ -259,10 +274,10 @@ void mem_init(void){
     xdir_pio_init();
     xwrite_pio_init();
     xuncon_pio_init();
-    //trace_pio_init();    
+    trace_pio_init();
     //Synchronized start of irq dependent PIO programs
     pio_set_sm_mask_enabled(XREAD_MASK_PIO, (1u << XREAD_MASK_SM) | (1u << XWRITE_MASK_SM), true);
-    pio_set_sm_mask_enabled(XREAD_PIO, (1u << XREAD_SM) | (1u << XDIR_SM) | (1u << XWRITE_SM) | (1u << XUNCON_SM) /*| (1u << TRACE_SM)*/, true);
+    pio_set_sm_mask_enabled(XREAD_PIO, (1u << XREAD_SM) | (1u << XDIR_SM) | (1u << XWRITE_SM) | (1u << XUNCON_SM), true);
 }
 
 void mem_task(void){
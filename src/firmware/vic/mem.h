@@ -7,7 +7,27 @@
 #ifndef _VIC_MEM_H_
 #define _VIC_MEM_H_
 
+#include "sys/mem.h"
+
+// Bus trace ring in xram, written by DMA with one word per CPU cycle.
+// Must be aligned to its size for the DMA ring wrap, and the DMA ring
+// is at most 32KB (RING_SIZE 15).
+#define TRACE_RING_BITS 15
+#define TRACE_RING_WORDS ((1u << TRACE_RING_BITS) / sizeof(uint32_t))
+#define TRACE_BUF ((volatile uint32_t *)&xram[XRAM_TRACE_START])
+
+// Ring word index of a DMA write address
+static inline uint32_t trace_ring_index(uint32_t addr){
+    return ((addr - (uintptr_t)TRACE_BUF) / sizeof(uint32_t)) & (TRACE_RING_WORDS - 1);
+}
+
+extern int trace_dma_chan;
+
 void mem_init(void);
 void mem_task(void);
 
+// Swap the trace program in for xuncon, and back
+void mem_trace_start(void);
+void mem_trace_stop(void);
+
 #endif /* _VIC_MEM_H_ */
\ No newline at end of file
@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2026 Sodiumlightbaby
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "main.h"
+#include "str.h"
+#include "vic/prof.h"
+#include "vic/vic.h"
+#include <stdio.h>
+#include <string.h>
+
+prof_stats_t prof_stats;
+
+#ifdef VIC_PROFILE
+static const char *const prof_fetch_names[PROF_FETCH_COUNT] = {
+    "OUTSIDE", "IN_Y", "IN_X", "LINE", "DLY_1", "DLY_2", "DLY_3",
+    "SCREEN", "CHAR", "END" };
+#endif
+
+void prof_set_budget(uint32_t sys_cycles){
+    prof_stats.budget = sys_cycles;
+}
+
+void prof_clear(void){
+    memset(prof_stats.hc, 0, sizeof(prof_stats.hc));
+    memset(prof_stats.fetch, 0, sizeof(prof_stats.fetch));
+    for(int i = 0; i < PROF_HC_COUNT; i++)
+        prof_stats.hc[i].min = 0xFFFF;
+    for(int i = 0; i < PROF_FETCH_COUNT; i++)
+        prof_stats.fetch[i].min = 0xFFFF;
+    prof_stats.reset = false;
+}
+
+// The DWT is per core, so this has to run on core1 before the loop starts
+void prof_core1_init(void){
+#ifdef VIC_PROFILE
+    m33_hw->demcr |= M33_DEMCR_TRCENA_BITS;
+    m33_hw->dwt_cyccnt = 0;
+    m33_hw->dwt_ctrl |= M33_DWT_CTRL_CYCCNTENA_BITS;
+    prof_clear();
+#endif
+}
+
+#ifdef VIC_PROFILE
+static void prof_print_entry(const char *label, const prof_entry_t *e){
+    printf("%-8s %9lu %4u %4u %4lu %6lu", label, e->count, e->min, e->max,
+           (uint32_t)(e->sum / e->count), e->late);
+    for(int i = 0; i < PROF_HIST_BINS; i++)
+        printf(" %lu", e->hist[i]);
+    printf("\n");
+}
+
+void prof_mon_profile(const char *args, size_t len){
+    if(len){
+        if(!strnicmp(args, "reset", len)){
+            prof_stats.reset = true;
+            return;
+        }
+        printf("?invalid argument\n");
+        return;
+    }
+    printf("Cycle budget %lu sys clocks per F1, histogram bins of %d\n", prof_stats.budget, 1 << PROF_HIST_SHIFT);
+    printf("HC          count  min  max  avg   late histogram\n");
+    char label[12];
+    for(int i = 0; i < PROF_HC_COUNT; i++){
+        if(!prof_stats.hc[i].count)
+            continue;
+        snprintf(label, sizeof(label), "%d", i);
+        prof_print_entry(label, &prof_stats.hc[i]);
+    }
+    printf("Fetch state\n");
+    for(int i = 0; i < PROF_FETCH_COUNT; i++){
+        if(!prof_stats.fetch[i].count)
+            continue;
+        prof_print_entry(prof_fetch_names[i], &prof_stats.fetch[i]);
+    }
+}
+#else
+void prof_mon_profile(const char *args, size_t len){
+    (void)args;
+    (void)len;
+    printf("?profiler not built, configure with -DPIVIC_PROFILE=ON\n");
+}
+#endif
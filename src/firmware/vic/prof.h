@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2026 Sodiumlightbaby
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef _PROF_H_
+#define _PROF_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Cycle budget profiler for the VIC core1 loops. Opt-in with the
+// PIVIC_PROFILE CMake option, which defines VIC_PROFILE. Each F1 cycle is
+// timed with the DWT cycle counter from the IRQ 1 clear to the end of the
+// loop body and accounted to the HC value and fetchState it started with.
+
+#define PROF_HC_COUNT    72     // PAL HC 0-70, NTSC HC 0-64
+#define PROF_FETCH_COUNT 10     // FETCH_OUTSIDE_MATRIX..FETCH_MATRIX_END
+#define PROF_HIST_SHIFT  5      // Histogram bins of 32 sys cycles
+#define PROF_HIST_BINS   10     // Last bin is 288 cycles and above
+
+typedef struct {
+    uint32_t count;
+    uint32_t late;              // IRQ 1 was already pending at the end of the cycle
+    uint16_t min;
+    uint16_t max;
+    uint64_t sum;
+    uint32_t hist[PROF_HIST_BINS];
+} prof_entry_t;
+
+typedef struct {
+    uint32_t budget;            // sys cycles per F1 period
+    volatile bool reset;        // Set by core0, cleared by core1 at HC=0
+    prof_entry_t hc[PROF_HC_COUNT];
+    prof_entry_t fetch[PROF_FETCH_COUNT];
+} prof_stats_t;
+
+extern prof_stats_t prof_stats;
+extern volatile uint32_t overruns;
+
+void prof_set_budget(uint32_t sys_cycles);
+void prof_core1_init(void);
+void prof_mon_profile(const char *args, size_t len);
+
+#ifdef VIC_PROFILE
+#include "hardware/structs/m33.h"
+
+static inline __attribute__((always_inline)) void prof_entry_update(prof_entry_t *e, uint32_t cycles, bool late){
+    uint32_t bin = cycles >> PROF_HIST_SHIFT;
+    e->count++;
+    e->sum += cycles;
+    if(cycles < e->min)
+        e->min = cycles;
+    if(cycles > e->max)
+        e->max = cycles;
+    e->hist[bin < PROF_HIST_BINS ? bin : PROF_HIST_BINS - 1]++;
+    if(late)
+        e->late++;
+}
+
+void prof_clear(void);
+
+static inline __attribute__((always_inline)) void prof_update(uint8_t hc, uint8_t fetch, uint32_t cycles, bool late){
+    if(hc == 0 && prof_stats.reset)
+        prof_clear();
+    prof_entry_update(&prof_stats.hc[hc < PROF_HC_COUNT ? hc : PROF_HC_COUNT - 1], cycles, late);
+    prof_entry_update(&prof_stats.fetch[fetch < PROF_FETCH_COUNT ? fetch : PROF_FETCH_COUNT - 1], cycles, late);
+    if(late)
+        overruns++;
+}
+
+#define PROF_START(hc, fetch) \
+    uint32_t prof_start = m33_hw->dwt_cyccnt; \
+    uint8_t prof_hc = (hc); \
+    uint8_t prof_fetch = (fetch)
+#define PROF_END() \
+    prof_update(prof_hc, prof_fetch, m33_hw->dwt_cyccnt - prof_start, pio_interrupt_get(VIC_PIO, 1))
+#else
+#define PROF_START(hc, fetch)
+#define PROF_END()
+#endif
+
+#endif /* _PROF_H_ */
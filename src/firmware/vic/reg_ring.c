@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) 2026 Sodiumlightbaby
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "main.h"
+#include "str.h"
+#include "vic/reg_ring.h"
+#include "hardware/sync.h"
+#include "pico/stdlib.h"
+#include <stdio.h>
+#include <string.h>
+
+#define REG_LOG_LEN 64          // Changes kept for REGLOG, power of 2
+
+uint32_t reg_ring[REG_RING_LEN];
+volatile uint32_t reg_ring_head;
+volatile uint32_t reg_ring_tail;
+uint32_t reg_ring_shadow[4];
+uint32_t reg_ring_lost;
+uint8_t reg_ring_recheck;
+
+static uint32_t reg_ring_hwm;           // Most entries waiting at one reg_ring_task
+static uint32_t reg_changes[16];
+static uint8_t reg_values[16];          // Core0 view of the registers, for the old values
+static uint32_t reg_log[REG_LOG_LEN];
+static uint8_t reg_log_old[REG_LOG_LEN];
+static uint32_t reg_log_count;
+
+static const uint32_t reg_ring_watch[4] = {
+    REG_RING_WATCH0, REG_RING_WATCH1, REG_RING_WATCH2, REG_RING_WATCH3
+};
+
+//Called with the registers set up, before core1 starts the VIC loop
+void reg_ring_init(void){
+    const volatile uint32_t *regs = (const volatile uint32_t *)&xram[0x1000];
+    for(int i = 0; i < 4; i++)
+        reg_ring_shadow[i] = regs[i];
+    for(int i = 0; i < 16; i++)
+        reg_values[i] = xram[0x1000 + i];
+    reg_ring_head = 0;
+    reg_ring_tail = 0;
+    reg_ring_lost = 0;
+    reg_ring_recheck = 0;
+    pio_interrupt_clear(XWRITE_MASK_PIO, REG_RING_PIO_IRQ);
+    reg_ring_hwm = 0;
+    reg_log_count = 0;
+    memset(reg_changes, 0, sizeof(reg_changes));
+}
+
+void reg_ring_queue(uint32_t diff0, uint32_t diff1, uint32_t diff2, uint32_t diff3, uint16_t vc, uint8_t hc){
+    const volatile uint32_t *regs = (const volatile uint32_t *)&xram[0x1000];
+    uint32_t diff[4] = { diff0, diff1, diff2, diff3 };
+    uint32_t head = reg_ring_head;
+    for(int i = 0; i < 4; i++){
+        if(!diff[i])
+            continue;
+        //Keep the unwatched bits as they were so they never compare different
+        uint32_t now = regs[i];
+        reg_ring_shadow[i] = (reg_ring_shadow[i] & ~reg_ring_watch[i]) | (now & reg_ring_watch[i]);
+        for(int b = 0; b < 4; b++){
+            if(!(diff[i] & (0xFFu << (b * 8))))
+                continue;
+            if(head - reg_ring_tail >= REG_RING_LEN){
+                reg_ring_lost++;
+                continue;
+            }
+            reg_ring[head++ & (REG_RING_LEN-1)] = REG_RING_ENTRY(i * 4 + b, now >> (b * 8), vc, hc);
+        }
+    }
+    __dmb();
+    reg_ring_head = head;
+}
+
+void reg_ring_task(void){
+    uint32_t head = reg_ring_head;
+    uint32_t tail = reg_ring_tail;
+    if(head == tail)
+        return;
+    if(head - tail > reg_ring_hwm)
+        reg_ring_hwm = head - tail;
+    __dmb();
+    for(; tail != head; tail++){
+        uint32_t e = reg_ring[tail & (REG_RING_LEN-1)];
+        uint8_t reg = REG_RING_REG(e);
+        reg_changes[reg]++;
+        reg_log[reg_log_count & (REG_LOG_LEN-1)] = e;
+        reg_log_old[reg_log_count & (REG_LOG_LEN-1)] = reg_values[reg];
+        reg_log_count++;
+        reg_values[reg] = REG_RING_VALUE(e);
+    }
+    __dmb();
+    reg_ring_tail = tail;
+}
+
+void reg_ring_print_status(void){
+    printf("Reg ring %d entries, pending max:%lu lost:%lu\n",
+           REG_RING_LEN, reg_ring_hwm, reg_ring_lost);
+    printf(" Changes");
+    for(int i = 0; i < 16; i++)
+        if(reg_changes[i])
+            printf(" CR%X:%lu", i, reg_changes[i]);
+    printf("\n");
+    reg_ring_hwm = 0;                   //Clear for next status
+}
+
+static void reg_log_print(void){
+    uint32_t n = reg_log_count < REG_LOG_LEN ? reg_log_count : REG_LOG_LEN;
+    printf("Last %lu of %lu register changes\n", n, reg_log_count);
+    printf(" VC  HC  Reg   Old New\n");
+    for(uint32_t i = reg_log_count - n; i != reg_log_count; i++){
+        uint32_t e = reg_log[i & (REG_LOG_LEN-1)];
+        printf("%3lu %3lu  $90%02lX  %02X  %02X\n", REG_RING_VC(e), REG_RING_HC(e), REG_RING_REG(e),
+               reg_log_old[i & (REG_LOG_LEN-1)], REG_RING_VALUE(e));
+    }
+}
+
+void reg_ring_mon_reglog(const char *args, size_t len){
+    if(!len){
+        reg_log_print();
+        return;
+    }
+    if(!strnicmp(args, "reset", len)){
+        reg_log_count = 0;
+        memset(reg_changes, 0, sizeof(reg_changes));
+        return;
+    }
+    printf("?invalid argument\n");
+}
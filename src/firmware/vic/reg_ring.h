@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2026 Sodiumlightbaby
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+// VIC register change ring. CPU writes land in xram through the xwrite DMA
+// chain with no hook for software, but the xwrite mask_address SM raises a PIO
+// flag when the address is a VIC register. The core1 loop tests that flag
+// once per F1 cycle and only then compares the CPU written registers against
+// a shadow copy, queueing each change with the raster position it was seen
+// at. Core0 drains the ring in reg_ring_task() for the change log and status
+// counters.
+
+#ifndef _REG_RING_H_
+#define _REG_RING_H_
+
+#include "main.h"
+#include "sys/mem.h"
+#include "hardware/pio.h"
+#include "hardware/sync.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+//Ring size must be power of 2
+#define REG_RING_LEN_BITS 8
+#define REG_RING_LEN (1<<REG_RING_LEN_BITS)
+
+//Entry: value[31:24] reg[19:16] HC[15:9] VC[8:0]
+#define REG_RING_ENTRY(reg, value, vc, hc) \
+    (((uint32_t)(value) << 24) | ((uint32_t)(reg) << 16) | ((uint32_t)(hc) << 9) | (vc))
+#define REG_RING_VALUE(e) ((uint8_t)((e) >> 24))
+#define REG_RING_REG(e)   (((e) >> 16) & 0xF)
+#define REG_RING_HC(e)    (((e) >> 9) & 0x7F)
+#define REG_RING_VC(e)    ((e) & 0x1FF)
+
+//PIO flag raised by "irq set 4 rel" in mask_address, run by the xwrite SM
+#define REG_RING_PIO_IRQ (4 + XWRITE_MASK_SM)
+
+//Register bits compared, per little endian word of CR0-CRF. Left out are the
+//raster line in CR3 bit 7 and CR4, and the light pen and paddles in CR6-CR9,
+//which the PIVIC itself writes.
+#define REG_RING_WATCH0 0x7FFFFFFF
+#define REG_RING_WATCH1 0x0000FF00
+#define REG_RING_WATCH2 0xFFFF0000
+#define REG_RING_WATCH3 0xFFFFFFFF
+
+extern uint32_t reg_ring[REG_RING_LEN];
+extern volatile uint32_t reg_ring_head;     //Written by core1
+extern volatile uint32_t reg_ring_tail;     //Written by core0
+extern uint32_t reg_ring_shadow[4];         //Core1 copy of CR0-CRF as last queued
+extern uint32_t reg_ring_lost;              //Changes dropped on a full ring
+extern uint8_t reg_ring_recheck;            //F1 cycles left to compare after a write
+
+void reg_ring_init(void);
+void reg_ring_task(void);
+void reg_ring_print_status(void);
+void reg_ring_mon_reglog(const char *args, size_t len);
+
+//Core0 writes to CR0-CRF don't pass mask_address, so the writer raises its
+//flag to have core1 compare them. addr and len are in xram.
+static inline void reg_ring_wrote(uint32_t addr, size_t len){
+    if(addr < 0x1010 && addr + len > 0x1000){
+        __dmb();                        //Registers written before the flag
+        XWRITE_MASK_PIO->irq_force = 1u << REG_RING_PIO_IRQ;
+    }
+}
+
+//Slow path of reg_ring_poll, queues the changed registers
+void reg_ring_queue(uint32_t diff0, uint32_t diff1, uint32_t diff2, uint32_t diff3, uint16_t vc, uint8_t hc);
+
+//Called by the core1 loop once per F1 cycle. Returns true if any watched
+//register changed since the last call. The flag is raised by the address,
+//ahead of the data DMA, so the compare runs on this cycle and the next.
+static inline __attribute__((always_inline)) bool reg_ring_poll(uint16_t vc, uint8_t hc){
+    if(__builtin_expect(pio_interrupt_get(XWRITE_MASK_PIO, REG_RING_PIO_IRQ), 0)){
+        pio_interrupt_clear(XWRITE_MASK_PIO, REG_RING_PIO_IRQ);
+        reg_ring_recheck = 2;
+    }
+    if(__builtin_expect(!reg_ring_recheck, 1))
+        return false;
+    reg_ring_recheck--;
+    const volatile uint32_t *regs = (const volatile uint32_t *)&xram[0x1000];
+    uint32_t diff0 = (regs[0] ^ reg_ring_shadow[0]) & REG_RING_WATCH0;
+    uint32_t diff1 = (regs[1] ^ reg_ring_shadow[1]) & REG_RING_WATCH1;
+    uint32_t diff2 = (regs[2] ^ reg_ring_shadow[2]) & REG_RING_WATCH2;
+    uint32_t diff3 = (regs[3] ^ reg_ring_shadow[3]) & REG_RING_WATCH3;
+    if(__builtin_expect((diff0 | diff1 | diff2 | diff3) == 0, 1))
+        return false;
+    reg_ring_queue(diff0, diff1, diff2, diff3, vc, hc);
+    return true;
+}
+
+#endif /* _REG_RING_H_ */
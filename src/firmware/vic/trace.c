@@ -0,0 +1,293 @@
+/*
+ * Copyright (c) 2026 Sodiumlightbaby
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "main.h"
+#include "str.h"
+#include "sys/cfg.h"
+#include "sys/com.h"
+#include "vic/mem.h"
+#include "vic/trace.h"
+#include "vic/vic.h"
+#include "pico/stdlib.h"
+#include "hardware/dma.h"
+#include "tusb.h"
+#include <stdio.h>
+
+#define TRACE_RANGE_MAX  4
+#define TRACE_TASK_WORDS 1024   // Ring words encoded per trace_task call
+#define TRACE_REC_MAX    32     // CDC space needed per ring word (lost, frame and access records)
+#define TRACE_LAG_MAX    (TRACE_RING_WORDS * 3 / 4)
+#define TRACE_GAP_US     5000   // The ring holds ~7ms of CPU cycles
+
+static volatile uint32_t trace_write_dummy;
+volatile uint32_t *trace_dma_write_reg = &trace_write_dummy;
+volatile uint32_t trace_frame_addr;
+volatile uint32_t trace_frame_count;
+
+static struct {
+    uint16_t lo;
+    uint16_t hi;
+} trace_ranges[TRACE_RANGE_MAX];
+static size_t trace_range_count;
+static bool trace_reads = true;
+static bool trace_writes = true;
+
+static uint8_t trace_users;           // TRACE_USER_* bits holding the capture on
+static bool trace_streaming;
+static bool trace_header_pending;
+static uint8_t trace_key;
+
+static uint32_t trace_tail;             // Next ring word to encode
+static uint32_t trace_cycle;            // Cycle of the word at trace_tail
+static uint32_t trace_rec_cycle;        // Cycle of the last record sent
+static uint16_t trace_rec_addr;         // Address of the last access record sent
+static uint32_t trace_mark_count;
+static uint32_t trace_mark;             // Ring index of the next frame start
+static bool trace_mark_pending;
+static uint32_t trace_gap_start;
+static uint32_t trace_gap;              // Cycles dropped, not yet reported
+static bool trace_gap_pending;
+static bool trace_gap_unknown;
+static uint32_t trace_task_us;
+
+static uint32_t trace_stat_records;
+static uint32_t trace_stat_bytes;
+static uint32_t trace_stat_lost;
+
+static size_t trace_varint(uint8_t *buf, uint64_t value){
+    size_t n = 0;
+    while(value >= 0x80){
+        buf[n++] = (value & 0x7F) | 0x80;
+        value >>= 7;
+    }
+    buf[n++] = value;
+    return n;
+}
+
+static size_t trace_tag(uint8_t *buf, uint8_t kind, uint32_t cycle){
+    size_t n = trace_varint(buf, ((uint64_t)(cycle - trace_rec_cycle) << 3) | kind);
+    trace_rec_cycle = cycle;
+    return n;
+}
+
+static void trace_send(const uint8_t *buf, size_t len){
+    tud_cdc_write(buf, len);
+    trace_stat_records++;
+    trace_stat_bytes += len;
+}
+
+static void trace_send_lost(void){
+    uint8_t buf[16];
+    size_t n = trace_tag(buf, TRACE_REC_LOST, trace_gap_start);
+    n += trace_varint(&buf[n], trace_gap_unknown ? 0 : trace_gap);
+    trace_rec_cycle += trace_gap;
+    trace_send(buf, n);
+    trace_stat_lost += trace_gap;
+    trace_gap = 0;
+    trace_gap_pending = trace_gap_unknown = false;
+}
+
+static void trace_skip(uint32_t words, bool unknown){
+    if(!trace_gap_pending){
+        trace_gap_start = trace_cycle;
+        trace_gap_pending = true;
+    }
+    trace_gap += words;
+    trace_gap_unknown |= unknown;
+    trace_cycle += words;
+    trace_tail = (trace_tail + words) & (TRACE_RING_WORDS - 1);
+}
+
+static bool trace_match(uint16_t addr, bool read){
+    if(read ? !trace_reads : !trace_writes)
+        return false;
+    if(!trace_range_count)
+        return true;
+    for(size_t i = 0; i < trace_range_count; i++)
+        if(addr >= trace_ranges[i].lo && addr <= trace_ranges[i].hi)
+            return true;
+    return false;
+}
+
+static void trace_send_word(uint32_t word){
+    uint16_t addr = word & 0x3FFF;
+    bool read = word & (1u << 14);
+    if(!trace_match(addr, read))
+        return;
+    // BLK4 (A13=0) write data is on the bus with the address, see xwrite
+    uint8_t data = (!read && !(addr & 0x2000)) ? word >> 15 : word >> 23;
+    int16_t delta = addr - trace_rec_addr;
+    uint8_t buf[16];
+    size_t n = trace_tag(buf, read ? TRACE_REC_READ : TRACE_REC_WRITE, trace_cycle);
+    n += trace_varint(&buf[n], (uint16_t)((delta << 1) ^ (delta >> 15)));
+    buf[n++] = data;
+    trace_rec_addr = addr;
+    trace_send(buf, n);
+}
+
+static void trace_com_rx(bool timeout, const char *buf, size_t length){
+    (void)timeout;
+    (void)buf;
+    (void)length;
+    uint8_t end = TRACE_REC_END;
+    if(tud_cdc_write_available())
+        trace_send(&end, 1);
+    trace_streaming = false;
+}
+
+void trace_task(void){
+    if(!trace_streaming)
+        return;
+    if(trace_header_pending){
+        if(tud_cdc_write_available() < 6)
+            return;
+        uint8_t mode = cfg_get_mode();
+        uint8_t header[6] = {'P', 'V', 'T', 'R', TRACE_STREAM_VERSION,
+                             mode == VIC_MODE_PAL || mode == VIC_MODE_PAL_SVIDEO};
+        tud_cdc_write(header, sizeof(header));
+        trace_header_pending = false;
+    }
+
+    uint32_t now = time_us_32();
+    uint32_t head = trace_ring_index(dma_channel_hw_addr(trace_dma_chan)->write_addr);
+    uint32_t lag = (head - trace_tail) & (TRACE_RING_WORDS - 1);
+    if(now - trace_task_us > TRACE_GAP_US){
+        // The ring may have lapped since the last call
+        trace_skip(lag, true);
+        lag = 0;
+    } else if(lag > TRACE_LAG_MAX){
+        trace_skip(lag, false);
+        lag = 0;
+    }
+    trace_task_us = now;
+
+    uint32_t count = trace_frame_count;
+    if(count != trace_mark_count){
+        trace_mark_count = count;
+        trace_mark = trace_ring_index(trace_frame_addr);
+        trace_mark_pending = ((trace_mark - trace_tail) & (TRACE_RING_WORDS - 1)) <= lag;
+    }
+
+    for(uint32_t i = 0; i < TRACE_TASK_WORDS && trace_tail != head; i++){
+        if(tud_cdc_write_available() < TRACE_REC_MAX)
+            break;
+        if(trace_gap_pending)
+            trace_send_lost();
+        if(trace_mark_pending && trace_tail == trace_mark){
+            uint8_t buf[8];
+            trace_send(buf, trace_tag(buf, TRACE_REC_FRAME, trace_cycle));
+            trace_mark_pending = false;
+        }
+        trace_send_word(TRACE_BUF[trace_tail]);
+        trace_tail = (trace_tail + 1) & (TRACE_RING_WORDS - 1);
+        trace_cycle++;
+    }
+}
+
+bool trace_active(void){
+    return trace_streaming;
+}
+
+static void trace_stream_start(void){
+    trace_tail = trace_ring_index(dma_channel_hw_addr(trace_dma_chan)->write_addr);
+    trace_cycle = trace_rec_cycle = 0;
+    trace_rec_addr = 0;
+    trace_mark_count = trace_frame_count;
+    trace_mark_pending = false;
+    trace_gap = 0;
+    trace_gap_pending = trace_gap_unknown = false;
+    trace_stat_records = trace_stat_bytes = trace_stat_lost = 0;
+    trace_task_us = time_us_32();
+    trace_header_pending = true;
+    trace_streaming = true;
+    // Any key ends the stream
+    com_read_binary(0, trace_com_rx, &trace_key, 1);
+}
+
+void trace_capture(uint8_t user, bool on){
+    uint8_t users = on ? trace_users | user : trace_users & ~user;
+    if(users && !trace_users){
+        trace_dma_write_reg = &dma_channel_hw_addr(trace_dma_chan)->write_addr;
+        mem_trace_start();
+    }
+    if(!users && trace_users){
+        mem_trace_stop();
+        trace_dma_write_reg = &trace_write_dummy;
+    }
+    trace_users = users;
+}
+
+static void trace_print_status(void){
+    printf("Trace %s, %s%s%s\n", trace_users & TRACE_USER_MON ? "on" : "off",
+           trace_reads ? "reads" : "", trace_reads && trace_writes ? " and " : "",
+           trace_writes ? "writes" : "");
+    if(!trace_range_count)
+        printf("All addresses\n");
+    for(size_t i = 0; i < trace_range_count; i++)
+        printf("$%04X-$%04X\n", trace_ranges[i].lo, trace_ranges[i].hi);
+    printf("Last stream %lu records, %lu bytes, %lu cycles lost\n",
+           trace_stat_records, trace_stat_bytes, trace_stat_lost);
+}
+
+void trace_mon_trace(const char *args, size_t len){
+    uint32_t lo, hi;
+    if(!len){
+        trace_print_status();
+        return;
+    }
+    if(!strnicmp(args, "on", len)){
+        trace_capture(TRACE_USER_MON, true);
+        return;
+    }
+    if(!strnicmp(args, "off", len)){
+        trace_capture(TRACE_USER_MON, false);
+        return;
+    }
+    if(!strnicmp(args, "stream", len)){
+        if(!(trace_users & TRACE_USER_MON)){
+            printf("?trace is off\n");
+            return;
+        }
+        trace_stream_start();
+        return;
+    }
+    if(!strnicmp(args, "reads", len)){
+        trace_reads = true;
+        trace_writes = false;
+        return;
+    }
+    if(!strnicmp(args, "writes", len)){
+        trace_reads = false;
+        trace_writes = true;
+        return;
+    }
+    if(!strnicmp(args, "all", len)){
+        trace_reads = trace_writes = true;
+        return;
+    }
+    if(!strnicmp(args, "clear", len)){
+        trace_range_count = 0;
+        return;
+    }
+    if(parse_uint32(&args, &len, &lo) &&
+       parse_uint32(&args, &len, &hi) &&
+       parse_end(args, len))
+    {
+        if(lo > hi || hi > 0x3FFF){
+            printf("?invalid address\n");
+            return;
+        }
+        if(trace_range_count == TRACE_RANGE_MAX){
+            printf("?too many ranges\n");
+            return;
+        }
+        trace_ranges[trace_range_count].lo = lo;
+        trace_ranges[trace_range_count].hi = hi;
+        trace_range_count++;
+        return;
+    }
+    printf("?invalid argument\n");
+}
@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) 2026 Sodiumlightbaby
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef _TRACE_H_
+#define _TRACE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Bus trace stream, sent over USB CDC by TRACE STREAM and read by
+// src/host/victrace. Varints are little endian, 7 bits per byte, bit 7 set
+// when more bytes follow.
+//   Header: "PVTR", version, mode (0 NTSC, 1 PAL)
+//   Record: varint (cycles since previous record << 3 | kind), then
+//     TRACE_REC_READ/WRITE  zigzag varint address delta, data byte
+//     TRACE_REC_FRAME       VC reset, anchors the raster position
+//     TRACE_REC_LOST        varint cycles dropped, 0 if unknown
+//     TRACE_REC_END         end of stream
+#define TRACE_STREAM_VERSION 1
+#define TRACE_REC_READ  0
+#define TRACE_REC_WRITE 1
+#define TRACE_REC_FRAME 2
+#define TRACE_REC_LOST  3
+#define TRACE_REC_END   4
+
+// Trace ring position when the VIC loop last reset VC
+extern volatile uint32_t *trace_dma_write_reg;
+extern volatile uint32_t trace_frame_addr;
+extern volatile uint32_t trace_frame_count;
+
+// Called by the VIC loop on VC reset
+#define TRACE_FRAME_MARK()                          \
+    {                                               \
+        trace_frame_addr = *trace_dma_write_reg;    \
+        trace_frame_count++;                        \
+    }
+
+// Users of the bus capture into the trace ring, which runs while any is on
+#define TRACE_USER_MON  0x01
+#define TRACE_USER_HEAT 0x02
+
+void trace_capture(uint8_t user, bool on);
+void trace_task(void);
+bool trace_active(void);
+void trace_mon_trace(const char *args, size_t len);
+
+#endif /* _TRACE_H_ */
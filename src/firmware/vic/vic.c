@@ -6,8 +6,11 @@
 
 #include "main.h"
 #include "vic/vic.h"
+#include "vic/vic_lut.h"
 #include "vic/vic_ntsc.h"
 #include "vic/vic_pal.h"
+#include "vic/prof.h"
+#include "vic/reg_ring.h"
 #include "vic/char_rom.h"
 #include "sys/cfg.h"
 #include "sys/dvi.h"
@@ -45,6 +48,8 @@ volatile uint32_t overruns = 0;
 
 
 
+static uint16_t vic_cycle_sys_clocks;
+
 void vic_pio_init(void) {
     //Make PHI2 PIN possible to also sample as input
     uint phi2_pin;
@@ -83,6 +88,9 @@ void vic_pio_init(void) {
             dot_div = 72;
             break;
         }
+    // F1 period is four dot clocks
+    vic_cycle_sys_clocks = dot_div * 4;
+    prof_set_budget(vic_cycle_sys_clocks);
     sm_config_set_sideset_pin_base(&config, phi2_pin);
     pio_sm_init(VIC_PIO, VIC_SM, offset, &config);
     offset = pio_add_program(VIC_DOTCLK_PIO, &clkgen_dot_program);
@@ -185,9 +193,11 @@ void vic_init(void) {
     // Initialisation.
     vic_pio_init();
     vic_memory_init();
+    vic_lut_init();
     uint8_t dvi_mode = cfg_get_dvi();
     if(cfg_get_splash())
         vic_splash_init();
+    reg_ring_init();
     switch(cfg_get_mode()){
         case(VIC_MODE_PAL):
         case(VIC_MODE_PAL_SVIDEO):
@@ -204,6 +214,10 @@ void vic_init(void) {
     }
 }
 
+uint16_t vic_get_cycle_sys_clocks(void) {
+    return vic_cycle_sys_clocks;
+}
+
 void vic_task(void) {
     if (overruns > 0) {
         printf("X.");
@@ -229,5 +243,6 @@ void vic_print_status(void){
         printf(" CRD %02x %d No E:%d\n", vic_crd, vic_crd & 0x7F, (vic_crd >> 7));
         printf(" CRE %02x %d Vol CA:%d\n", vic_cre, vic_cre & 0x0F, (vic_cre >> 4));
         printf(" CRF %02x CB:%d R:%d CE:%d\n", vic_crf, (vic_crf >> 4), (vic_crf >> 3) & 1u, (vic_crf & 0x7));
+    reg_ring_print_status();
 }
 
@@ -77,6 +77,12 @@
 #define screen_mem_start         (((vic_cr5 & 0xF0) << 6) | ((vic_cr2 & 0x80) << 2))
 #define char_mem_start           ((vic_cr5 & 0x0F) << 10)
 
+// DVI output is packed into one 32-bit framebuffer store per cycle. First pixel in the lowest byte.
+#define DVI_PX(rgb, n)           ((uint32_t)(rgb) << ((n) * 8))
+#define DVI_PX4(rgb)             ((uint32_t)(rgb) * 0x01010101u)
+// Packed framebuffer: the four bytes hold palette indices, two to a byte with the first pixel lowest.
+#define DVI_PACK4(w)             ((((w) | ((w) >> 4)) & 0x00FFu) | ((((w) | ((w) >> 4)) >> 8) & 0xFF00u))
+
 // Constants for the fetch state of the vic_core1_loop.
 #define FETCH_OUTSIDE_MATRIX  0
 #define FETCH_IN_MATRIX_Y     1
@@ -91,6 +97,7 @@
 
 void vic_init(void);
 void vic_task(void);
+uint16_t vic_get_cycle_sys_clocks(void);
 
 void vic_print_status(void);
 void vic_print_dvi_modes(void);
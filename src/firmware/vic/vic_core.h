@@ -0,0 +1,1066 @@
+/*
+* Copyright (c) 2025 dreamseal
+*
+* SPDX-License-Identifier: BSD-3-Clause
+*/
+
+// Core 1 VIC emulation loop shared by the PAL 6561 and NTSC 6560. The loop is
+// written once against a timing table and always inlined into vic_pal.c and
+// vic_ntsc.c with a constant table, so each standard gets its own loop with
+// the table values and the branches on them folded away at compile time.
+
+#ifndef _VIC_CORE_H_
+#define _VIC_CORE_H_
+
+#include "main.h"
+#include "vic/aud.h"
+#include "vic/cvbs.h"
+#include "vic/cvbs_ring.h"
+#include "vic/pen.h"
+#include "vic/prof.h"
+#include "vic/reg_ring.h"
+#include "vic/trace.h"
+#include "vic/vic.h"
+#include "vic/vic_lut.h"
+#include "sys/dvi.h"
+#include "sys/mem.h"
+#include "pico/stdlib.h"
+#include "hardware/pio.h"
+
+// How colours are looked up in cvbs_fused.
+#define VIC_PALETTE_LINES 0     // PAL: odd/even line rows, plus truncated rows for the last hblank pixel
+#define VIC_PALETTE_PHASE 1     // NTSC: row follows the chroma phase, advancing every pixel
+
+// Sync pulses sent for a vertical blanking line.
+#define VIC_VBLANK_NONE  0
+#define VIC_VBLANK_LONG  1
+#define VIC_VBLANK_SHORT 2
+
+// HC values of the 6560 half-line events, which get their own cycle cases
+// when the timing table has half_lines set. See the NTSC timing notes below.
+#define VIC_HL_HC_VC_INC    29
+#define VIC_HL_HC_HALF_LINE 62
+#define VIC_HL_HC_LINE_END  64
+
+typedef struct vic_timing_struct {
+    uint16_t last_line;         // Last VC value (non-interlaced for half-line timings)
+    uint16_t intl_last_line;    // Last VC value in interlaced mode, half-line timings only
+    uint8_t  hblank_end;        // First HC with visible pixels
+    uint8_t  hblank_start;      // HC where horizontal blanking starts
+    uint8_t  vsync_start;       // First vertical sync line
+    uint8_t  vsync_end;         // Last vertical sync line
+    uint8_t  vblank_end;        // Last vertical blanking line (blanking starts at line 1)
+    uint8_t  palette;           // VIC_PALETTE_*
+    bool     hblank_end_partial;// Only the last pixel of the hblank_end cycle is visible
+    bool     half_lines;        // 6560 style VC increment mid line, with a half-line counter
+    uint32_t dc_backpressure;   // CVBS DC run queued before the first cycle
+    uint32_t frontporch_1;      // CVBS blanking commands
+    uint32_t frontporch_2;
+    uint32_t hsync;
+    uint32_t breezeway;
+    uint32_t backporch;
+    uint32_t long_sync_l;
+    uint32_t long_sync_h;
+    uint32_t short_sync_l;
+    uint32_t short_sync_h;
+} vic_timing_t;
+
+// One pixel in byte n of dvi_word, with its CVBS command sent straight away.
+#define VIC_PIXEL(colour, n) do { \
+        const cvbs_fused_t *entry = (t->palette == VIC_PALETTE_PHASE) ? \
+            &cvbs_fused[pIndex++ & 0x7][(colour)] : &linePalette[(colour)]; \
+        CVBS_RING_PUT(entry->cvbs); \
+        dvi_word |= DVI_PX(entry->rgb332, n); \
+    } while (0)
+
+// PAL pixel cut short by horizontal blanking. Only the CVBS command is truncated.
+#define VIC_PIXEL_TRUNC(colour, n) do { \
+        CVBS_RING_PUT(lineTruncPalette[(colour)].cvbs); \
+        dvi_word |= DVI_PX(linePalette[(colour)].rgb332, n); \
+    } while (0)
+
+// One cycle of border. On the partial hblank_end cycle only the last pixel shows.
+#define VIC_BORDER(colour) do { \
+        if (t->palette == VIC_PALETTE_PHASE) { \
+            dvi_word = 0; \
+            VIC_PIXEL(colour, 0); \
+            VIC_PIXEL(colour, 1); \
+            VIC_PIXEL(colour, 2); \
+            VIC_PIXEL(colour, 3); \
+        } else { \
+            const cvbs_fused_t *entry = &linePalette[(colour)]; \
+            dvi_word = DVI_PX(entry->rgb332, 3); \
+            if (fullCycle) { \
+                CVBS_RING_PUT(entry->cvbs); \
+                CVBS_RING_PUT(entry->cvbs); \
+                CVBS_RING_PUT(entry->cvbs); \
+                dvi_word = DVI_PX4(entry->rgb332); \
+            } \
+            CVBS_RING_PUT(entry->cvbs); \
+        } \
+        VIC_DVI_PUT(dvi_word); \
+    } while (0)
+
+// One cycle of DVI pixels into the framebuffer line.
+#define VIC_DVI_PUT(word) do { \
+        if (dvi_packed) { \
+            *(uint16_t *)dvi_line = DVI_PACK4(word); \
+            dvi_line += 2; \
+        } else { \
+            *(uint32_t *)dvi_line = (word); \
+            dvi_line += 4; \
+        } \
+    } while (0)
+
+// Sync pulses for one vertical blanking line.
+#define VIC_VBLANK_PUT(kind) do { \
+        if ((kind) == VIC_VBLANK_LONG) { \
+            CVBS_RING_PUT(t->long_sync_l); \
+            CVBS_RING_PUT(t->long_sync_h); \
+            CVBS_RING_PUT(t->long_sync_l); \
+            CVBS_RING_PUT(t->long_sync_h); \
+        } else { \
+            CVBS_RING_PUT(t->short_sync_l); \
+            CVBS_RING_PUT(t->short_sync_h); \
+            CVBS_RING_PUT(t->short_sync_l); \
+            CVBS_RING_PUT(t->short_sync_h); \
+        } \
+    } while (0)
+
+// Rest of the horizontal blanking, including hsync and colour burst. The burst
+// phase alternates by line, and the palette row or chroma phase with it.
+#define VIC_HBLANK_PUT(odd) do { \
+        CVBS_RING_PUT(t->frontporch_2); \
+        CVBS_RING_PUT(t->hsync); \
+        CVBS_RING_PUT(t->breezeway); \
+        if (odd) { \
+            linePalette = cvbs_fused[0]; \
+            lineTruncPalette = cvbs_fused[2]; \
+            pIndex = 2; \
+            CVBS_RING_PUT(cvbs_burst_cmd_odd); \
+        } else { \
+            linePalette = cvbs_fused[1]; \
+            lineTruncPalette = cvbs_fused[3]; \
+            pIndex = 6; \
+            CVBS_RING_PUT(cvbs_burst_cmd_even); \
+        } \
+        CVBS_RING_PUT(t->backporch); \
+    } while (0)
+
+// Simplified state changes for cycles without pixel output, i.e. in blanking.
+#define VIC_FETCH_BLANK() do { \
+        switch (fetchState) { \
+            case FETCH_OUTSIDE_MATRIX: \
+                /* This is the line the video matrix starts on. As in the real chip, we use */ \
+                /* a different state for the first part of the first video matrix line. */ \
+                if ((verticalCounter >> 1) == screen_origin_y) { \
+                    fetchState = FETCH_IN_MATRIX_Y; \
+                    /* Screen origin X can match in the same cycle as Y. */ \
+                    if (prevHorizontalCounter == screen_origin_x) { \
+                        fetchState = FETCH_MATRIX_DLY_1; \
+                    } \
+                } \
+                break; \
+            case FETCH_IN_MATRIX_Y: \
+            case FETCH_MATRIX_LINE: \
+                if (prevHorizontalCounter == screen_origin_x) { \
+                    fetchState = FETCH_MATRIX_DLY_1; \
+                } \
+                break; \
+            case FETCH_MATRIX_DLY_1: \
+            case FETCH_MATRIX_DLY_2: \
+            case FETCH_MATRIX_DLY_3: \
+                fetchState++; \
+                break; \
+            case FETCH_SCREEN_CODE: \
+                fetchState = ((horizontalCellCounter-- > 0) ? FETCH_CHAR_DATA : FETCH_MATRIX_END); \
+                break; \
+            case FETCH_CHAR_DATA: \
+                /* Until the matrix closes, which at the latest could be HC=1 on the */ \
+                /* next line, the video matrix counter keeps incrementing. */ \
+                videoMatrixCounter++; \
+                fetchState = FETCH_SCREEN_CODE; \
+                break; \
+            case FETCH_MATRIX_END: \
+                fetchState = FETCH_MATRIX_LINE; \
+                break; \
+        } \
+    } while (0)
+
+// Classify a line as visible or vertical blanking with short or long (vsync) pulses.
+static inline __attribute__((always_inline)) uint8_t vic_vblank_kind(const vic_timing_t *t, uint16_t line) {
+    if ((line == 0) || (line > t->vblank_end)) {
+        return VIC_VBLANK_NONE;
+    }
+    if ((line >= t->vsync_start) && (line <= t->vsync_end)) {
+        return VIC_VBLANK_LONG;
+    }
+    return VIC_VBLANK_SHORT;
+}
+
+/**
+ * Core 1 VIC emulation loop. Only ever called with a constant timing table.
+ */
+static inline __attribute__((always_inline)) void vic_core1_loop(const vic_timing_t *t) {
+
+    //
+    // START OF VIC CHIP STATE
+    //
+
+    // Counters.
+    uint16_t videoMatrixCounter = 0;     // 12-bit video matrix counter (VMC)
+    uint16_t videoMatrixLatch = 0;       // 12-bit latch that VMC is stored to and loaded from
+    uint16_t verticalCounter = 0;        // 9-bit vertical counter (i.e. raster lines)
+    uint8_t  horizontalCounter = 0;      // 8-bit horizontal counter (although top bit isn't used)
+    uint8_t  prevHorizontalCounter = 0;  // 8-bit previous value of horizontal counter.
+    uint8_t  horizontalCellCounter = 0;  // 8-bit horizontal cell counter (down counter)
+    uint8_t  verticalCellCounter = 0;    // 6-bit vertical cell counter (down counter)
+    uint8_t  cellDepthCounter = 0;       // 4-bit cell depth counter (counts either from 0-7, or 0-15)
+    uint8_t  halfLineCounter = 0;        // 1-bit half-line counter (6560 only)
+
+    // DVI line output pointer. With a partial hblank_end cycle (PAL HC=12) each line starts
+    // with a word that has the first three bytes blank, keeping the rest of the line word aligned.
+    uint8_t *dvi_line = (uint8_t*)dvi_fb_line(0);
+    uint32_t dvi_word = 0;               // DVI pixels of the current cycle
+    const bool dvi_packed = dvi_fb_packed; // Palette indices two to a byte, set up before core1 starts
+
+    // Values normally fetched externally, from screen mem, colour RAM and char mem.
+    uint8_t  cellIndex = 0;              // 8 bits fetched from screen memory.
+    uint8_t  charData = 0;               // 8 bits of bitmap data fetched from character memory.
+    uint8_t  charDataLatch = 0;          // 8 bits of bitmap data fetched from character memory (latched)
+    uint8_t  colourData = 0;             // 4 bits fetched from colour memory (top bit multi/hires mode)
+    uint8_t  hiresMode = 0;
+
+    // Holds the colour index for each of the current multi colour colours.
+    uint8_t multiColourTable[4] = { 0, 0, 0, 0};
+
+    // Every cpu cycle, we output four pixels. The values are temporarily stored in these vars.
+    uint8_t pixel1 = 0;
+    uint8_t pixel2 = 0;
+    uint8_t pixel3 = 0;
+    uint8_t pixel4 = 0;
+    uint8_t pixel5 = 0;
+    uint8_t pixel6 = 0;
+    uint8_t pixel7 = 0;
+    uint8_t pixel8 = 0;
+    uint16_t cellPixels = 0;            // Packed pixel indices from the char data lookup
+
+    // Palette rows of the current line, alternating between even and odd PAL lines.
+    const cvbs_fused_t *linePalette = cvbs_fused[1];
+    const cvbs_fused_t *lineTruncPalette = cvbs_fused[3];
+
+    // NTSC chroma phase of the next pixel, and the line parity the burst follows.
+    uint8_t pIndex = 0;
+    bool oddLine = true;
+
+    // Optimisation to represent "in matrix", "address output enabled", and "pixel output enabled"
+    // all with one simple state variable.
+    uint8_t fetchState = FETCH_OUTSIDE_MATRIX;
+
+    // Whether the current line is within vertical blanking. Due to the complexity of how the NTSC
+    // vertical blanking shifts depending on state, it is tracked separately rather than deduced
+    // from the vertical counter.
+    bool vblanking = false;
+
+    //
+    // END OF VIC CHIP STATE
+    //
+
+
+    // Temporary variables, not a core part of the state.
+    uint16_t charDataOffset = 0;
+
+    // Vertical blanking pulses decided at HC=29, pushed late in a later cycle to avoid overruns.
+    uint8_t do_vblank = VIC_VBLANK_NONE;
+
+    // Index of the current border colour (used temporarily when we don't want to use the define multiple times in a cycle)
+    uint8_t borderColourIndex = 0;
+
+    uint32_t cvbs_head = cvbs_ring_tail;
+
+    // Fetch base addresses, only recalculated when reg_ring_poll sees a register change.
+    uint16_t screenMemStart = screen_mem_start;
+    uint16_t charMemStart = char_mem_start;
+
+    prof_core1_init();
+
+    // Where the beam wraps, for DVI scan out racing it in the scanline ring.
+    dvi_fb_beam_lines = t->last_line + 1;
+
+    //FIFO Back pressure. Experimentaly adjusted
+    CVBS_RING_PUT(t->dc_backpressure);
+    cvbs_ring_flush(cvbs_head);
+
+    while (1) {
+        // Poll for PIO IRQ 1. This is the rising edge of F1.
+        while (!pio_interrupt_get(VIC_PIO, 1)) {
+            tight_loop_contents();
+        }
+
+        // Clear the IRQ 1 flag immediately for now.
+        pio_interrupt_clear(VIC_PIO, 1);
+        PROF_START(horizontalCounter, fetchState);
+
+        if (reg_ring_poll(verticalCounter, horizontalCounter)) {
+            screenMemStart = screen_mem_start;
+            charMemStart = char_mem_start;
+        }
+
+        switch (horizontalCounter) {
+
+            // HC = 0 is handled in a single block for ALL lines.
+            case 0:
+
+                // Reset light pen counter
+                // 15:8=VC/2 7:0=0
+                *pen_xy = (verticalCounter & 0xFC) << 7;
+
+                // Reset pixel output buffer to be all border colour at start of line.
+                pixel1 = pixel2 = pixel3 = pixel4 = pixel5 = pixel6 = pixel7 = pixel8 = 1;
+                hiresMode = false;
+                colourData = 0x08;
+                charData = charDataLatch = 0x55;
+
+                // Simplified state updates for HC=0. Counters and states still need to
+                // change as appropriate, regardless of it being during blanking. In HC=0, it
+                // is not possible to match screen origin x if the last line was not a matrix
+                // line, as per the real chip. The origin X comparisons here are against the
+                // previous HC, i.e. the last HC of the previous line.
+                VIC_FETCH_BLANK();
+
+                if (t->half_lines) {
+                    // The 6560 VC doesn't change at the start of the line, see HC=29.
+                    dvi_line = (uint8_t*)dvi_fb_line(verticalCounter);
+                    dvi_fb_beam = verticalCounter;
+                }
+
+                prevHorizontalCounter = horizontalCounter++;
+                break;
+
+            // HC = 1 is another special case, handled in a single block for ALL lines. This
+            // is when the "new line" signal is seen by most components. For the 6561 it is also
+            // the cycle during which we queue the horiz blanking, horiz sync, colour burst,
+            // vertical blanking and vsync, all up front for efficiency reasons.
+            case 1:
+
+                if (!t->half_lines) {
+                    // This needs to be checked before the vertical counter is updated.
+                    if (fetchState == FETCH_OUTSIDE_MATRIX) {
+                        if ((verticalCounter >> 1) == screen_origin_y) {
+                            // This is the line the video matrix starts on. As in the real chip, we use
+                            // a different state for the first part of the first video matrix line.
+                            fetchState = FETCH_IN_MATRIX_Y;
+
+                            // Screen origin X can match in the same cycle as Y.
+                            if (prevHorizontalCounter == screen_origin_x) {
+                                fetchState = FETCH_MATRIX_DLY_1;
+                            }
+                        }
+                    }
+
+                    // The Vertical Counter is incremented during HC=1, due to a deliberate 1 cycle
+                    // delay between the HC reset and the VC increment.
+                    if (verticalCounter == t->last_line) {
+                        // Previous cycle was end of last line, so reset VC.
+                        verticalCounter = 0;
+                        fetchState = FETCH_OUTSIDE_MATRIX;
+                        cellDepthCounter = 0;
+                        // Reset Pen latch
+                        *pen_dma_trans_reg = 1;
+                        TRACE_FRAME_MARK();
+                    } else {
+                        // Otherwise increment line counter.
+                        verticalCounter++;
+                    }
+
+                    // Update the raster line value stored in the VIC registers.
+                    vic_cr4 = (verticalCounter >> 1);
+                    if ((verticalCounter & 0x01) == 0) {
+                        vic_cr3 &= 0x7F;
+                    } else {
+                        vic_cr3 |= 0x80;
+                    }
+
+                    // Line 0, and lines after vblank end, are visible. For those we output the full
+                    // sequence of CVBS commands for horizontal blanking, including the hsync and
+                    // colour burst. Otherwise it is vertical blanking and sync.
+                    uint8_t vblankKind = vic_vblank_kind(t, verticalCounter);
+                    vblanking = (vblankKind != VIC_VBLANK_NONE);
+                    if (!vblanking) {
+                        VIC_HBLANK_PUT(verticalCounter & 1);
+                    } else {
+                        VIC_VBLANK_PUT(vblankKind);
+
+                        // Vertical sync is what resets the video matrix latch.
+                        if (vblankKind == VIC_VBLANK_LONG) {
+                            videoMatrixLatch = videoMatrixCounter = 0;
+                        }
+                    }
+                    dvi_line = (uint8_t*)dvi_fb_line(verticalCounter);
+                    dvi_fb_beam = verticalCounter;
+                }
+
+                // Due to the "new line" signal being generated by the Horizontal Counter Reset
+                // logic, and the pass transistors used within it delaying the propagation of
+                // that signal, this signal doesn't get seen by components such as the Cell Depth
+                // Counter Reset logic, the "In Matrix" status logic, and Video Matrix Latch
+                // until HC = 1.
+
+                // The "new line" signal closes the matrix, if it is still open.
+                if (fetchState >= FETCH_MATRIX_DLY_1) {
+                    // The real chip appears to have another increment in this cycle, if the
+                    // state is FETCH_CHAR_DATA. Not 100% clear though, since distortion ensues
+                    // when setting the registers such that the matrix closes here.
+                    if (fetchState == FETCH_CHAR_DATA) {
+                        videoMatrixCounter++;
+                    }
+                    fetchState = FETCH_MATRIX_LINE;
+                }
+
+                // Check for Cell Depth Counter reset.
+                if ((cellDepthCounter == last_line_of_cell) || (cellDepthCounter == 0xF)) {
+                    // Reset CDC.
+                    cellDepthCounter = 0;
+
+                    // If last line was the last line of the character cell, then we latch
+                    // the current VMC value ready for the next character row.
+                    videoMatrixLatch = videoMatrixCounter;
+
+                    // Vertical Cell Counter decrements when CDC resets, unless its the first line,
+                    // since it was loaded instead (see VC reset logic in HC=2).
+                    if (verticalCounter > 0) {
+                        verticalCellCounter--;
+
+                        if ((verticalCellCounter == 0) && (screen_origin_x > 0)) {
+                            // If all text rows rendered, then we're outside the matrix again.
+                            fetchState = FETCH_OUTSIDE_MATRIX;
+                        } else {
+                            // NOTE: Due to comparison being prev HC, this is match HC=0.
+                            if (prevHorizontalCounter == screen_origin_x) {
+                                // Last line was in the matrix, so start the in matrix delay.
+                                fetchState = FETCH_MATRIX_DLY_1;
+                            }
+                        }
+                    }
+                }
+                else if (fetchState >= FETCH_MATRIX_LINE) {
+                    // If the line that just ended was a video matrix line, then increment CDC,
+                    // unless the VCC is 0, in which case close the matrix.
+                    if (verticalCellCounter > 0) {
+                        cellDepthCounter++;
+
+                        // NOTE: Due to comparison being prev HC, this is match HC=0.
+                        if (prevHorizontalCounter == screen_origin_x) {
+                            // Last line was in the matrix, so start the in matrix delay.
+                            fetchState = FETCH_MATRIX_DLY_1;
+                        }
+                    } else {
+                        fetchState = FETCH_OUTSIDE_MATRIX;
+                    }
+                }
+                else if (fetchState == FETCH_IN_MATRIX_Y) {
+                    // BUG: For the 6561 this logic is wrong, due to early screen origin y check in this cycle.
+                    // IDEA: Might need to introduce a prevFetchState.
+                    // NOTE: Bug doesn't affect NTSC version.
+
+                    // If fetchState is FETCH_IN_MATRIX_Y at this point, it means that the
+                    // last line matched the screen origin Y but not X. This results in the
+                    // matrix being rendered one line lower if X now matches, as per real chip.
+                    if (prevHorizontalCounter == screen_origin_x) {
+                        fetchState = FETCH_IN_MATRIX_X;
+                    }
+                }
+                else if (t->half_lines && (fetchState == FETCH_OUTSIDE_MATRIX)) {
+                    if ((verticalCounter >> 1) == screen_origin_y) {
+                        // This is the line the video matrix starts on. As in the real chip, we use
+                        // a different state for the first part of the first video matrix line.
+                        fetchState = FETCH_IN_MATRIX_Y;
+
+                        // Screen origin X can match in the same cycle as Y.
+                        if (prevHorizontalCounter == screen_origin_x) {
+                            fetchState = FETCH_MATRIX_DLY_1;
+                        }
+                    }
+                }
+
+                prevHorizontalCounter = horizontalCounter++;
+                break;
+
+            // HC = 2 is yet another special case, handled in a single block for ALL
+            // lines. This is when the horizontal cell counter is loaded.
+            case 2:
+
+                // Simplified state changes. We're in hblank, so its just the bare minimum.
+                if (fetchState == FETCH_IN_MATRIX_X) {
+                    // If screen origin x matched during HC=1, which can only mean that the screen
+                    // origin y matched on the previous line, then we move to second matrix delay
+                    // state, since the match happened in the previous cycle.
+                    fetchState = FETCH_MATRIX_DLY_2;
+                } else {
+                    // In theory, the screen code and char data states should not be possible at this point.
+                    VIC_FETCH_BLANK();
+                }
+
+                // Video Matrix Counter (VMC) is reloaded from latch on "new line" signal.
+                videoMatrixCounter = videoMatrixLatch;
+
+                // Horizontal Cell Counter (HCC) is reloaded on "new line" signal.
+                horizontalCellCounter = num_of_columns;
+                prevHorizontalCounter = horizontalCounter++;
+                break;
+
+            // HC = 3 is yet another special case, handled in a single block for ALL
+            // lines. This is when the vertical cell counter is loaded.
+            case 3:
+
+                // Simplified state changes. We're in hblank, so its just the bare minimum.
+                // In theory, the screen code and char data states should not be possible at this point.
+                VIC_FETCH_BLANK();
+
+                // Vertical Cell Counter is loaded 2 cycles after the VC resets.
+                // TODO: This probably needs to move for the 6560, as VC doesn't reset in HC=1.
+                if (verticalCounter == 0) {
+                    verticalCellCounter = num_of_rows;
+                }
+
+                prevHorizontalCounter = horizontalCounter++;
+                break;
+
+            // The following cases are the 6560 half-line events. For the 6561 they are
+            // ordinary cycles, so they fall straight through to the default block.
+
+            // HC = 64 is the last 6560 HC value, so triggers HC reset.
+            case VIC_HL_HC_LINE_END:
+                if (t->half_lines) {
+                    // Simplified state changes. We're in hblank, so its just the bare minimum.
+                    VIC_FETCH_BLANK();
+
+                    // And then reset HC.
+                    prevHorizontalCounter = horizontalCounter;
+                    horizontalCounter = 0;
+                    break;
+                }
+                __attribute__((fallthrough));
+
+            // HC = 62 is one of the two increment points for the 1/2 line counter. It is also when
+            // the vertical counter resets when in non-interlaced mode, and for interlaced mode where
+            // it resets every second field. It is also one of two points where vertical blanking
+            // and vertical sync can start and end.
+            case VIC_HL_HC_HALF_LINE:
+                if (t->half_lines) {
+                    if (interlaced_mode ? ((verticalCounter >= t->intl_last_line) && !halfLineCounter)
+                                        : (verticalCounter == t->last_line)) {
+                        // For non-interlaced mode, the vertical counter always resets at this point.
+                        // For interlaced mode, it resets here every second field, as controlled by
+                        // the half-line counter.
+                        verticalCounter = 0;
+                        fetchState = FETCH_OUTSIDE_MATRIX;
+                        cellDepthCounter = 0;
+                        halfLineCounter = 0;
+
+                        // Update raster line CR value to be 0.
+                        vic_cr4 = 0;
+                        vic_cr3 &= 0x7F;
+
+                        // Reset Pen latch
+                        *pen_dma_trans_reg = 1;
+                        TRACE_FRAME_MARK();
+                    } else {
+                        // Half line counter simply toggles between 0 and 1.
+                        halfLineCounter ^= 1;
+                    }
+
+                    // Output vertical blanking or vsync, if required. If the half-line counter is 1, then
+                    // vblank and vsync get delayed by half a line, i.e. to HC=29.
+                    if (!halfLineCounter) {
+                        uint8_t vblankKind = vic_vblank_kind(t, verticalCounter);
+                        vblanking = (vblankKind != VIC_VBLANK_NONE);
+                        if (vblanking) {
+                            VIC_VBLANK_PUT(vblankKind);
+
+                            // Vertical sync is what resets the video matrix latch.
+                            if (vblankKind == VIC_VBLANK_LONG) {
+                                videoMatrixLatch = videoMatrixCounter = 0;
+                            }
+                        }
+                    }
+
+                    // If we're not in vertical blanking, i.e. we didn't output the CVBS commands above,
+                    // then we continue horizontal blanking commands instead, including hsync and colour
+                    // burst. It will end at HC=9
+                    if (!vblanking) {
+                        VIC_HBLANK_PUT(oddLine);
+                    }
+                    oddLine = !oddLine;
+                }
+
+                //
+                // IMPORTANT: THE HC=62 CASE STATEMENT DELIBERATELY FALLS THROUGH TO NEXT BLOCK.
+                //
+                __attribute__((fallthrough));
+
+            // These 6560 HC values are always in blanking and have no special behaviour other than
+            // the standard state changes common to all cycles.
+            case 60:
+            case 61:
+            case 63:
+                if (t->half_lines) {
+                    // Simplified state changes. We're in hblank, so its just the bare minimum.
+                    VIC_FETCH_BLANK();
+                    prevHorizontalCounter = horizontalCounter++;
+                    break;
+                }
+                __attribute__((fallthrough));
+
+            // HC=29 is when the 6560 increments the vertical counter (VC). The 1/2 line counter also
+            // toggles at this time. This is therefore the end of the raster line as reported by
+            // the VIC registers, but is not the actual end of the raster, as that happens when the
+            // hsync occurs at HC=62.
+            case VIC_HL_HC_VC_INC:
+                if (t->half_lines) {
+                    // NOTE: The VC always resets at HC=62 when in non-interlaced mode, but for interlaced,
+                    // it can reset in HC=29 as controlled by the half-line counter.
+                    if (interlaced_mode && (verticalCounter == t->intl_last_line) && !halfLineCounter) {
+                        // For interlaced mode, the vertical counter resets every second field at HC=29.
+                        verticalCounter = 0;
+                        fetchState = FETCH_OUTSIDE_MATRIX;
+                        cellDepthCounter = 0;
+                        halfLineCounter = 0;
+                    } else {
+                        // Otherwise increment vertical counter.
+                        verticalCounter++;
+
+                        // Half line counter simply toggles between 0 and 1.
+                        halfLineCounter ^= 1;
+                    }
+
+                    // Update the raster line value stored in the VIC registers. Note that this is
+                    // correct for NTSC, i.e. the VIC control registers for the raster value do
+                    // change at HC=29 (not at HC=1 like PAL does). It can also change at HC=62,
+                    // if the VC is reset to 0 during that cycle.
+                    vic_cr4 = (verticalCounter >> 1);
+                    if ((verticalCounter & 0x01) == 0) {
+                        vic_cr3 &= 0x7F;
+                    } else {
+                        vic_cr3 |= 0x80;
+                    }
+
+                    // Output vertical blanking or vsync, if required. If the half-line counter is 1, then
+                    // vblank and vsync get delayed by half a line, i.e. to HC=62.
+                    // Actual FIFO submission moved to the end of the cycle (default case) to counter FIFO overruns.
+                    if (!halfLineCounter) {
+                        do_vblank = vic_vblank_kind(t, verticalCounter);
+                        vblanking = (do_vblank != VIC_VBLANK_NONE);
+
+                        // Vertical sync is what resets the video matrix latch.
+                        if (do_vblank == VIC_VBLANK_LONG) {
+                            videoMatrixLatch = videoMatrixCounter = 0;
+                        }
+                    }
+                }
+
+                //
+                // IMPORTANT: THE HC=29 CASE STATEMENT DELIBERATELY FALLS THROUGH TO THE DEFAULT BLOCK.
+                //
+                __attribute__((fallthrough));
+
+            // Covers HC=4 and above, up to HC=HBLANKSTART (e.g. HC=70 for PAL)
+            default:
+
+                if (!vblanking) {
+                    // Whether this cycle shows any pixels, and whether it shows all four.
+                    bool visibleCycle = (horizontalCounter >= t->hblank_end);
+                    bool fullCycle = t->hblank_end_partial ? (horizontalCounter > t->hblank_end) : visibleCycle;
+
+                    // Is the visible part of the line ending now and horizontal blanking starting?
+                    if (horizontalCounter == t->hblank_start) {
+                        if (t->palette == VIC_PALETTE_LINES) {
+                            // Horizontal blanking doesn't start until 3.66 pixels in. What exactly those
+                            // pixels are depends on the fetch state. The 4th is truncated.
+                            dvi_word = 0;
+                            switch (fetchState) {
+                                case FETCH_OUTSIDE_MATRIX:
+                                    if ((verticalCounter >> 1) == screen_origin_y) {
+                                        // This is the line the video matrix starts on. As in the real chip, we use
+                                        // a different state for the first part of the first video matrix line.
+                                        fetchState = FETCH_IN_MATRIX_Y;
+
+                                        // Screen origin X can match in the same cycle as Y.
+                                        if (prevHorizontalCounter == screen_origin_x) {
+                                            fetchState = FETCH_MATRIX_DLY_1;
+                                        }
+                                    }
+                                    borderColourIndex = border_colour_index;
+                                    CVBS_RING_PUT(linePalette[borderColourIndex].cvbs);
+                                    CVBS_RING_PUT(linePalette[borderColourIndex].cvbs);
+                                    CVBS_RING_PUT(linePalette[borderColourIndex].cvbs);
+                                    CVBS_RING_PUT(lineTruncPalette[borderColourIndex].cvbs);
+                                    VIC_DVI_PUT(DVI_PX4(linePalette[borderColourIndex].rgb332));
+                                    break;
+
+                                case FETCH_MATRIX_LINE:
+                                    // Look up latest background, border and auxiliary colours.
+                                    multiColourTable[0] = background_colour_index;
+                                    multiColourTable[1] = border_colour_index;
+                                    multiColourTable[3] = auxiliary_colour_index;
+
+                                    VIC_PIXEL(multiColourTable[pixel2], 0);
+                                    VIC_PIXEL(multiColourTable[pixel3], 1);
+                                    VIC_PIXEL(multiColourTable[pixel4], 2);
+                                    VIC_PIXEL_TRUNC(multiColourTable[pixel5], 3);
+                                    VIC_DVI_PUT(dvi_word);
+                                    break;
+
+                                case FETCH_MATRIX_DLY_1:
+                                case FETCH_MATRIX_DLY_2:
+                                case FETCH_MATRIX_DLY_3:
+                                    fetchState++;
+                                    __attribute__((fallthrough));
+                                case FETCH_IN_MATRIX_Y:
+                                    borderColourIndex = border_colour_index;
+                                    CVBS_RING_PUT(linePalette[borderColourIndex].cvbs);
+                                    CVBS_RING_PUT(linePalette[borderColourIndex].cvbs);
+                                    CVBS_RING_PUT(linePalette[borderColourIndex].cvbs);
+                                    CVBS_RING_PUT(lineTruncPalette[borderColourIndex].cvbs);
+                                    VIC_DVI_PUT(DVI_PX4(linePalette[borderColourIndex].rgb332));
+                                    break;
+
+                                case FETCH_SCREEN_CODE:
+                                    // Look up latest background, border and auxiliary colours.
+                                    multiColourTable[0] = background_colour_index;
+                                    multiColourTable[1] = border_colour_index;
+                                    multiColourTable[3] = auxiliary_colour_index;
+
+                                    // First 3 wholes pixels are from end of current character.
+                                    VIC_PIXEL(multiColourTable[pixel6], 0);
+                                    VIC_PIXEL(multiColourTable[pixel7], 1);
+
+                                    // We only need to calculate 8th & 1st pixel in this scenario. Hblanking is about to start.
+                                    // New reverse mode value kicks in a pixel before new character.
+                                    pixel8 = VIC_LUT_PIXEL(vic_lut_cell(charData, hiresMode, non_reverse_mode), 8);
+
+                                    // Update the operating hires state and char data immediately prior to
+                                    // shifting out new character pixel.
+                                    hiresMode = ((colourData & 0x08) == 0);
+                                    charData = charDataLatch;
+
+                                    // Pixel 1 should be same reverse mode but pick up the new hires mode.
+                                    pixel1 = VIC_LUT_PIXEL(vic_lut_cell(charData, hiresMode, non_reverse_mode), 1);
+
+                                    // The 3rd pixel is from the previous character with new reverse mode applied (see above).
+                                    VIC_PIXEL(multiColourTable[pixel8], 2);
+
+                                    // Look up foreground colour before outputting first pixel of new character.
+                                    multiColourTable[2] = (colourData & 0x07);
+
+                                    // The 4th pixel is partial before horiz blanking kicks in.
+                                    VIC_PIXEL_TRUNC(multiColourTable[pixel1], 3);
+                                    VIC_DVI_PUT(dvi_word);
+
+                                    fetchState = ((horizontalCellCounter-- > 0)? FETCH_CHAR_DATA : FETCH_MATRIX_END);
+                                    break;
+
+                                case FETCH_CHAR_DATA:
+                                case FETCH_MATRIX_END:
+                                    // Look up latest background, border and auxiliary colours.
+                                    multiColourTable[0] = background_colour_index;
+                                    multiColourTable[1] = border_colour_index;
+                                    multiColourTable[3] = auxiliary_colour_index;
+
+                                    // Output the three whole pixels, then the 4th is a partial pixel
+                                    // before horizontal blanking kicks in.
+                                    VIC_PIXEL(multiColourTable[pixel2], 0);
+                                    VIC_PIXEL(multiColourTable[pixel3], 1);
+                                    VIC_PIXEL(multiColourTable[pixel4], 2);
+                                    VIC_PIXEL_TRUNC(multiColourTable[pixel5], 3);
+                                    VIC_DVI_PUT(dvi_word);
+
+                                    // If the matrix hasn't yet closed, then in the FETCH_CHAR_DATA
+                                    // state, we need to keep incrementing the video matrix counter
+                                    // until it is closed, which at the latest could be HC=1 on the
+                                    // next line.
+                                    if (fetchState == FETCH_MATRIX_END) {
+                                        // Leaving the matrix
+                                        fetchState = FETCH_MATRIX_LINE;
+                                    } else {
+                                        // Increment the video matrix counter to next cell.
+                                        videoMatrixCounter++;
+
+                                        // Toggle fetch state. For efficiency, HCC deliberately not checked here.
+                                        fetchState = FETCH_SCREEN_CODE;
+                                    }
+                                    break;
+                            }
+                        } else {
+                            // Horizontal blanking starts here. Simplified state changes, so its just the bare minimum.
+                            VIC_FETCH_BLANK();
+                        }
+
+                        // We output the start of horiz blanking here, enough of it to last until the
+                        // rest is queued, at HC=1 for the 6561 and HC=62 for the 6560, where a decision is
+                        // made as to whether it will be horizontal blanking or vertical blanking. This is
+                        // why there is a part 1 and 2 of the front porch.
+                        CVBS_RING_PUT(t->frontporch_1);
+
+                        // For the 6561 the line ends with hblank start, so reset HC to start a new line.
+                        // The 6560 hblank starts 6 cycles before the HC reset, so we increment.
+                        prevHorizontalCounter = horizontalCounter;
+                        if (t->half_lines) {
+                            horizontalCounter++;
+                        } else {
+                            horizontalCounter = 0;
+                        }
+                    }
+                    else {
+                        // Covers visible line cycles from HC=4 to 1 cycle before HC=HBLANKSTART.
+                        // With a partial hblank_end cycle (PAL HC=12) only the last of the four pixels
+                        // shows, as the first three "pixels" are part of the horizontal blanking. Note
+                        // that the third one is due to the switch delay in hblank turning off.
+                        switch (fetchState) {
+                            case FETCH_OUTSIDE_MATRIX:
+                                if ((verticalCounter >> 1) == screen_origin_y) {
+                                    // This is the line the video matrix starts on. As in the real chip, we use
+                                    // a different state for the first part of the first video matrix line.
+                                    fetchState = FETCH_IN_MATRIX_Y;
+
+                                    // Screen origin X can match in the same cycle as Y.
+                                    if (prevHorizontalCounter == screen_origin_x) {
+                                        fetchState = FETCH_MATRIX_DLY_1;
+                                    }
+                                }
+                                if (visibleCycle) {
+                                    // Output four border pixels.
+                                    borderColourIndex = border_colour_index;
+                                    VIC_BORDER(borderColourIndex);
+                                }
+                                // Nothing to do otherwise. Still in horizontal blanking.
+                                break;
+
+                            case FETCH_IN_MATRIX_Y:
+                            case FETCH_MATRIX_LINE:
+                                if (visibleCycle) {
+                                    // Look up very latest background, border and auxiliary colour values.
+                                    multiColourTable[0] = background_colour_index;
+                                    multiColourTable[1] = border_colour_index;
+                                    multiColourTable[3] = auxiliary_colour_index;
+
+                                    dvi_word = 0;
+                                    if (fullCycle) {
+                                        VIC_PIXEL(multiColourTable[pixel6], 0);
+                                        VIC_PIXEL(multiColourTable[pixel7], 1);
+                                    }
+
+                                    // Handle the last pixel of the last char of the current matrix row.
+                                    pixel8 = VIC_LUT_PIXEL(vic_lut_cell(charData, hiresMode, non_reverse_mode), 8);
+
+                                    hiresMode = false;
+                                    colourData = 0x08;
+                                    charData = charDataLatch = 0x55;
+                                    pixel1 = ((charData >> 6) & 0x03);
+
+                                    if (fullCycle) {
+                                        VIC_PIXEL(multiColourTable[pixel8], 2);
+                                    }
+                                    VIC_PIXEL(multiColourTable[pixel1], 3);
+                                    VIC_DVI_PUT(dvi_word);
+
+                                    pixel6 = pixel2 = pixel1;
+                                    pixel7 = pixel3 = ((charData >> 4) & 0x03);
+                                    pixel8 = pixel1 = pixel2 = pixel3 = pixel4 = pixel5 = 1;
+
+                                    if (prevHorizontalCounter == screen_origin_x) {
+                                        // Last 4 pixels before first char renders are still border.
+                                        fetchState = FETCH_MATRIX_DLY_1;
+                                    }
+                                }
+                                else if (prevHorizontalCounter == screen_origin_x) {
+                                    // Still in horizontal blanking, but we still need to prepare for the case
+                                    // where the next cycle isn't in horiz blanking, i.e. HC=hblank_end-1 this cycle.
+                                    fetchState = FETCH_MATRIX_DLY_1;
+                                }
+                                break;
+
+                            case FETCH_MATRIX_DLY_1:
+                            case FETCH_MATRIX_DLY_2:
+                            case FETCH_MATRIX_DLY_3:
+                                if (visibleCycle) {
+                                    // Output four border pixels.
+                                    borderColourIndex = border_colour_index;
+                                    VIC_BORDER(borderColourIndex);
+                                }
+                                else {
+                                    pixel2 = pixel3 = pixel4 = pixel5 = pixel6 = pixel7 = pixel8 = 1;
+                                }
+
+                                // Prime the pixel output queue with border pixels in multicolour
+                                // mode. Not quite what the real chip does but is functionally equivalent.
+                                hiresMode = false;
+                                colourData = 0x08;
+                                charDataLatch = 0x55;
+
+                                fetchState++;
+                                break;
+
+                            case FETCH_SCREEN_CODE:
+
+                                // Look up very latest background, border and auxiliary colour values.
+                                multiColourTable[0] = background_colour_index;
+                                multiColourTable[1] = border_colour_index;
+                                multiColourTable[3] = auxiliary_colour_index;
+
+                                // Output last 3 pixels of the last character. These had already left
+                                // the shift register but in the delay path to the colour lookup.
+                                dvi_word = 0;
+                                if (fullCycle) {
+                                    VIC_PIXEL(multiColourTable[pixel6], 0);
+                                    VIC_PIXEL(multiColourTable[pixel7], 1);
+                                }
+
+                                // New reverse mode value kicks in a pixel before new character.
+                                pixel8 = VIC_LUT_PIXEL(vic_lut_cell(charData, hiresMode, non_reverse_mode), 8);
+
+                                // Update the operating hires state and char data immediately prior to
+                                // shifting out new character pixel.
+                                hiresMode = ((colourData & 0x08) == 0);
+                                charData = charDataLatch;
+
+                                // Pixel 1 should be same reverse mode but pick up the new hires mode.
+                                cellPixels = vic_lut_cell(charData, hiresMode, non_reverse_mode);
+                                pixel1 = VIC_LUT_PIXEL(cellPixels, 1);
+                                pixel2 = VIC_LUT_PIXEL(cellPixels, 2);
+                                pixel3 = VIC_LUT_PIXEL(cellPixels, 3);
+
+                                // The 3rd pixel is from the previous character with new reverse mode applied (see above).
+                                if (fullCycle) {
+                                    VIC_PIXEL(multiColourTable[pixel8], 2);
+                                }
+
+                                // Look up foreground colour before outputting first pixel.
+                                multiColourTable[2] = (colourData & 0x07);
+
+                                // Calculate address within video memory and fetch cell index.
+                                //Assuming 0x0---, 0x3---- and 0x20-- as connected address space
+                                uint16_t screen_addr = screenMemStart + videoMatrixCounter;
+                                switch((screen_addr >> 10) & 0xF){
+                                    case  4 ... 7:
+                                    case  9 ... 11:
+                                        cellIndex = XUNCON_REG;
+                                        break;
+                                    default:
+                                        cellIndex = xram[screen_addr];
+                                        break;
+                                }
+
+                                // Due to the way the colour memory is wired up, the above fetch of the cell index
+                                // also happens to automatically fetch the foreground colour from the Colour Matrix
+                                // via the top 4 lines of the data bus (DB8-DB11), which are wired directly from
+                                // colour RAM in to the VIC chip.
+                                colourData = xram[0x1400 + (screen_addr & 0x3ff)];
+
+                                // Output the 1st pixel of next character. Note that this is not the character
+                                // that relates to the cell index and colour data fetched above.
+                                if (visibleCycle) {
+                                    VIC_PIXEL(multiColourTable[pixel1], 3);
+                                    VIC_DVI_PUT(dvi_word);
+                                }
+
+                                // Toggle fetch state. Close matrix if HCC hits zero.
+                                fetchState = ((horizontalCellCounter-- > 0)? FETCH_CHAR_DATA : FETCH_MATRIX_END);
+                                break;
+
+                            case FETCH_CHAR_DATA:
+                            case FETCH_MATRIX_END:
+
+                                // Look up very latest background, border and auxiliary colour values.
+                                multiColourTable[0] = background_colour_index;
+                                multiColourTable[1] = border_colour_index;
+                                multiColourTable[3] = auxiliary_colour_index;
+
+                                dvi_word = 0;
+                                if (fullCycle) {
+                                    VIC_PIXEL(multiColourTable[pixel2], 0);
+                                    VIC_PIXEL(multiColourTable[pixel3], 1);
+                                }
+
+                                // Calculate offset of data.
+                                charDataOffset = charMemStart + (cellIndex << char_size_shift) + cellDepthCounter;
+
+                                // Fetch cell data.  It can wrap around, which is why we & with 0x3FFF.
+                                // Initially latched to the side until it is needed.
+                                //Assuming 0x0---, 0x3---- and 0x20-- as connected address space
+                                switch((charDataOffset >> 10) & 0xF ){
+                                    case  4 ... 7:
+                                    case  9 ... 11:
+                                         charDataLatch = XUNCON_REG;
+                                         break;
+                                    default:
+                                         charDataLatch = xram[(charDataOffset & 0x3FFF)];
+                                         break;
+                                }
+
+                                // Pixels 4-7 calculations are less complex, since the hires mode,
+                                // reverse mode and char data stay the same four all four pixels.
+                                cellPixels = vic_lut_cell(charData, hiresMode, non_reverse_mode);
+                                pixel4 = VIC_LUT_PIXEL(cellPixels, 4);
+                                pixel5 = VIC_LUT_PIXEL(cellPixels, 5);
+                                pixel6 = VIC_LUT_PIXEL(cellPixels, 6);
+                                pixel7 = VIC_LUT_PIXEL(cellPixels, 7);
+
+                                // Pixels 4 & 5 have to be output after the pixel var calculations above.
+                                if (fullCycle) {
+                                    VIC_PIXEL(multiColourTable[pixel4], 2);
+                                }
+                                if (visibleCycle) {
+                                    VIC_PIXEL(multiColourTable[pixel5], 3);
+                                    VIC_DVI_PUT(dvi_word);
+                                }
+
+                                if (fetchState == FETCH_MATRIX_END) {
+                                    // Leaving the matrix
+                                    fetchState = FETCH_MATRIX_LINE;
+                                } else {
+                                    // Increment the video matrix counter to next cell.
+                                    videoMatrixCounter++;
+
+                                    // Toggle fetch state. For efficiency, HCC deliberately not checked here.
+                                    fetchState = FETCH_SCREEN_CODE;
+                                }
+                                break;
+                        }
+
+                        prevHorizontalCounter = horizontalCounter++;
+                    }
+                } else {
+                    // Inside vertical blanking. The CVBS commands for each line were already sent during
+                    // HC=1 (6561), HC=62, or decided in HC=29 and output here (6560, to avoid FIFO overruns).
+                    // In case the screen origin Y is set within the vertical blanking lines, we still need
+                    // to update the fetch state, video matrix counter, and the horizontal cell counter,
+                    // even though we're not outputting character pixels. So for the rest of the line, it
+                    // is a simplified version of the standard line, except that we don't output any pixels.
+                    VIC_FETCH_BLANK();
+
+                    // Delayed FIFO put to avoid overrun
+                    if (do_vblank != VIC_VBLANK_NONE) {
+                        VIC_VBLANK_PUT(do_vblank);
+                        do_vblank = VIC_VBLANK_NONE;
+                    }
+
+                    // For the 6560 the horizontal counter reset always happens within the HC=64 case
+                    // statement, so we only need to cater for HC increments here.
+                    prevHorizontalCounter = horizontalCounter;
+                    if (!t->half_lines && (horizontalCounter == t->hblank_start)) {
+                        horizontalCounter = 0;
+                    } else {
+                        horizontalCounter++;
+                    }
+                }
+                break;
+        }
+
+        aud_tick_inline((uint32_t*)&vic_cra);
+        cvbs_ring_flush(cvbs_head);
+        PROF_END();
+    }
+}
+
+#endif /* _VIC_CORE_H_ */
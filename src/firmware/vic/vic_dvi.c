@@ -5,6 +5,7 @@
 */
 
 #include "main.h"
+#include "vic/cvbs.h"
 #include "vic/vic.h"
 #include "vic/vic_dvi.h"
 #include "sys/cfg.h"
@@ -16,10 +17,10 @@
 dvi_modeline_t vic_dvi_pal_modes[] = {
 //dvi_modeline_t vic_pal_mode_640x480p75 = 
 {
-    .pixel_format = dvi_4_rgb332,
+    .pixel_format = dvi_8_pal16,
     .scale_x = 3,
     .scale_y = 2,
-    .offset_x = 8,
+    .offset_x = 11,
     .offset_y = 40,
     .hstx_div = 2,
     .h_front_porch = 16,
@@ -35,10 +36,10 @@ dvi_modeline_t vic_dvi_pal_modes[] = {
 },
 //dvi_modeline_t vic_pal_mode_640x480p60 = 
 {
-    .pixel_format = dvi_4_rgb332,
+    .pixel_format = dvi_8_pal16,
     .scale_x = 3,
     .scale_y = 2,
-    .offset_x = 8,
+    .offset_x = 11,
     .offset_y = 40,
     .hstx_div = 2,
     .h_front_porch = 16,
@@ -54,10 +55,10 @@ dvi_modeline_t vic_dvi_pal_modes[] = {
 },
 //dvi_modeline_t vic_pal_mode_720x480p60x3 = 
 {
-    .pixel_format = dvi_4_rgb332,
+    .pixel_format = dvi_8_pal16,
     .scale_x = 3,
     .scale_y = 2,
-    .offset_x = -4,
+    .offset_x = -1,
     .offset_y = 42,
     .hstx_div = 2,
     .h_front_porch = 16,
@@ -73,10 +74,10 @@ dvi_modeline_t vic_dvi_pal_modes[] = {
 },
 //dvi_modeline_t vic_pal_mode_720x480p60x2 = 
 {
-    .pixel_format = dvi_4_rgb332,
+    .pixel_format = dvi_8_pal16,
     .scale_x = 2,
     .scale_y = 1,
-    .offset_x = -80,
+    .offset_x = -77,
     .offset_y = -60,
     .hstx_div = 2,
     .h_front_porch = 16,
@@ -92,10 +93,10 @@ dvi_modeline_t vic_dvi_pal_modes[] = {
 },
 //dvi_modeline_t vic_pal_mode_720x576p50 = 
 {
-    .pixel_format = dvi_4_rgb332,
+    .pixel_format = dvi_8_pal16,
     .scale_x = 3,
     .scale_y = 2,
-    .offset_x = -5,
+    .offset_x = -2,
     .offset_y = 25,
     .hstx_div = 2,
     .h_front_porch = 12,
@@ -111,10 +112,10 @@ dvi_modeline_t vic_dvi_pal_modes[] = {
 },
 //dvi_modeline_t vic_pal_mode_856x576p50 = 
 {
-    .pixel_format = dvi_4_rgb332,
+    .pixel_format = dvi_8_pal16,
     .scale_x = 3,
     .scale_y = 2,
-    .offset_x = -25,
+    .offset_x = -22,
     .offset_y = 25,
     .hstx_div = 2,
     .h_front_porch = 24,
@@ -130,10 +131,10 @@ dvi_modeline_t vic_dvi_pal_modes[] = {
 },
 //dvi_modeline_t vic_pal_mode_800x600p54 = 
 {
-    .pixel_format = dvi_4_rgb332,
+    .pixel_format = dvi_8_pal16,
     .scale_x = 3,
     .scale_y = 2,
-    .offset_x = -18,
+    .offset_x = -15,
     .offset_y = 5,
     .hstx_div = 2,
     .h_front_porch = 48,
@@ -149,10 +150,10 @@ dvi_modeline_t vic_dvi_pal_modes[] = {
 },
 //dvi_modeline_t vic_pal_mode_1280x720p50 = 
 {
-    .pixel_format = dvi_4_rgb332,
+    .pixel_format = dvi_8_pal16,
     .scale_x = 5,
     .scale_y = 3,
-    .offset_x = -12,
+    .offset_x = -9,
     .offset_y = 40,
     .hstx_div = 1,
     .h_front_porch = 128,
@@ -168,10 +169,10 @@ dvi_modeline_t vic_dvi_pal_modes[] = {
 },
 //dvi_modeline_t vic_pal_mode_1024x768p60 = 
 {
-    .pixel_format = dvi_4_rgb332,
+    .pixel_format = dvi_8_pal16,
     .scale_x = 5,
     .scale_y = 3,
-    .offset_x = 12,
+    .offset_x = 15,
     .offset_y = 30,
     .hstx_div = 1,
     .h_front_porch = 24,
@@ -191,7 +192,7 @@ dvi_modeline_t vic_dvi_pal_modes[] = {
 dvi_modeline_t vic_dvi_ntsc_modes[] = {
 //dvi_modeline_t vic_ntsc_mode_640x480p75 = 
 {
-    .pixel_format = dvi_4_rgb332,
+    .pixel_format = dvi_8_pal16,
     .scale_x = 3,
     .scale_y = 2,
     .offset_x = -7,
@@ -210,7 +211,7 @@ dvi_modeline_t vic_dvi_ntsc_modes[] = {
 },
 //dvi_modeline_t vic_ntsc_mode_640x480p60 = 
 {
-    .pixel_format = dvi_4_rgb332,
+    .pixel_format = dvi_8_pal16,
     .scale_x = 3,
     .scale_y = 2,
     .offset_x = -7,
@@ -229,7 +230,7 @@ dvi_modeline_t vic_dvi_ntsc_modes[] = {
 },
 //dvi_modeline_t vic_ntsc_mode_720x480p60x3 = 
 {
-    .pixel_format = dvi_4_rgb332,
+    .pixel_format = dvi_8_pal16,
     .scale_x = 3,//2,
     .scale_y = 2,//1,
     .offset_x = -20,//-80,
@@ -248,7 +249,7 @@ dvi_modeline_t vic_dvi_ntsc_modes[] = {
 },
 //dvi_modeline_t vic_ntsc_mode_720x480p60px2 = 
 {
-    .pixel_format = dvi_4_rgb332,
+    .pixel_format = dvi_8_pal16,
     .scale_x = 2,
     .scale_y = 1,
     .offset_x = -80,
@@ -267,7 +268,7 @@ dvi_modeline_t vic_dvi_ntsc_modes[] = {
 },
 //dvi_modeline_t vic_ntsc_mode_720x524p60 = 
 {
-    .pixel_format = dvi_4_rgb332,
+    .pixel_format = dvi_8_pal16,
     .scale_x = 3,
     .scale_y = 2,
     .offset_x = -20,
@@ -286,7 +287,7 @@ dvi_modeline_t vic_dvi_ntsc_modes[] = {
 },
 //dvi_modeline_t vic_ntsc_mode_720x576p60 = 
 {
-    .pixel_format = dvi_4_rgb332,
+    .pixel_format = dvi_8_pal16,
     .scale_x = 3,
     .scale_y = 2,
     .offset_x = -20,
@@ -305,7 +306,7 @@ dvi_modeline_t vic_dvi_ntsc_modes[] = {
 },
 //dvi_modeline_t vic_ntsc_mode_800x600p54 = 
 {
-    .pixel_format = dvi_4_rgb332,
+    .pixel_format = dvi_8_pal16,
     .scale_x = 3,
     .scale_y = 2,
     .offset_x = -35,
@@ -324,7 +325,7 @@ dvi_modeline_t vic_dvi_ntsc_modes[] = {
 },
 //dvi_modeline_t vic_ntsc_mode_1280x720p60 = 
 {
-    .pixel_format = dvi_4_rgb332,
+    .pixel_format = dvi_8_pal16,
     .scale_x = 6,
     .scale_y = 3,
     .offset_x = -10,
@@ -343,7 +344,7 @@ dvi_modeline_t vic_dvi_ntsc_modes[] = {
 },
 //dvi_modeline_t vic_ntsc_mode_1024x768p60 = 
 {
-    .pixel_format = dvi_4_rgb332,
+    .pixel_format = dvi_8_pal16,
     .scale_x = 5,
     .scale_y = 3,
     .offset_x = -2,
@@ -364,18 +365,35 @@ dvi_modeline_t vic_dvi_ntsc_modes[] = {
 
 };
 
+//Framebuffer the cores write, cycles HC=hblank_end to hblank_start of 4 pixels
+//and VC 0 to the last line, interlaced for NTSC
+#define VIC_DVI_PAL_WIDTH   ((70 - 12 + 1) * 4)
+#define VIC_DVI_PAL_HEIGHT  312
+#define VIC_DVI_NTSC_WIDTH  ((59 - 9 + 1) * 4)
+#define VIC_DVI_NTSC_HEIGHT 263
+
+//Packed modes keep the colour index in the framebuffer, set before core1 starts
+static void vic_dvi_init_palette(void){
+    dvi_set_palette(cvbs_rgb332, 16);
+    cvbs_set_dvi_index(dvi_fb_packed);
+}
+
 void vic_dvi_init_ntsc(void){
     uint8_t dvi_mode = cfg_get_dvi();
     if(dvi_mode > count_of(vic_dvi_ntsc_modes))
         dvi_mode = 0;
+    dvi_set_fb_size(VIC_DVI_NTSC_WIDTH, VIC_DVI_NTSC_HEIGHT);
     dvi_set_modeline(&vic_dvi_ntsc_modes[dvi_mode]);
+    vic_dvi_init_palette();
 }
 
 void vic_dvi_init_pal(void){
     uint8_t dvi_mode = cfg_get_dvi();
     if(dvi_mode > count_of(vic_dvi_pal_modes))
         dvi_mode = 0;
+    dvi_set_fb_size(VIC_DVI_PAL_WIDTH, VIC_DVI_PAL_HEIGHT);
     dvi_set_modeline(&vic_dvi_pal_modes[dvi_mode]);
+    vic_dvi_init_palette();
 }
 
 
@@ -0,0 +1,25 @@
+/*
+ * Copyright (c) 2026 Sodiumlightbaby
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "vic/vic_lut.h"
+#include "pico/stdlib.h"
+
+// Core1 only tables, kept in scratch X next to the core1 stack
+uint16_t __scratch_x("vic_lut") vic_lut_hires[256];
+uint16_t __scratch_x("vic_lut") vic_lut_multi[256];
+
+void vic_lut_init(void){
+    for(uint32_t data = 0; data < 256; data++){
+        uint16_t hires = 0;
+        uint16_t multi = 0;
+        for(uint32_t bit = 0; bit < 8; bit++){
+            hires = (hires << 2) | ((data & (0x80 >> bit)) ? 2 : 0);
+            multi = (multi << 2) | ((data >> (6 - (bit & ~1u))) & 0x03);
+        }
+        vic_lut_hires[data] = hires;
+        vic_lut_multi[data] = multi;
+    }
+}
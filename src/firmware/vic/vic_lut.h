@@ -0,0 +1,31 @@
+/*
+ * Copyright (c) 2026 Sodiumlightbaby
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef _VIC_LUT_H_
+#define _VIC_LUT_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Char data to pixel colour index expansion. Each entry packs the indices of
+// the eight pixels of a cell, 2 bits each, pixel1 in the top bits.
+// Hires gives 2 (foreground) or 0 (background) per bit, reversed hires is the
+// entry of the inverted byte. Multicolour gives four doubled indices.
+extern uint16_t vic_lut_hires[256];
+extern uint16_t vic_lut_multi[256];
+
+#define VIC_LUT_PIXEL(cell, n) (((cell) >> (16 - 2 * (n))) & 0x03)
+
+void vic_lut_init(void);
+
+static inline __attribute__((always_inline)) uint16_t vic_lut_cell(uint8_t data, bool hires, bool non_reverse){
+    if (hires) {
+        return vic_lut_hires[non_reverse ? data : (uint8_t)~data];
+    }
+    return vic_lut_multi[data];
+}
+
+#endif /* _VIC_LUT_H_ */
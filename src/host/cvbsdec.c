@@ -0,0 +1,872 @@
+/*
+ * Copyright (c) 2026 Sodiumlightbaby
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+// Offline composite video check of a CVBS command stream. The commands are
+// played through the cvbs_pal/cvbs_ntsc PIO programs on pio_sim, sampling the
+// 5 bit DAC every sys clock, and the waveform is decoded the way a TV would:
+// sync separation, burst phase lock, ACC and synchronous U/V demodulation
+// with the PAL V switch. The stream is a vicsim -c capture or the colour bar
+// test image of vic/cvbs.c, built from the current or a saved palette.
+
+#include "main.h"
+#include "pio_asm.h"
+#include "pio_sim.h"
+#include "vic/vic.h"
+#include "vic/cvbs.h"
+#include "vic/cvbs_ntsc.h"
+#include "vic/cvbs_pal.h"
+#include <complex.h>
+#include <errno.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifndef CVBSDEC_FIRMWARE_DIR
+#define CVBSDEC_FIRMWARE_DIR "."
+#endif
+
+#define CVBSDEC_BROAD_US   10.0     // Longer sync pulses are vertical sync
+#define CVBSDEC_HSYNC_US   3.5      // Shorter sync pulses are equalising
+#define CVBSDEC_BURST_US   6.0      // Burst search window after hsync
+#define CVBSDEC_MIN_BURST  0.5      // DAC steps, below this the line has no burst
+#define CVBSDEC_MIN_SAT    1.0      // IRE, below this a colour has no hue
+#define CVBSDEC_SCOPE_SIZE 256
+#define CVBSDEC_SCOPE_IRE  64.0     // Vectorscope radius
+
+#define CVBSDEC_COUNT(a) (sizeof(a) / sizeof((a)[0]))
+
+typedef struct {
+    const char *name;
+    const char *cvbs;
+    uint8_t mode;               // VIC_MODE_*
+    unsigned sys_khz;
+    unsigned dot_div;           // sys clocks per dot
+    unsigned period;            // sys clocks per subcarrier cycle
+    unsigned line_dots;
+    double sync_ire;            // Sync depth and burst amplitude, PAL in % of 700mV
+    double burst_ire;
+    bool pal;
+} cvbsdec_std_t;
+
+static const cvbsdec_std_t cvbsdec_pal = {
+    "PAL", "cvbs_pal", VIC_MODE_PAL, 319200, 72, 72, 284, 300.0 / 7, 150.0 / 7, true};
+static const cvbsdec_std_t cvbsdec_ntsc = {
+    "NTSC", "cvbs_ntsc", VIC_MODE_NTSC, 315000, 77, 88, 260, 40.0, 20.0, false};
+
+typedef struct {
+    size_t t0;                  // Sync leading edge
+    size_t sync_end;
+    double blank;               // Burst DC level in DAC steps
+    double complex burst;       // Mean burst phasor, 0 if none
+    double burst_cycles;
+    int v_sign;                 // PAL V switch
+} cvbsdec_line_t;
+
+static const cvbsdec_std_t *cvbsdec_std = &cvbsdec_pal;
+static const char *cvbsdec_dir = CVBSDEC_FIRMWARE_DIR;
+static cvbs_palette_t cvbsdec_palette;
+static bool cvbsdec_pal_simple;
+
+// Command stream, start of each command in the waveform and its colour
+static uint32_t *cvbsdec_cmds;
+static size_t cvbsdec_cmd_count;
+static size_t cvbsdec_cmd_cap;
+static size_t *cvbsdec_cmd_start;
+static uint8_t *cvbsdec_cmd_colour;
+
+// DAC level every sys clock
+static uint8_t *cvbsdec_wave;
+static size_t cvbsdec_wave_len;
+
+static cvbsdec_line_t *cvbsdec_lines;
+static size_t cvbsdec_line_count;
+static size_t *cvbsdec_vsyncs;
+static size_t cvbsdec_vsync_count;
+
+static double cvbsdec_line_period;         // Measured, in sys clocks
+static uint8_t cvbsdec_tip;
+static double cvbsdec_blank;
+static double cvbsdec_ire_per_dac;
+static double cvbsdec_chroma_gain;          // IRE per DAC step of chroma, 0 for colour killed
+static double complex cvbsdec_rot;          // Burst reference to the V - jU frame
+static double complex cvbsdec_lo[128];      // Local oscillator, one subcarrier cycle
+
+static void *cvbsdec_grow(void *p, size_t *cap, size_t need, size_t size){
+    if(need <= *cap)
+        return p;
+    size_t n = *cap ? *cap : 4096;
+    while(n < need)
+        n *= 2;
+    p = realloc(p, n * size);
+    if(!p){
+        fprintf(stderr, "?out of memory\n");
+        exit(1);
+    }
+    *cap = n;
+    return p;
+}
+
+static void cvbsdec_put(uint32_t cmd){
+    cvbsdec_cmds = cvbsdec_grow(cvbsdec_cmds, &cvbsdec_cmd_cap, cvbsdec_cmd_count + 1, sizeof(uint32_t));
+    cvbsdec_cmds[cvbsdec_cmd_count++] = cmd;
+}
+
+static bool cvbsdec_read_stream(const char *path){
+    FILE *f = fopen(path, "rb");
+    if(!f){
+        fprintf(stderr, "?Error opening %s (%s)\n", path, strerror(errno));
+        return false;
+    }
+    uint8_t le[4];
+    while(fread(le, 1, 4, f) == 4)
+        cvbsdec_put(le[0] | le[1] << 8 | le[2] << 16 | (uint32_t)le[3] << 24);
+    fclose(f);
+    if(!cvbsdec_cmd_count){
+        fprintf(stderr, "?%s is empty\n", path);
+        return false;
+    }
+    return true;
+}
+
+static bool cvbsdec_read_palette(const char *path){
+    FILE *f = fopen(path, "rb");
+    if(!f){
+        fprintf(stderr, "?Error opening %s (%s)\n", path, strerror(errno));
+        return false;
+    }
+    size_t n = fread(&cvbsdec_palette, 1, sizeof(cvbsdec_palette), f);
+    fclose(f);
+    if(n != sizeof(cvbsdec_palette) || cvbsdec_palette.version != 1){
+        fprintf(stderr, "?%s is not a palette file\n", path);
+        return false;
+    }
+    return true;
+}
+
+/*
+ * Colour bar test image, as cvbs_test_img_pal() and cvbs_test_img_ntsc()
+ */
+
+static const uint32_t cvbsdec_pal_vsync[] = {
+    PAL_SHORT_SYNC_L, PAL_SHORT_SYNC_H, PAL_SHORT_SYNC_L, PAL_SHORT_SYNC_H,
+    PAL_SHORT_SYNC_L, PAL_SHORT_SYNC_H, PAL_SHORT_SYNC_L, PAL_SHORT_SYNC_H,
+    PAL_SHORT_SYNC_L, PAL_SHORT_SYNC_H, PAL_SHORT_SYNC_L, PAL_SHORT_SYNC_H,
+    PAL_LONG_SYNC_L, PAL_LONG_SYNC_H, PAL_LONG_SYNC_L, PAL_LONG_SYNC_H,
+    PAL_LONG_SYNC_L, PAL_LONG_SYNC_H, PAL_LONG_SYNC_L, PAL_LONG_SYNC_H,
+    PAL_LONG_SYNC_L, PAL_LONG_SYNC_H, PAL_SHORT_SYNC_L, PAL_SHORT_SYNC_H,
+    PAL_SHORT_SYNC_L, PAL_SHORT_SYNC_H, PAL_SHORT_SYNC_L, PAL_SHORT_SYNC_H,
+    PAL_SHORT_SYNC_L, PAL_SHORT_SYNC_H, PAL_SHORT_SYNC_L, PAL_SHORT_SYNC_H,
+};
+
+static const uint32_t cvbsdec_ntsc_vsync[] = {
+    NTSC_SHORT_SYNC_L, NTSC_SHORT_SYNC_H, NTSC_SHORT_SYNC_L, NTSC_SHORT_SYNC_H,
+    NTSC_SHORT_SYNC_L, NTSC_SHORT_SYNC_H, NTSC_SHORT_SYNC_L, NTSC_SHORT_SYNC_H,
+    NTSC_SHORT_SYNC_L, NTSC_SHORT_SYNC_H, NTSC_SHORT_SYNC_L, NTSC_SHORT_SYNC_H,
+    NTSC_LONG_SYNC_L, NTSC_LONG_SYNC_H, NTSC_LONG_SYNC_L, NTSC_LONG_SYNC_H,
+    NTSC_LONG_SYNC_L, NTSC_LONG_SYNC_H, NTSC_LONG_SYNC_L, NTSC_LONG_SYNC_H,
+    NTSC_LONG_SYNC_L, NTSC_LONG_SYNC_H, NTSC_LONG_SYNC_L, NTSC_LONG_SYNC_H,
+    NTSC_SHORT_SYNC_L, NTSC_SHORT_SYNC_H, NTSC_SHORT_SYNC_L, NTSC_SHORT_SYNC_H,
+    NTSC_SHORT_SYNC_L, NTSC_SHORT_SYNC_H, NTSC_SHORT_SYNC_L, NTSC_SHORT_SYNC_H,
+    NTSC_SHORT_SYNC_L, NTSC_SHORT_SYNC_H, NTSC_SHORT_SYNC_L, NTSC_SHORT_SYNC_H,
+};
+
+static void cvbsdec_test_line(bool odd){
+    bool pal = cvbsdec_std->pal;
+    cvbsdec_put(pal ? PAL_FRONTPORCH : NTSC_FRONTPORCH);
+    cvbsdec_put(pal ? PAL_HSYNC : NTSC_HSYNC);
+    cvbsdec_put(pal ? PAL_BREEZEWAY : NTSC_BREEZEWAY);
+    cvbsdec_put(odd ? cvbs_burst_cmd_odd : cvbs_burst_cmd_even);
+    cvbsdec_put(pal ? PAL_BACKPORCH : NTSC_BACKPORCH);
+}
+
+// Two fields, so the first vertical sync is followed by a complete field
+static void cvbsdec_test_stream(void){
+    unsigned run_lines = 0;
+    for(int field = 0; field < 2; field++){
+        if(cvbsdec_std->pal){
+            for(unsigned line = 0; line < 285; line++){
+                cvbsdec_test_line(line & 1);
+                for(unsigned j = 0; j < 234; j++)
+                    cvbsdec_put(cvbs_palette[line & 1 ? 0 : 1][(j >> 3) & 0xF]);
+            }
+            for(size_t i = 0; i < CVBSDEC_COUNT(cvbsdec_pal_vsync); i++)
+                cvbsdec_put(cvbsdec_pal_vsync[i]);
+            for(unsigned line = 293; line < 312; line++){
+                cvbsdec_test_line(line & 1);
+                cvbsdec_put(PAL_BLANKING);
+            }
+        }else{
+            for(unsigned line = 0; line < 240; line++, run_lines++){
+                cvbsdec_test_line(run_lines & 1);
+                for(unsigned j = 0; j < 200; j++)
+                    cvbsdec_put(cvbs_palette[(j + (run_lines & 1 ? 0 : 4) + 2) & 0x7][(j >> 3) & 0xF]);
+            }
+            for(size_t i = 0; i < CVBSDEC_COUNT(cvbsdec_ntsc_vsync); i++)
+                cvbsdec_put(cvbsdec_ntsc_vsync[i]);
+            run_lines += 9;
+            for(unsigned line = 249; line < 261; line++, run_lines++){
+                cvbsdec_test_line(run_lines & 1);
+                cvbsdec_put(NTSC_BLANKING);
+            }
+        }
+    }
+}
+
+/*
+ * Waveform synthesis
+ */
+
+static pio_sim_sm_t *cvbsdec_load(pio_sim_t *sim, int pio, int sm, const char *file, const char *name,
+                                  pio_asm_program_t *program){
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", cvbsdec_dir, file);
+    if(!pio_asm_load(path, name, program))
+        return NULL;
+    int offset = pio_sim_add_program(sim, pio, program);
+    if(offset < 0){
+        fprintf(stderr, "?%s does not fit in pio%d\n", name, pio);
+        return NULL;
+    }
+    return pio_sim_sm_init(sim, pio, sm, offset, program);
+}
+
+// Feed the commands with the TX FIFO kept full, as the DMA ring does, and
+// run one line past the last one
+static bool cvbsdec_synth(void){
+    static pio_sim_t sim;
+    static pio_asm_program_t cvbs, dot;
+    pio_sim_init(&sim);
+    pio_sim_sm_t *sm = cvbsdec_load(&sim, 0, CVBS_SM, "vic/cvbs.pio", cvbsdec_std->cvbs, &cvbs);
+    pio_sim_sm_t *dotclk = cvbsdec_load(&sim, 1, VIC_DOTCLK_SM, "vic/vic.pio", "clkgen_dot", &dot);
+    if(!sm || !dotclk)
+        return false;
+    int handlers[] = {
+        pio_asm_label(&cvbs, "cvbs_cmd_dc_run"),
+        pio_asm_label(&cvbs, "cvbs_cmd_pixel"),
+        pio_asm_label(&cvbs, "cvbs_cmd_burst"),
+    };
+    sm->out_base = CVBS_PIN_BASE_1_2 - 2;
+    sm->out_count = CVBS_PIN_COUNT + 2;
+    sm->set_base = CVBS_PIN_BASE_1_2;
+    sm->set_count = CVBS_PIN_COUNT;
+    sm->out_right = true;
+    sm->autopull = true;
+    sm->pull_threshold = 32;
+    sm->fifo = PIO_ASM_FIFO_TX;
+    sm->pc = pio_asm_label(&cvbs, "entry");
+    sim.gpio_oe |= 0x7Full << (CVBS_PIN_BASE_1_2 - 2);
+    dotclk->clkdiv = cvbsdec_std->dot_div << 8;
+    pio_sim_enable(&sim, 1, 1u << VIC_DOTCLK_SM);
+    pio_sim_enable(&sim, 0, 1u << CVBS_SM);
+
+    cvbsdec_cmd_start = calloc(cvbsdec_cmd_count, sizeof(size_t));
+    size_t wave_cap = 0;
+    size_t next = 0, started = 0, tail = 0;
+    size_t line = (size_t)cvbsdec_std->line_dots * cvbsdec_std->dot_div;
+    uint8_t pc = sm->pc;
+    uint64_t executed = sm->executed;
+    while(tail < line){
+        while(next < cvbsdec_cmd_count && pio_sim_put(sm, cvbsdec_cmds[next]))
+            next++;
+        pio_sim_step(&sim);
+        // Commands start in order with the first instruction of their handler
+        if(sm->executed != executed && started < cvbsdec_cmd_count)
+            for(size_t i = 0; i < CVBSDEC_COUNT(handlers); i++)
+                if(pc == handlers[i])
+                    cvbsdec_cmd_start[started++] = cvbsdec_wave_len;
+        pc = sm->pc;
+        executed = sm->executed;
+        cvbsdec_wave = cvbsdec_grow(cvbsdec_wave, &wave_cap, cvbsdec_wave_len + 1, 1);
+        cvbsdec_wave[cvbsdec_wave_len++] = (sim.gpio_out >> CVBS_PIN_BASE_1_2) & 0x1F;
+        if(next == cvbsdec_cmd_count && !sm->tx_level)
+            tail++;
+    }
+    if(started != cvbsdec_cmd_count){
+        fprintf(stderr, "?%zu of %zu commands started\n", started, cvbsdec_cmd_count);
+        return false;
+    }
+    return true;
+}
+
+static void cvbsdec_tag_colours(void){
+    cvbsdec_cmd_colour = malloc(cvbsdec_cmd_count);
+    int rows = cvbsdec_std->pal ? 4 : 8;
+    for(size_t k = 0; k < cvbsdec_cmd_count; k++){
+        cvbsdec_cmd_colour[k] = 0xFF;
+        for(int row = 0; row < rows && cvbsdec_cmd_colour[k] == 0xFF; row++)
+            for(int c = 0; c < 16; c++)
+                if(cvbs_palette[row][c] == cvbsdec_cmds[k]){
+                    cvbsdec_cmd_colour[k] = c;
+                    break;
+                }
+    }
+}
+
+/*
+ * Decoder
+ */
+
+// Mean level and subcarrier phasor of one cycle from a, as V - jU
+static double complex cvbsdec_phasor(size_t a, double *mean){
+    unsigned p = cvbsdec_std->period;
+    double sum = 0;
+    double complex z = 0;
+    for(unsigned i = 0; i < p; i++){
+        double v = cvbsdec_wave[a + i];
+        sum += v;
+        z += v * cvbsdec_lo[(a + i) % p];
+    }
+    *mean = sum / p;
+    return z * 2 / p;
+}
+
+static double cvbsdec_wrap(double a){
+    while(a > M_PI)
+        a -= 2 * M_PI;
+    while(a <= -M_PI)
+        a += 2 * M_PI;
+    return a;
+}
+
+static double cvbsdec_deg(double a){
+    return a * 180 / M_PI;
+}
+
+// The DAC output is noiseless, so only samples at the sync tip are sync.
+// Half line equalising pulses are ignored as a TV line oscillator does.
+static bool cvbsdec_syncs(void){
+    size_t line_cap = 0, vsync_cap = 0;
+    size_t h = (size_t)cvbsdec_std->line_dots * cvbsdec_std->dot_div;
+    cvbsdec_tip = 0xFF;
+    for(size_t t = 0; t < cvbsdec_wave_len; t++)
+        if(cvbsdec_wave[t] < cvbsdec_tip)
+            cvbsdec_tip = cvbsdec_wave[t];
+    bool prev_broad = false;
+    for(size_t t = 0; t < cvbsdec_wave_len;){
+        if(cvbsdec_wave[t] > cvbsdec_tip){
+            t++;
+            continue;
+        }
+        size_t s = t;
+        while(t < cvbsdec_wave_len && cvbsdec_wave[t] <= cvbsdec_tip)
+            t++;
+        // Skip the output before the first command and a pulse cut by the end
+        if(!s || t == cvbsdec_wave_len)
+            continue;
+        double us = (t - s) * 1000.0 / cvbsdec_std->sys_khz;
+        bool broad = us > CVBSDEC_BROAD_US;
+        if(broad && !prev_broad){
+            cvbsdec_vsyncs = cvbsdec_grow(cvbsdec_vsyncs, &vsync_cap, cvbsdec_vsync_count + 1, sizeof(size_t));
+            cvbsdec_vsyncs[cvbsdec_vsync_count++] = s;
+        }
+        prev_broad = broad;
+        if(broad || us < CVBSDEC_HSYNC_US)
+            continue;
+        if(cvbsdec_line_count && s - cvbsdec_lines[cvbsdec_line_count - 1].t0 < h * 3 / 4)
+            continue;
+        cvbsdec_lines = cvbsdec_grow(cvbsdec_lines, &line_cap, cvbsdec_line_count + 1, sizeof(cvbsdec_line_t));
+        cvbsdec_lines[cvbsdec_line_count++] = (cvbsdec_line_t){.t0 = s, .sync_end = t, .v_sign = 1};
+    }
+    if(!cvbsdec_line_count){
+        fprintf(stderr, "?no horizontal sync found\n");
+        return false;
+    }
+    size_t spaced = 0;
+    for(size_t i = 1; i < cvbsdec_line_count; i++){
+        size_t d = cvbsdec_lines[i].t0 - cvbsdec_lines[i - 1].t0;
+        if(d < h * 3 / 2){
+            cvbsdec_line_period += d;
+            spaced++;
+        }
+    }
+    cvbsdec_line_period = spaced ? cvbsdec_line_period / spaced : h;
+    return true;
+}
+
+// Burst of each line: the first run of subcarrier cycles after hsync, ending
+// at the breezeway before the picture. Cycles with more than half the peak
+// amplitude give the phase and the DC, the line's blanking level.
+static void cvbsdec_line_burst(cvbsdec_line_t *line){
+    unsigned p = cvbsdec_std->period;
+    unsigned cycles = CVBSDEC_BURST_US * cvbsdec_std->sys_khz / 1000 / p;
+    double complex z[64];
+    double mean[64] = {0};
+    if(cycles > 64)
+        cycles = 64;
+    if(line->sync_end + (size_t)cycles * p > cvbsdec_wave_len){
+        line->blank = cvbsdec_tip;
+        return;
+    }
+    for(unsigned k = 0; k < cycles; k++)
+        z[k] = cvbsdec_phasor(line->sync_end + k * p, &mean[k]);
+    line->blank = mean[1];
+    unsigned first = 0, last;
+    while(first < cycles && cabs(z[first]) < CVBSDEC_MIN_BURST)
+        first++;
+    double peak = 0;
+    for(last = first; last < cycles && cabs(z[last]) >= CVBSDEC_MIN_BURST; last++)
+        peak = fmax(peak, cabs(z[last]));
+    if(first == cycles)
+        return;
+    double complex sum = 0;
+    double dc = 0;
+    unsigned n = 0;
+    for(unsigned k = first; k < last; k++){
+        line->burst_cycles += cabs(z[k]) / peak;
+        if(cabs(z[k]) > peak / 2){
+            sum += z[k];
+            dc += mean[k];
+            n++;
+        }
+    }
+    line->burst = sum / n;
+    line->blank = dc / n;
+}
+
+// Lock to the mean burst phase. It is the same on every line as the local
+// oscillator runs from the sys clock like the dot clock divider.
+static bool cvbsdec_bursts(void){
+    unsigned p = cvbsdec_std->period;
+    for(unsigned i = 0; i < p; i++)
+        cvbsdec_lo[i] = cexp(-I * 2 * M_PI * i / p);
+    double complex ref = 0;
+    double amp = 0, blank = 0;
+    size_t bursts = 0;
+    for(size_t i = 0; i < cvbsdec_line_count; i++){
+        cvbsdec_line_t *line = &cvbsdec_lines[i];
+        cvbsdec_line_burst(line);
+        blank += line->blank;
+        if(line->burst){
+            ref += line->burst / cabs(line->burst);
+            amp += cabs(line->burst);
+            bursts++;
+        }
+    }
+    cvbsdec_blank = blank / cvbsdec_line_count;
+    if(cvbsdec_blank <= cvbsdec_tip){
+        fprintf(stderr, "?no blanking level above sync\n");
+        return false;
+    }
+    cvbsdec_ire_per_dac = cvbsdec_std->sync_ire / (cvbsdec_blank - cvbsdec_tip);
+    if(!bursts){
+        fprintf(stderr, "No colour burst, decoding in black and white\n");
+        return true;
+    }
+    // The burst is at 180 degrees (-U), PAL swings it +-45 degrees with V
+    cvbsdec_rot = cexp(I * (M_PI / 2 - carg(ref)));
+    cvbsdec_chroma_gain = cvbsdec_std->burst_ire / (amp / bursts);
+    if(cvbsdec_std->pal)
+        for(size_t i = 0; i < cvbsdec_line_count; i++){
+            cvbsdec_line_t *line = &cvbsdec_lines[i];
+            if(line->burst && cvbsdec_wrap(carg(line->burst * cvbsdec_rot) - M_PI / 2) > 0)
+                line->v_sign = -1;
+        }
+    return true;
+}
+
+// Burst phase error of a line, after the PAL swing
+static double cvbsdec_burst_error(const cvbsdec_line_t *line){
+    double d = cvbsdec_wrap(carg(line->burst * cvbsdec_rot) - M_PI / 2);
+    if(cvbsdec_std->pal)
+        d += line->v_sign > 0 ? M_PI / 4 : -M_PI / 4;
+    return d;
+}
+
+// Y, U and V in IRE of the subcarrier cycle from a
+static bool cvbsdec_yuv(const cvbsdec_line_t *line, size_t a, double yuv[3]){
+    if(a + cvbsdec_std->period > cvbsdec_wave_len)
+        return false;
+    double mean;
+    double complex z = cvbsdec_phasor(a, &mean) * cvbsdec_rot;
+    yuv[0] = (mean - line->blank) * cvbsdec_ire_per_dac;
+    yuv[1] = 0;
+    yuv[2] = 0;
+    if(line->burst){
+        yuv[1] = -cimag(z) * cvbsdec_chroma_gain;
+        yuv[2] = creal(z) * cvbsdec_chroma_gain * line->v_sign;
+    }
+    return true;
+}
+
+// Subcarrier cycle centred on a dot
+static size_t cvbsdec_dot_window(size_t t){
+    size_t half = cvbsdec_std->period / 2;
+    t += cvbsdec_std->dot_div / 2;
+    return t > half ? t - half : 0;
+}
+
+// Last line starting at or before t
+static const cvbsdec_line_t *cvbsdec_line_at(size_t t){
+    size_t lo = 0, hi = cvbsdec_line_count;
+    if(!cvbsdec_line_count || cvbsdec_lines[0].t0 > t)
+        return NULL;
+    while(hi - lo > 1){
+        size_t mid = (lo + hi) / 2;
+        if(cvbsdec_lines[mid].t0 <= t)
+            lo = mid;
+        else
+            hi = mid;
+    }
+    return &cvbsdec_lines[lo];
+}
+
+static void cvbsdec_rgb(const double yuv[3], uint8_t rgb[3]){
+    double y = yuv[0] / 100;
+    double b = y + yuv[1] / 100 / 0.493;
+    double r = y + yuv[2] / 100 / 0.877;
+    double g = (y - 0.299 * r - 0.114 * b) / 0.587;
+    double c[3] = {r, g, b};
+    for(int i = 0; i < 3; i++)
+        rgb[i] = c[i] <= 0 ? 0 : c[i] >= 1 ? 255 : (uint8_t)(c[i] * 255 + 0.5);
+}
+
+static bool cvbsdec_field(unsigned field, size_t *start, size_t *end){
+    if(field >= cvbsdec_vsync_count){
+        fprintf(stderr, "?field %u not found, %zu vertical syncs\n", field, cvbsdec_vsync_count);
+        return false;
+    }
+    *start = cvbsdec_vsyncs[field];
+    *end = field + 1 < cvbsdec_vsync_count ? cvbsdec_vsyncs[field + 1] : cvbsdec_wave_len;
+    return true;
+}
+
+static FILE *cvbsdec_ppm(const char *path, unsigned width, unsigned height){
+    FILE *f = fopen(path, "wb");
+    if(!f){
+        fprintf(stderr, "?Error opening %s (%s)\n", path, strerror(errno));
+        return NULL;
+    }
+    fprintf(f, "P6\n%u %u\n255\n", width, height);
+    return f;
+}
+
+// Whole lines, one pixel per dot, rows counted from the vertical sync.
+// PAL averages U and V with the line above as a delay line decoder does.
+static bool cvbsdec_write_image(const char *path, unsigned field){
+    size_t start, end;
+    if(!cvbsdec_field(field, &start, &end))
+        return false;
+    double h = cvbsdec_line_period;
+    unsigned width = cvbsdec_std->line_dots;
+    unsigned height = lround((end - start) / h);
+    uint8_t *img = calloc((size_t)width * height, 3);
+    double (*prev)[2] = calloc(width, sizeof(*prev));
+    unsigned prev_row = ~0u;
+    for(size_t i = 0; i < cvbsdec_line_count; i++){
+        const cvbsdec_line_t *line = &cvbsdec_lines[i];
+        if(line->t0 < start || line->t0 >= end)
+            continue;
+        unsigned row = lround((line->t0 - start) / h);
+        if(row >= height)
+            continue;
+        bool delay = cvbsdec_std->pal && !cvbsdec_pal_simple && prev_row + 1 == row;
+        for(unsigned x = 0; x < width; x++){
+            double yuv[3];
+            if(!cvbsdec_yuv(line, cvbsdec_dot_window(line->t0 + (size_t)x * cvbsdec_std->dot_div), yuv))
+                break;
+            double u = yuv[1], v = yuv[2];
+            if(delay){
+                yuv[1] = (u + prev[x][0]) / 2;
+                yuv[2] = (v + prev[x][1]) / 2;
+            }
+            prev[x][0] = u;
+            prev[x][1] = v;
+            cvbsdec_rgb(yuv, &img[((size_t)row * width + x) * 3]);
+        }
+        prev_row = row;
+    }
+    free(prev);
+    FILE *f = cvbsdec_ppm(path, width, height);
+    if(f){
+        fwrite(img, 3, (size_t)width * height, f);
+        fclose(f);
+    }
+    free(img);
+    return f != NULL;
+}
+
+static void cvbsdec_dot(uint8_t *img, int x, int y, int size, const uint8_t rgb[3]){
+    for(int j = y - size / 2; j <= y + size / 2; j++)
+        for(int i = x - size / 2; i <= x + size / 2; i++)
+            if(i >= 0 && i < CVBSDEC_SCOPE_SIZE && j >= 0 && j < CVBSDEC_SCOPE_SIZE)
+                memcpy(&img[(j * CVBSDEC_SCOPE_SIZE + i) * 3], rgb, 3);
+}
+
+static void cvbsdec_plot(uint8_t *img, double u, double v, int size, const uint8_t rgb[3]){
+    double scale = CVBSDEC_SCOPE_SIZE / 2 / CVBSDEC_SCOPE_IRE;
+    cvbsdec_dot(img, CVBSDEC_SCOPE_SIZE / 2 + (int)lround(u * scale),
+                CVBSDEC_SCOPE_SIZE / 2 - (int)lround(v * scale), size, rgb);
+}
+
+// U right and V up, one point per dot without the PAL delay line so phase
+// errors between lines show as split points. Circles at 1x and 2x burst
+// amplitude, bursts in red after the V switch.
+static bool cvbsdec_write_scope(const char *path, unsigned field){
+    size_t start, end;
+    if(!cvbsdec_field(field, &start, &end))
+        return false;
+    static uint32_t hits[CVBSDEC_SCOPE_SIZE * CVBSDEC_SCOPE_SIZE];
+    static uint8_t img[CVBSDEC_SCOPE_SIZE * CVBSDEC_SCOPE_SIZE * 3];
+    double scale = CVBSDEC_SCOPE_SIZE / 2 / CVBSDEC_SCOPE_IRE;
+    uint32_t max = 0;
+    for(size_t i = 0; i < cvbsdec_line_count; i++){
+        const cvbsdec_line_t *line = &cvbsdec_lines[i];
+        if(line->t0 < start || line->t0 >= end)
+            continue;
+        for(unsigned x = 0; x < cvbsdec_std->line_dots; x++){
+            double yuv[3];
+            if(!cvbsdec_yuv(line, cvbsdec_dot_window(line->t0 + (size_t)x * cvbsdec_std->dot_div), yuv))
+                break;
+            int px = CVBSDEC_SCOPE_SIZE / 2 + (int)lround(yuv[1] * scale);
+            int py = CVBSDEC_SCOPE_SIZE / 2 - (int)lround(yuv[2] * scale);
+            if(px < 0 || px >= CVBSDEC_SCOPE_SIZE || py < 0 || py >= CVBSDEC_SCOPE_SIZE)
+                continue;
+            uint32_t n = ++hits[py * CVBSDEC_SCOPE_SIZE + px];
+            if(n > max)
+                max = n;
+        }
+    }
+    static const uint8_t grey[3] = {96, 96, 96}, red[3] = {255, 0, 0};
+    for(int i = 0; i < CVBSDEC_SCOPE_SIZE; i++){
+        double d = (i - CVBSDEC_SCOPE_SIZE / 2) / scale;
+        cvbsdec_plot(img, d, 0, 1, grey);
+        cvbsdec_plot(img, 0, d, 1, grey);
+    }
+    for(int i = 0; i < 1440; i++){
+        double a = i * M_PI / 720;
+        for(int r = 1; r <= 2; r++)
+            cvbsdec_plot(img, r * cvbsdec_std->burst_ire * cos(a), r * cvbsdec_std->burst_ire * sin(a), 1, grey);
+    }
+    for(int i = 0; i < CVBSDEC_SCOPE_SIZE * CVBSDEC_SCOPE_SIZE; i++)
+        if(hits[i]){
+            uint8_t green[3] = {0, 96 + 159 * log1p(hits[i]) / log1p(max), 0};
+            cvbsdec_dot(img, i % CVBSDEC_SCOPE_SIZE, i / CVBSDEC_SCOPE_SIZE, 3, green);
+        }
+    for(size_t i = 0; i < cvbsdec_line_count; i++){
+        const cvbsdec_line_t *line = &cvbsdec_lines[i];
+        if(line->t0 < start || line->t0 >= end || !line->burst)
+            continue;
+        double complex z = line->burst * cvbsdec_rot * cvbsdec_chroma_gain;
+        cvbsdec_plot(img, -cimag(z), creal(z) * line->v_sign, 3, red);
+    }
+    FILE *f = cvbsdec_ppm(path, CVBSDEC_SCOPE_SIZE, CVBSDEC_SCOPE_SIZE);
+    if(!f)
+        return false;
+    fwrite(img, 3, CVBSDEC_SCOPE_SIZE * CVBSDEC_SCOPE_SIZE, f);
+    fclose(f);
+    return true;
+}
+
+/*
+ * Report
+ */
+
+// Pixel command inside a run of its colour, so the cycle around it is clean
+static bool cvbsdec_clean_pixel(size_t k, const cvbsdec_line_t **line, double yuv[3]){
+    uint8_t c = cvbsdec_cmd_colour[k];
+    if(c == 0xFF || !k || k + 1 >= cvbsdec_cmd_count ||
+       cvbsdec_cmd_colour[k - 1] != c || cvbsdec_cmd_colour[k + 1] != c)
+        return false;
+    size_t a = cvbsdec_dot_window(cvbsdec_cmd_start[k]);
+    *line = cvbsdec_line_at(a);
+    return *line && cvbsdec_yuv(*line, a, yuv);
+}
+
+static double cvbsdec_hue(double u, double v){
+    double h = cvbsdec_deg(atan2(v, u));
+    return h < 0 ? h + 360 : h;
+}
+
+static bool cvbsdec_report(double max_error){
+    double burst_cycles = 0, burst_amp = 0, burst_err = 0, swing = 0;
+    size_t bursts = 0;
+    for(size_t i = 0; i < cvbsdec_line_count; i++){
+        const cvbsdec_line_t *line = &cvbsdec_lines[i];
+        if(!line->burst)
+            continue;
+        burst_cycles += line->burst_cycles;
+        burst_amp += cabs(line->burst);
+        if(fabs(cvbsdec_burst_error(line)) > fabs(burst_err))
+            burst_err = cvbsdec_burst_error(line);
+        swing += fabs(cvbsdec_wrap(carg(line->burst * cvbsdec_rot) - M_PI / 2));
+        bursts++;
+    }
+    double khz = cvbsdec_std->sys_khz;
+    printf("%s: %zu commands, %zu sys clocks (%.2f ms), %zu lines, %zu vertical syncs\n",
+           cvbsdec_std->name, cvbsdec_cmd_count, cvbsdec_wave_len, cvbsdec_wave_len / khz,
+           cvbsdec_line_count, cvbsdec_vsync_count);
+    printf("Sync tip %u, blank %.2f DAC, %.2f IRE per step, line %.3f us\n",
+           cvbsdec_tip, cvbsdec_blank, cvbsdec_ire_per_dac, cvbsdec_line_period * 1000 / khz);
+    if(!bursts)
+        return true;
+    printf("Burst on %zu lines, %.1f cycles, %.2f DAC, phase error max %+.2f deg",
+           bursts, burst_cycles / bursts, burst_amp / bursts, cvbsdec_deg(burst_err));
+    if(cvbsdec_std->pal)
+        printf(", swing +-%.2f deg", cvbsdec_deg(swing / bursts));
+    printf("\n");
+
+    // Mean of every clean pixel of a colour, then the hue error around it
+    double sum[16][3] = {{0}};
+    size_t count[16] = {0};
+    double err_max[16] = {0}, err_sq[16] = {0};
+    for(int pass = 0; pass < 2; pass++)
+        for(size_t k = 0; k < cvbsdec_cmd_count; k++){
+            const cvbsdec_line_t *line;
+            double yuv[3];
+            if(!cvbsdec_clean_pixel(k, &line, yuv))
+                continue;
+            uint8_t c = cvbsdec_cmd_colour[k];
+            if(!pass){
+                for(int i = 0; i < 3; i++)
+                    sum[c][i] += yuv[i];
+                count[c]++;
+                continue;
+            }
+            double e = cvbsdec_wrap(atan2(yuv[2], yuv[1]) - atan2(sum[c][2], sum[c][1]));
+            err_max[c] = fmax(err_max[c], fabs(e));
+            err_sq[c] += e * e;
+        }
+    bool ok = true;
+    printf("Col Delay Luma Chroma  Pixels  Y IRE  Sat IRE  Hue deg  Err max  Err rms\n");
+    for(int c = 0; c < 16; c++){
+        const cvbs_colour_t *col = &cvbsdec_palette.colours[c];
+        printf("%3d %5u %4u %+6d %7zu", c, col->delay, col->luma, col->chroma, count[c]);
+        if(!count[c]){
+            printf("\n");
+            continue;
+        }
+        for(int i = 0; i < 3; i++)
+            sum[c][i] /= count[c];
+        double sat = hypot(sum[c][1], sum[c][2]);
+        printf("  %5.1f  %7.1f", sum[c][0], sat);
+        if(sat < CVBSDEC_MIN_SAT){
+            printf("        -        -        -\n");
+            continue;
+        }
+        printf("  %7.1f  %7.2f  %7.2f\n", cvbsdec_hue(sum[c][1], sum[c][2]),
+               cvbsdec_deg(err_max[c]), cvbsdec_deg(sqrt(err_sq[c] / count[c])));
+        if(max_error >= 0 && cvbsdec_deg(err_max[c]) > max_error)
+            ok = false;
+    }
+    if(!ok)
+        printf("?hue error above %.2f deg\n", max_error);
+    return ok;
+}
+
+static bool cvbsdec_write_wave(const char *path){
+    FILE *f = fopen(path, "wb");
+    if(!f){
+        fprintf(stderr, "?Error opening %s (%s)\n", path, strerror(errno));
+        return false;
+    }
+    fwrite(cvbsdec_wave, 1, cvbsdec_wave_len, f);
+    fclose(f);
+    return true;
+}
+
+static void cvbsdec_usage(void){
+    printf("Usage: cvbsdec [options] [capture]\n"
+           " -m pal|ntsc        Video standard (default pal)\n"
+           " -t                 Decode the colour bar test image instead of a capture\n"
+           " -p file            Palette saved with the cvbs save command (default built in)\n"
+           " -F field           Field for the image and vectorscope, from the first\n"
+           "                    vertical sync (default 0)\n"
+           " -o file.ppm        Write the decoded field, one pixel per dot\n"
+           " -V file.ppm        Write a vectorscope of the field\n"
+           " -s                 Simple PAL decoding without the delay line\n"
+           " -w file            Write the DAC waveform, one byte per sys clock\n"
+           " -e degrees         Exit non-zero if a colour's hue varies more than this\n"
+           " -f dir             Firmware source directory (%s)\n"
+           " -h                 This help\n"
+           "The capture is a vicsim -c command stream.\n",
+           cvbsdec_dir);
+}
+
+int main(int argc, char **argv){
+    const char *palette_path = NULL, *image_path = NULL, *scope_path = NULL, *wave_path = NULL;
+    bool test = false;
+    unsigned field = 0;
+    double max_error = -1;
+    int opt;
+    while((opt = getopt(argc, argv, "m:tp:F:o:V:sw:e:f:h")) != -1){
+        switch(opt){
+            case 'm':
+                if(!strcmp(optarg, "pal"))
+                    cvbsdec_std = &cvbsdec_pal;
+                else if(!strcmp(optarg, "ntsc"))
+                    cvbsdec_std = &cvbsdec_ntsc;
+                else{
+                    fprintf(stderr, "?unknown video standard %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 't':
+                test = true;
+                break;
+            case 'p':
+                palette_path = optarg;
+                break;
+            case 'F':
+                field = strtoul(optarg, NULL, 0);
+                break;
+            case 'o':
+                image_path = optarg;
+                break;
+            case 'V':
+                scope_path = optarg;
+                break;
+            case 's':
+                cvbsdec_pal_simple = true;
+                break;
+            case 'w':
+                wave_path = optarg;
+                break;
+            case 'e':
+                max_error = atof(optarg);
+                break;
+            case 'f':
+                cvbsdec_dir = optarg;
+                break;
+            default:
+                cvbsdec_usage();
+                return opt == 'h' ? 0 : 1;
+        }
+    }
+    if(test == (optind < argc)){
+        cvbsdec_usage();
+        return 1;
+    }
+
+    if(palette_path){
+        if(!cvbsdec_read_palette(palette_path))
+            return 1;
+    }else{
+        memcpy(&cvbsdec_palette, cvbsdec_std->pal ? &palette_default_pal : &palette_default_ntsc,
+               sizeof(cvbs_palette_t));
+    }
+    cvbs_calc_palette(cvbsdec_std->mode, &cvbsdec_palette);
+    if(test)
+        cvbsdec_test_stream();
+    else if(!cvbsdec_read_stream(argv[optind]))
+        return 1;
+
+    if(!cvbsdec_synth())
+        return 1;
+    cvbsdec_tag_colours();
+    if(wave_path && !cvbsdec_write_wave(wave_path))
+        return 1;
+    if(!cvbsdec_syncs() || !cvbsdec_bursts())
+        return 1;
+    if(image_path && !cvbsdec_write_image(image_path, field))
+        return 1;
+    if(scope_path && !cvbsdec_write_scope(scope_path, field))
+        return 1;
+    return cvbsdec_report(max_error) ? 0 : 1;
+}
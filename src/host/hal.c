@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) 2026 Sodiumlightbaby
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+// Host side hardware abstraction for running the core1 loops unmodified.
+// The F1 IRQ poll in the loop is the only place time advances, so it is
+// also where the simulator takes back control when a run is done.
+
+#include "main.h"
+#include "hal.h"
+#include "vic/aud.h"
+#include "vic/pen.h"
+#include "vic/reg_ring.h"
+#include "vic/trace.h"
+#include "sys/dvi.h"
+#include "sys/mem.h"
+#include "hardware/dma.h"
+#include "hardware/pio.h"
+#include "pico/multicore.h"
+#include <setjmp.h>
+#include <string.h>
+
+volatile uint8_t xram[0x40000];
+// The golden frames are the full 320x312 VIC PAL framebuffer
+static volatile uint8_t host_framebuf[HOST_FB_HEIGHT * HOST_FB_WIDTH] __attribute__ ((aligned(4)));
+volatile uint8_t *dvi_framebuf = host_framebuf;
+uint32_t dvi_fb_width = HOST_FB_WIDTH;
+uint32_t dvi_fb_height = HOST_FB_HEIGHT;
+bool dvi_fb_packed;
+uint32_t dvi_fb_stride = HOST_FB_WIDTH;
+uint32_t dvi_fb_line_mask = ~0u;
+volatile uint32_t dvi_fb_beam;
+volatile uint32_t dvi_fb_beam_lines = HOST_FB_HEIGHT;
+
+pio_hw_t host_pio_hw[3];
+dma_channel_hw_t host_dma_ch[NUM_DMA_CHANNELS];
+uint32_t host_dma_claimed;
+sio_hw_t host_sio_hw;
+
+volatile aud_union_t aud_counters;
+volatile aud_union_t aud_ticks;
+volatile aud_union_t aud_regs;
+volatile aud_union_t aud_sr;
+volatile uint32_t aud_noise_count;
+aud_event_t aud_ev_ring[AUD_EV_RING_LEN];
+volatile uint32_t aud_ev_head;
+volatile uint32_t aud_ev_tail;
+volatile uint32_t aud_ev_lost;
+
+static volatile uint16_t host_pen_xy;
+static volatile uint32_t host_pen_dma_trans;
+volatile uint16_t *pen_xy = &host_pen_xy;
+volatile uint32_t *pen_dma_trans_reg = &host_pen_dma_trans;
+static volatile uint32_t host_trace_dma_write;
+volatile uint32_t *trace_dma_write_reg = &host_trace_dma_write;
+volatile uint32_t trace_frame_addr;
+volatile uint32_t trace_frame_count;
+
+hal_sim_t hal_sim;
+static jmp_buf hal_exit;
+
+void hal_reset(void){
+    memset(&hal_sim, 0, sizeof(hal_sim));
+    memset(host_pio_hw, 0, sizeof(host_pio_hw));
+    memset(host_dma_ch, 0, sizeof(host_dma_ch));
+    memset(&host_sio_hw, 0, sizeof(host_sio_hw));
+    aud_counters.all = aud_ticks.all = aud_regs.all = aud_sr.all = 0;
+    aud_ev_head = aud_ev_tail = aud_ev_lost = 0;
+}
+
+void hal_stop(void){
+    hal_sim.stop = true;
+}
+
+static void hal_end_cycle(void){
+    uint32_t n = hal_sim.puts_this_cycle;
+    hal_sim.puts_hist[n < HAL_PUTS_HIST_SIZE ? n : HAL_PUTS_HIST_SIZE - 1]++;
+    hal_sim.puts_this_cycle = 0;
+}
+
+// Complete any triggered DMA transfers. DREQ pacing is not modelled, the
+// words land in the PIO TX FIFO in the cycle that queued them.
+static void hal_dma_run(void){
+    for(int i = 0; i < NUM_DMA_CHANNELS; i++){
+        dma_channel_hw_t *ch = &host_dma_ch[i];
+        if(!ch->al1_transfer_count_trig)
+            continue;
+        uintptr_t wrap = ch->ring_bits ? ((uintptr_t)1 << ch->ring_bits) - 1 : ~(uintptr_t)0;
+        PIO pio = NULL;
+        uint sm = 0;
+        for(int p = 0; p < 3; p++)
+            for(uint j = 0; j < 4; j++)
+                if(ch->write_addr == (uintptr_t)&host_pio_hw[p].txf[j]){
+                    pio = &host_pio_hw[p];
+                    sm = j;
+                }
+        for(; ch->al1_transfer_count_trig; ch->al1_transfer_count_trig--){
+            uint32_t data = *(volatile uint32_t *)ch->read_addr;
+            if(pio)
+                host_pio_sm_put(pio, sm, data);
+            else
+                *(volatile uint32_t *)ch->write_addr = data;
+            if(ch->read_incr)
+                ch->read_addr = (ch->read_addr & ~wrap) | ((ch->read_addr + 4) & wrap);
+            if(ch->write_incr)
+                ch->write_addr += 4;
+        }
+    }
+}
+
+bool host_pio_interrupt_get(PIO pio, uint irq){
+    if(pio == XWRITE_MASK_PIO && irq == REG_RING_PIO_IRQ)
+        return hal_sim.xwrite_reg || (pio->irq_force & (1u << irq));
+    if(pio != VIC_PIO || irq != 1)
+        return false;
+    hal_dma_run();
+    // Each poll that returns true starts a new F1 cycle
+    if(hal_sim.cycles)
+        hal_end_cycle();
+    else
+        hal_sim.puts_this_cycle = 0;    // Start-up back pressure words
+    if(hal_sim.stop || (hal_sim.limit && hal_sim.cycles >= hal_sim.limit))
+        longjmp(hal_exit, 1);
+    if(hal_sim.on_cycle)
+        hal_sim.on_cycle(hal_sim.cycles);
+    hal_sim.cycles++;
+    return true;
+}
+
+void host_pio_interrupt_clear(PIO pio, uint irq){
+    if(pio == XWRITE_MASK_PIO && irq == REG_RING_PIO_IRQ){
+        hal_sim.xwrite_reg = false;
+        pio->irq_force &= ~(1u << irq);
+    }
+}
+
+void hal_xwrite(uint32_t addr, uint8_t value){
+    xram[addr] = value;
+    if((addr & ~0xFu) == 0x1000)
+        hal_sim.xwrite_reg = true;
+}
+
+void host_pio_sm_put(PIO pio, uint sm, uint32_t data){
+    if(pio != CVBS_PIO || sm != CVBS_SM)
+        return;
+    hal_sim.cvbs_puts++;
+    hal_sim.puts_this_cycle++;
+    if(hal_sim.cvbs_buf && hal_sim.cvbs_len < hal_sim.cvbs_cap)
+        hal_sim.cvbs_buf[hal_sim.cvbs_len++] = data;
+}
+
+uint64_t hal_run(void (*core_loop)(void), uint64_t cycles){
+    hal_sim.limit = cycles;
+    hal_sim.stop = false;
+    if(!setjmp(hal_exit))
+        core_loop();
+    return hal_sim.cycles;
+}
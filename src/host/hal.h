@@ -0,0 +1,49 @@
+/*
+ * Copyright (c) 2026 Sodiumlightbaby
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef _HAL_H_
+#define _HAL_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Called at the start of every F1 cycle, before the core loop body runs.
+// Register writes done here are seen by the core in the same cycle.
+typedef void (*hal_cycle_cb_t)(uint64_t cycle);
+
+#define HAL_PUTS_HIST_SIZE 16
+
+// Framebuffer of the host tools, the full VIC PAL frame the golden frames hold
+#define HOST_FB_WIDTH 320
+#define HOST_FB_HEIGHT 312
+
+typedef struct {
+    uint64_t cycles;                         // F1 cycles handed to the core loop
+    uint64_t limit;                          // Stop before this cycle (0 = no limit)
+    bool stop;                               // Stop at the start of the next cycle
+    hal_cycle_cb_t on_cycle;
+    bool xwrite_reg;                         // PIO flag of a CPU register write
+    // CVBS PIO TX FIFO
+    uint32_t *cvbs_buf;                      // Optional capture of every command word
+    size_t cvbs_cap;
+    size_t cvbs_len;
+    uint64_t cvbs_puts;
+    uint32_t puts_this_cycle;
+    uint64_t puts_hist[HAL_PUTS_HIST_SIZE];  // CVBS puts per F1 cycle, last bucket is overflow
+} hal_sim_t;
+
+extern hal_sim_t hal_sim;
+
+void hal_reset(void);
+void hal_stop(void);
+// CPU write through the xwrite path, raises the register write flag
+void hal_xwrite(uint32_t addr, uint8_t value);
+// Run a core1 loop until hal_stop() is called or the cycle limit is reached.
+// The loop is entered from scratch, so this is equivalent to a chip reset.
+uint64_t hal_run(void (*core_loop)(void), uint64_t cycles);
+
+#endif /* _HAL_H_ */
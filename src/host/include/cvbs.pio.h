@@ -0,0 +1,24 @@
+/*
+ * Copyright (c) 2026 Sodiumlightbaby
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+// Host stand-in for the pioasm generated header of vic/cvbs.pio.
+// Only the public label offsets are needed to build command words.
+// Keep in sync with the instruction layout of cvbs.pio.
+
+#ifndef _HOST_CVBS_PIO_H_
+#define _HOST_CVBS_PIO_H_
+
+#define cvbs_ntsc_offset_cvbs_cmd_dc_run 0u
+#define cvbs_ntsc_offset_cvbs_cmd_pixel 6u
+#define cvbs_ntsc_offset_entry 15u
+#define cvbs_ntsc_offset_cvbs_cmd_burst 17u
+
+#define cvbs_pal_offset_cvbs_cmd_dc_run 0u
+#define cvbs_pal_offset_cvbs_cmd_pixel 5u
+#define cvbs_pal_offset_entry 18u
+#define cvbs_pal_offset_cvbs_cmd_burst 20u
+
+#endif /* _HOST_CVBS_PIO_H_ */
@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2026 Sodiumlightbaby
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+// Host shim for the DMA channels. Addresses are host pointers, so the
+// register block is not the hardware layout. Transfers triggered through
+// al1_transfer_count_trig are carried out by hal.c at the next F1 cycle.
+
+#ifndef _HOST_HARDWARE_DMA_H_
+#define _HOST_HARDWARE_DMA_H_
+
+#include "pico/stdlib.h"
+
+#define NUM_DMA_CHANNELS 16
+#define DMA_CH0_CTRL_TRIG_BUSY_BITS 0x04000000u
+
+enum dma_channel_transfer_size { DMA_SIZE_8 = 0, DMA_SIZE_16 = 1, DMA_SIZE_32 = 2 };
+
+typedef struct {
+    volatile uintptr_t read_addr;
+    volatile uintptr_t write_addr;
+    volatile uint32_t al1_ctrl;
+    union {                         // Reads back the count left, as transfer_count
+        volatile uint32_t al1_transfer_count_trig;
+        volatile uint32_t transfer_count;
+    };
+    uint8_t ring_bits;              // Read side wrap, 0 = none
+    bool read_incr;
+    bool write_incr;
+} dma_channel_hw_t;
+
+typedef struct {
+    uint8_t ring_bits;
+    bool ring_write;
+    bool read_incr;
+    bool write_incr;
+} dma_channel_config;
+
+extern dma_channel_hw_t host_dma_ch[NUM_DMA_CHANNELS];
+extern uint32_t host_dma_claimed;
+
+static inline int dma_claim_unused_channel(bool required) {
+    (void)required;
+    for(int i = 0; i < NUM_DMA_CHANNELS; i++)
+        if(!(host_dma_claimed & (1u << i))){
+            host_dma_claimed |= 1u << i;
+            return i;
+        }
+    return -1;
+}
+static inline dma_channel_hw_t *dma_channel_hw_addr(uint channel) { return &host_dma_ch[channel]; }
+static inline void dma_channel_abort(uint channel) { host_dma_ch[channel].al1_transfer_count_trig = 0; }
+static inline dma_channel_config dma_channel_get_default_config(uint channel) {
+    (void)channel;
+    dma_channel_config c = {0, false, true, false};
+    return c;
+}
+static inline void channel_config_set_transfer_data_size(dma_channel_config *c, enum dma_channel_transfer_size size) {
+    (void)c; (void)size;
+}
+static inline void channel_config_set_read_increment(dma_channel_config *c, bool incr) { c->read_incr = incr; }
+static inline void channel_config_set_write_increment(dma_channel_config *c, bool incr) { c->write_incr = incr; }
+static inline void channel_config_set_ring(dma_channel_config *c, bool write, uint size_bits) {
+    c->ring_write = write;
+    c->ring_bits = (uint8_t)size_bits;
+}
+static inline void channel_config_set_dreq(dma_channel_config *c, uint dreq) { (void)c; (void)dreq; }
+static inline void channel_config_set_high_priority(dma_channel_config *c, bool high) { (void)c; (void)high; }
+static inline void dma_channel_configure(uint channel, const dma_channel_config *config, volatile void *write_addr,
+                                         const volatile void *read_addr, uint32_t transfer_count, bool trigger) {
+    dma_channel_hw_t *ch = &host_dma_ch[channel];
+    ch->read_addr = (uintptr_t)read_addr;
+    ch->write_addr = (uintptr_t)write_addr;
+    ch->ring_bits = config->ring_write ? 0 : config->ring_bits;
+    ch->read_incr = config->read_incr;
+    ch->write_incr = config->write_incr;
+    ch->al1_ctrl = 0;
+    ch->al1_transfer_count_trig = trigger ? transfer_count : 0;
+}
+
+#endif /* _HOST_HARDWARE_DMA_H_ */
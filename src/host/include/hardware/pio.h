@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2026 Sodiumlightbaby
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+// Host shim for the PIO blocks. IRQ polling and TX FIFO puts are routed to
+// the simulator in hal.c, everything else is a no-op.
+
+#ifndef _HOST_HARDWARE_PIO_H_
+#define _HOST_HARDWARE_PIO_H_
+
+#include "pico/stdlib.h"
+
+typedef struct {
+    volatile uint32_t fdebug;
+    volatile uint32_t irq;
+    volatile uint32_t irq_force;
+    volatile uint32_t txf[4];
+    volatile uint32_t rxf[4];
+    volatile uint32_t rxf_putget[4][4];
+} pio_hw_t;
+
+typedef pio_hw_t *PIO;
+
+extern pio_hw_t host_pio_hw[3];
+#define pio0 (&host_pio_hw[0])
+#define pio1 (&host_pio_hw[1])
+#define pio2 (&host_pio_hw[2])
+
+typedef struct {
+    const uint16_t *instructions;
+    uint8_t length;
+    int8_t origin;
+} pio_program_t;
+
+typedef struct {
+    uint32_t clkdiv;
+    uint32_t execctrl;
+    uint32_t shiftctrl;
+    uint32_t pinctrl;
+} pio_sm_config;
+
+bool host_pio_interrupt_get(PIO pio, uint irq);
+void host_pio_interrupt_clear(PIO pio, uint irq);
+void host_pio_sm_put(PIO pio, uint sm, uint32_t data);
+
+static inline bool pio_interrupt_get(PIO pio, uint irq) { return host_pio_interrupt_get(pio, irq); }
+static inline void pio_interrupt_clear(PIO pio, uint irq) { host_pio_interrupt_clear(pio, irq); }
+static inline void pio_sm_put(PIO pio, uint sm, uint32_t data) { host_pio_sm_put(pio, sm, data); }
+static inline void pio_sm_put_blocking(PIO pio, uint sm, uint32_t data) { host_pio_sm_put(pio, sm, data); }
+static inline uint pio_get_dreq(PIO pio, uint sm, bool is_tx) { return (uint)((pio - pio0) * 8 + (is_tx ? 0 : 4) + sm); }
+static inline uint pio_sm_get_tx_fifo_level(PIO pio, uint sm) { (void)pio; (void)sm; return 0; }
+
+static inline uint pio_add_program(PIO pio, const pio_program_t *program) { (void)pio; (void)program; return 0; }
+static inline void pio_set_gpio_base(PIO pio, uint base) { (void)pio; (void)base; }
+static inline void pio_gpio_init(PIO pio, uint pin) { (void)pio; (void)pin; }
+static inline void pio_sm_set_consecutive_pindirs(PIO pio, uint sm, uint pin, uint count, bool is_out) {
+    (void)pio; (void)sm; (void)pin; (void)count; (void)is_out;
+}
+static inline void pio_sm_init(PIO pio, uint sm, uint offset, const pio_sm_config *config) {
+    (void)pio; (void)sm; (void)offset; (void)config;
+}
+static inline void pio_sm_set_enabled(PIO pio, uint sm, bool enabled) { (void)pio; (void)sm; (void)enabled; }
+static inline void pio_set_sm_mask_enabled(PIO pio, uint32_t mask, bool enabled) { (void)pio; (void)mask; (void)enabled; }
+static inline void sm_config_set_sideset_pin_base(pio_sm_config *c, uint pin) { (void)c; (void)pin; }
+static inline void sm_config_set_clkdiv_int_frac(pio_sm_config *c, uint16_t div_int, uint8_t div_frac) {
+    (void)c; (void)div_int; (void)div_frac;
+}
+
+#endif /* _HOST_HARDWARE_PIO_H_ */
@@ -0,0 +1,16 @@
+/*
+ * Copyright (c) 2026 Sodiumlightbaby
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef _HOST_HARDWARE_SYNC_H_
+#define _HOST_HARDWARE_SYNC_H_
+
+// Host shim for the memory barriers. A full fence stands in for the DMB.
+
+#include "pico/stdlib.h"
+
+static inline void __dmb(void) { __atomic_thread_fence(__ATOMIC_SEQ_CST); }
+
+#endif /* _HOST_HARDWARE_SYNC_H_ */
@@ -0,0 +1,25 @@
+/*
+ * Copyright (c) 2026 Sodiumlightbaby
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef _HOST_PICO_MULTICORE_H_
+#define _HOST_PICO_MULTICORE_H_
+
+#include "pico/stdlib.h"
+
+// Inter-core FIFO. Writes from core1 are recorded by the simulator.
+typedef struct {
+    volatile uint32_t fifo_st;
+    volatile uint32_t fifo_wr;
+    volatile uint32_t fifo_rd;
+} sio_hw_t;
+
+extern sio_hw_t host_sio_hw;
+#define sio_hw (&host_sio_hw)
+
+static inline void multicore_launch_core1(void (*entry)(void)) { (void)entry; }
+static inline bool multicore_fifo_rvalid(void) { return false; }
+
+#endif /* _HOST_PICO_MULTICORE_H_ */
@@ -0,0 +1,40 @@
+/*
+ * Copyright (c) 2026 Sodiumlightbaby
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+// Host shim for the parts of the Pico SDK used by the emulation cores.
+// Only what the core loops and their init code touch is provided here.
+
+#ifndef _HOST_PICO_STDLIB_H_
+#define _HOST_PICO_STDLIB_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+typedef unsigned int uint;
+
+#define __scratch_x(group)
+#define __scratch_y(group)
+
+#define GPIO_SLEW_RATE_SLOW 0
+#define GPIO_DRIVE_STRENGTH_2MA 0
+
+static inline void tight_loop_contents(void) {}
+static inline void __compiler_memory_barrier(void) { __asm__ volatile ("" : : : "memory"); }
+
+static inline uint32_t time_us_32(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(ts.tv_sec * 1000000u + ts.tv_nsec / 1000);
+}
+
+static inline void gpio_init(uint gpio) { (void)gpio; }
+static inline void gpio_set_input_enabled(uint gpio, bool enabled) { (void)gpio; (void)enabled; }
+static inline void gpio_set_drive_strength(uint gpio, int drive) { (void)gpio; (void)drive; }
+static inline void gpio_set_slew_rate(uint gpio, int slew) { (void)gpio; (void)slew; }
+
+#endif /* _HOST_PICO_STDLIB_H_ */
@@ -0,0 +1,32 @@
+/*
+ * Copyright (c) 2026 Sodiumlightbaby
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+// Host stand-in for the pioasm generated header of vic/vic.pio.
+// The simulator drives F1 directly, so the programs are empty.
+
+#ifndef _HOST_VIC_PIO_H_
+#define _HOST_VIC_PIO_H_
+
+#include "hardware/pio.h"
+
+static const pio_program_t clkgen_pal_program = { 0 };
+static const pio_program_t clkgen_ntsc_program = { 0 };
+static const pio_program_t clkgen_dot_program = { 0 };
+
+static inline pio_sm_config clkgen_pal_program_get_default_config(uint offset) {
+    (void)offset;
+    return (pio_sm_config){ 0 };
+}
+static inline pio_sm_config clkgen_ntsc_program_get_default_config(uint offset) {
+    (void)offset;
+    return (pio_sm_config){ 0 };
+}
+static inline pio_sm_config clkgen_dot_program_get_default_config(uint offset) {
+    (void)offset;
+    return (pio_sm_config){ 0 };
+}
+
+#endif /* _HOST_VIC_PIO_H_ */
@@ -0,0 +1,214 @@
+/*
+ * Copyright (c) 2026 Sodiumlightbaby
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+// Writes the PCM STREAM sound capture as a WAV file, see sys/pcm.h for the
+// stream format. Samples lost on the device are padded with silence so the
+// WAV keeps the timing of the capture.
+
+#include "sys/pcm.h"
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+typedef struct {
+    uint8_t source;
+    uint8_t channels;
+    uint8_t bits;
+    uint32_t rate;
+} pcmwav_format_t;
+
+static const char *const pcmwav_source_names[2] = {"VIC", "AY"};
+
+static int16_t *pcmwav_samples;
+static size_t pcmwav_count;
+static size_t pcmwav_size;
+
+static bool pcmwav_append(const int16_t *samples, size_t count){
+    if(pcmwav_count + count > pcmwav_size){
+        size_t size = pcmwav_size ? pcmwav_size * 2 : 1 << 16;
+        while(size < pcmwav_count + count)
+            size *= 2;
+        int16_t *p = realloc(pcmwav_samples, size * sizeof(int16_t));
+        if(!p)
+            return false;
+        pcmwav_samples = p;
+        pcmwav_size = size;
+    }
+    if(samples)
+        memcpy(&pcmwav_samples[pcmwav_count], samples, count * sizeof(int16_t));
+    else
+        memset(&pcmwav_samples[pcmwav_count], 0, count * sizeof(int16_t));
+    pcmwav_count += count;
+    return true;
+}
+
+static bool pcmwav_u16(FILE *f, uint16_t *value){
+    int lo = fgetc(f);
+    int hi = fgetc(f);
+    if(hi == EOF)
+        return false;
+    *value = lo | (hi << 8);
+    return true;
+}
+
+// The stream follows the echoed PCM STREAM command on the console
+static bool pcmwav_sync(FILE *f, pcmwav_format_t *fmt){
+    static const char magic[4] = {'P', 'V', 'P', 'C'};
+    int matched = 0;
+    int ch;
+    while(matched < 4 && (ch = fgetc(f)) != EOF){
+        if(ch == magic[matched])
+            matched++;
+        else
+            matched = (ch == magic[0]);
+    }
+    uint8_t header[8];
+    if(matched < 4 || fread(header, 1, sizeof(header), f) != sizeof(header)){
+        fprintf(stderr, "?no PCM stream header\n");
+        return false;
+    }
+    fmt->source = header[1];
+    fmt->channels = header[2];
+    fmt->bits = header[3];
+    fmt->rate = header[4] | (header[5] << 8) | (header[6] << 16) | ((uint32_t)header[7] << 24);
+    if(header[0] != PCM_STREAM_VERSION || fmt->source > PCM_SOURCE_AY ||
+       fmt->channels != 1 || fmt->bits != 16){
+        fprintf(stderr, "?unsupported PCM stream version %d source %d %d channels %d bits\n",
+                header[0], fmt->source, fmt->channels, fmt->bits);
+        return false;
+    }
+    return true;
+}
+
+static void pcmwav_put32(uint8_t *p, uint32_t value){
+    p[0] = value;
+    p[1] = value >> 8;
+    p[2] = value >> 16;
+    p[3] = value >> 24;
+}
+
+static bool pcmwav_write(const char *name, const pcmwav_format_t *fmt){
+    FILE *f = strcmp(name, "-") ? fopen(name, "wb") : stdout;
+    if(!f){
+        fprintf(stderr, "?Error opening %s (%s)\n", name, strerror(errno));
+        return false;
+    }
+    uint32_t data_size = pcmwav_count * 2;
+    uint8_t header[44] = {'R', 'I', 'F', 'F', 0, 0, 0, 0, 'W', 'A', 'V', 'E',
+                          'f', 'm', 't', ' ', 16, 0, 0, 0, 1, 0, 1, 0,
+                          0, 0, 0, 0, 0, 0, 0, 0, 2, 0, 16, 0,
+                          'd', 'a', 't', 'a', 0, 0, 0, 0};
+    pcmwav_put32(&header[4], 36 + data_size);
+    pcmwav_put32(&header[24], fmt->rate);
+    pcmwav_put32(&header[28], fmt->rate * 2);
+    pcmwav_put32(&header[40], data_size);
+    bool ok = fwrite(header, 1, sizeof(header), f) == sizeof(header);
+    for(size_t i = 0; ok && i < pcmwav_count; i++){
+        uint8_t s[2] = {(uint16_t)pcmwav_samples[i], (uint16_t)pcmwav_samples[i] >> 8};
+        ok = fwrite(s, 1, 2, f) == 2;
+    }
+    if(f != stdout && fclose(f))
+        ok = false;
+    if(!ok)
+        fprintf(stderr, "?Error writing %s (%s)\n", name, strerror(errno));
+    return ok;
+}
+
+static void pcmwav_usage(void){
+    printf("Usage: pcmwav [options] [file]\n"
+           " -o file       Write WAV to file, - for stdout\n"
+           " -h            This help\n"
+           "Reads the binary output of the PCM STREAM monitor command from file or stdin\n"
+           "and prints a summary with a checksum of the samples for comparing captures.\n");
+}
+
+int main(int argc, char **argv){
+    const char *out = NULL;
+    int opt;
+    while((opt = getopt(argc, argv, "o:h")) != -1){
+        switch(opt){
+            case 'o':
+                out = optarg;
+                break;
+            default:
+                pcmwav_usage();
+                return opt == 'h' ? 0 : 1;
+        }
+    }
+    FILE *f = stdin;
+    if(optind < argc){
+        f = fopen(argv[optind], "rb");
+        if(!f){
+            fprintf(stderr, "?Error opening %s (%s)\n", argv[optind], strerror(errno));
+            return 1;
+        }
+    }
+    pcmwav_format_t fmt;
+    if(!pcmwav_sync(f, &fmt))
+        return 1;
+
+    uint32_t blocks = 0;
+    uint64_t lost = 0;
+    uint32_t gaps = 0;
+    bool ended = false;
+    uint16_t count, dropped;
+    int16_t block[PCM_BLOCK_MAX];
+    while(pcmwav_u16(f, &count) && pcmwav_u16(f, &dropped)){
+        if(!count){
+            ended = true;
+            break;
+        }
+        if(count > PCM_BLOCK_MAX){
+            fprintf(stderr, "?invalid block of %u samples\n", count);
+            return 1;
+        }
+        uint8_t raw[PCM_BLOCK_MAX * 2];
+        if(fread(raw, 2, count, f) != count){
+            fprintf(stderr, "?truncated block\n");
+            break;
+        }
+        for(int i = 0; i < count; i++)
+            block[i] = (int16_t)(raw[i * 2] | (raw[i * 2 + 1] << 8));
+        if(dropped){
+            lost += dropped;
+            gaps++;
+        }
+        if(!pcmwav_append(NULL, dropped) || !pcmwav_append(block, count)){
+            fprintf(stderr, "?out of memory\n");
+            return 1;
+        }
+        blocks++;
+    }
+    if(!ended)
+        fprintf(stderr, "?stream has no end block\n");
+
+    // FNV-1a over the samples, equal captures of the same sound match
+    uint32_t hash = 2166136261u;
+    int16_t min = 0, max = 0;
+    for(size_t i = 0; i < pcmwav_count; i++){
+        uint16_t s = pcmwav_samples[i];
+        hash = (hash ^ (s & 0xFF)) * 16777619u;
+        hash = (hash ^ (s >> 8)) * 16777619u;
+        if(pcmwav_samples[i] < min)
+            min = pcmwav_samples[i];
+        if(pcmwav_samples[i] > max)
+            max = pcmwav_samples[i];
+    }
+    // Keep stdout for the WAV with -o -
+    FILE *info = out && !strcmp(out, "-") ? stderr : stdout;
+    fprintf(info, "%s %lu Hz, %zu samples (%.2f s) in %lu blocks\n",
+           pcmwav_source_names[fmt.source], (unsigned long)fmt.rate, pcmwav_count,
+           (double)pcmwav_count / fmt.rate, (unsigned long)blocks);
+    fprintf(info, "lost %llu samples in %lu gaps, range %d to %d, fnv1a %08lx\n",
+           (unsigned long long)lost, (unsigned long)gaps, min, max, (unsigned long)hash);
+    if(out && !pcmwav_write(out, &fmt))
+        return 1;
+    return 0;
+}
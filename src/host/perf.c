@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2026 Sodiumlightbaby
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "perf.h"
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+static int perf_open(uint64_t config){
+#ifdef __linux__
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    int fd = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+    if(fd >= 0){
+        ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+    return fd;
+#else
+    (void)config;
+    return -1;
+#endif
+}
+
+static uint64_t perf_close(int fd){
+    uint64_t count = 0;
+    if(fd < 0)
+        return 0;
+#ifdef __linux__
+    ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+#endif
+    if(read(fd, &count, sizeof(count)) != sizeof(count))
+        count = 0;
+    close(fd);
+    return count;
+}
+
+static uint64_t perf_now_ns(void){
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t)t.tv_sec * 1000000000u + t.tv_nsec;
+}
+
+void perf_start(perf_t *p){
+    memset(p, 0, sizeof(*p));
+#ifdef __linux__
+    p->fd_insns = perf_open(PERF_COUNT_HW_INSTRUCTIONS);
+    p->fd_cycles = perf_open(PERF_COUNT_HW_CPU_CYCLES);
+#else
+    p->fd_insns = p->fd_cycles = -1;
+#endif
+    p->t0 = perf_now_ns();
+}
+
+void perf_stop(perf_t *p){
+    p->ns = (double)(perf_now_ns() - p->t0);
+    p->insns = perf_close(p->fd_insns);
+    p->cpu_cycles = perf_close(p->fd_cycles);
+    p->fd_insns = p->fd_cycles = -1;
+}
@@ -0,0 +1,27 @@
+/*
+ * Copyright (c) 2026 Sodiumlightbaby
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef _PERF_H_
+#define _PERF_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Host hardware counters around a measured section. Counters that can't be
+// opened (not Linux, perf_event_paranoid) read back as 0.
+typedef struct {
+    int fd_insns;
+    int fd_cycles;
+    uint64_t insns;
+    uint64_t cpu_cycles;
+    double ns;
+    uint64_t t0;
+} perf_t;
+
+void perf_start(perf_t *p);
+void perf_stop(perf_t *p);
+
+#endif /* _PERF_H_ */
@@ -0,0 +1,425 @@
+/*
+ * Copyright (c) 2026 Sodiumlightbaby
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "pio_asm.h"
+#include <ctype.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#define PIO_ASM_MAX_TOKENS 12
+#define PIO_ASM_MAX_SYMBOLS 32
+
+typedef struct {
+    const char *path;
+    int line;
+    pio_asm_program_t *program;
+    // All labels, public or not
+    pio_asm_label_t symbols[PIO_ASM_MAX_SYMBOLS];
+    int symbol_count;
+    // JMP targets resolved at the end of the program
+    char fixups[PIO_ASM_MAX_INSTR][32];
+    bool wrap_set;
+} pio_asm_t;
+
+static bool pio_asm_error(pio_asm_t *a, const char *msg, const char *arg){
+    fprintf(stderr, "?%s:%d: %s%s%s\n", a->path, a->line, msg, arg ? " " : "", arg ? arg : "");
+    return false;
+}
+
+static bool pio_asm_number(const char *tok, int *value){
+    char *end;
+    long v;
+    if(!strncasecmp(tok, "0b", 2))
+        v = strtol(tok + 2, &end, 2);
+    else
+        v = strtol(tok, &end, 0);
+    if(!*tok || *end)
+        return false;
+    *value = v;
+    return true;
+}
+
+static int pio_asm_lookup(const char *tok, const char *const *names, int count){
+    for(int i = 0; i < count; i++)
+        if(names[i] && !strcasecmp(tok, names[i]))
+            return i;
+    return -1;
+}
+
+// Index of an irq flag: "n", "n rel", "prev n", "next n"
+static bool pio_asm_irq_index(pio_asm_t *a, char **tok, int count, int *index){
+    int mode = 0;
+    int value;
+    for(int i = 0; i < count; i++){
+        if(!strcasecmp(tok[i], "prev"))
+            mode = 1;
+        else if(!strcasecmp(tok[i], "rel"))
+            mode = 2;
+        else if(!strcasecmp(tok[i], "next"))
+            mode = 3;
+        else if(pio_asm_number(tok[i], &value) && value >= 0 && value < 8)
+            *index = value;
+        else
+            return pio_asm_error(a, "invalid irq", tok[i]);
+    }
+    *index |= mode << 3;
+    return true;
+}
+
+static bool pio_asm_instruction(pio_asm_t *a, char **tok, int count, int delay, int side){
+    static const char *const jmp_conds[8] = {NULL, "!x", "x--", "!y", "y--", "x!=y", "pin", "!osre"};
+    static const char *const in_srcs[8] = {"pins", "x", "y", "null", NULL, NULL, "isr", "osr"};
+    static const char *const out_dsts[8] = {"pins", "x", "y", "null", "pindirs", "pc", "isr", "exec"};
+    static const char *const mov_dsts[8] = {"pins", "x", "y", "pindirs", "exec", "pc", "isr", "osr"};
+    static const char *const mov_srcs[8] = {"pins", "x", "y", "null", NULL, "status", "isr", "osr"};
+    static const char *const set_dsts[8] = {"pins", "x", "y", NULL, "pindirs", NULL, NULL, NULL};
+    static const char *const wait_srcs[4] = {"gpio", "pin", "irq", "jmppin"};
+    pio_asm_program_t *p = a->program;
+    if(p->length == PIO_ASM_MAX_INSTR)
+        return pio_asm_error(a, "program too long", NULL);
+    uint16_t instr;
+    int value, index;
+    const char *op = tok[0];
+
+    if(!strcasecmp(op, "nop") && count == 1){
+        instr = 0xA042;     // mov y, y
+    } else if(!strcasecmp(op, "jmp") && (count == 2 || count == 3)){
+        int cond = 0;
+        if(count == 3 && (cond = pio_asm_lookup(tok[1], jmp_conds, 8)) < 0)
+            return pio_asm_error(a, "invalid jmp condition", tok[1]);
+        instr = 0x0000 | cond << 5;
+        const char *target = tok[count - 1];
+        if(pio_asm_number(target, &value))
+            instr |= value & 0x1F;
+        else
+            snprintf(a->fixups[p->length], sizeof(a->fixups[0]), "%s", target);
+    } else if(!strcasecmp(op, "wait") && count >= 4){
+        int pol, src;
+        if(!pio_asm_number(tok[1], &pol) || pol > 1)
+            return pio_asm_error(a, "invalid wait polarity", tok[1]);
+        if((src = pio_asm_lookup(tok[2], wait_srcs, 4)) < 0)
+            return pio_asm_error(a, "invalid wait source", tok[2]);
+        index = 0;
+        if(src == 2){
+            if(!pio_asm_irq_index(a, &tok[3], count - 3, &index))
+                return false;
+        } else if(count != 4 || !pio_asm_number(tok[3], &index) || index > 31){
+            return pio_asm_error(a, "invalid wait index", tok[3]);
+        }
+        instr = 0x2000 | pol << 7 | src << 5 | index;
+    } else if((!strcasecmp(op, "in") || !strcasecmp(op, "out")) && count == 3){
+        bool is_in = !strcasecmp(op, "in");
+        int reg = pio_asm_lookup(tok[1], is_in ? in_srcs : out_dsts, 8);
+        if(reg < 0)
+            return pio_asm_error(a, "invalid operand", tok[1]);
+        if(!pio_asm_number(tok[2], &value) || value < 1 || value > 32)
+            return pio_asm_error(a, "invalid bit count", tok[2]);
+        instr = (is_in ? 0x4000 : 0x6000) | reg << 5 | (value & 0x1F);
+    } else if(!strcasecmp(op, "push") || !strcasecmp(op, "pull")){
+        bool is_pull = !strcasecmp(op, "pull");
+        bool cond = false, block = true;
+        for(int i = 1; i < count; i++){
+            if(!strcasecmp(tok[i], is_pull ? "ifempty" : "iffull"))
+                cond = true;
+            else if(!strcasecmp(tok[i], "block"))
+                block = true;
+            else if(!strcasecmp(tok[i], "noblock"))
+                block = false;
+            else
+                return pio_asm_error(a, "invalid operand", tok[i]);
+        }
+        instr = 0x8000 | is_pull << 7 | cond << 6 | block << 5;
+    } else if(!strcasecmp(op, "mov") && count == 3){
+        const char *src = tok[2];
+        int opr = 0;
+        if(src[0] == '!' || src[0] == '~'){
+            opr = 1;
+            src++;
+        } else if(!strncmp(src, "::", 2)){
+            opr = 2;
+            src += 2;
+        }
+        if(!strncasecmp(tok[1], "rxfifo[", 7) || !strncasecmp(src, "rxfifo[", 7)){
+            // RP2350 FIFO register access, mov rxfifo[n], isr and mov osr, rxfifo[n]
+            bool to_osr = !strncasecmp(src, "rxfifo[", 7);
+            const char *idx = (to_osr ? src : tok[1]) + 7;
+            if(strcasecmp(to_osr ? tok[1] : src, to_osr ? "osr" : "isr"))
+                return pio_asm_error(a, "invalid rxfifo operand", to_osr ? tok[1] : src);
+            if(!strcasecmp(idx, "y]"))
+                instr = 0x8010 | to_osr << 7;
+            else if(sscanf(idx, "%d]", &index) == 1 && index >= 0 && index < 4)
+                instr = 0x8018 | to_osr << 7 | index;
+            else
+                return pio_asm_error(a, "invalid rxfifo index", idx);
+        } else {
+            int dst = pio_asm_lookup(tok[1], mov_dsts, 8);
+            int s = pio_asm_lookup(src, mov_srcs, 8);
+            if(dst < 0 || s < 0)
+                return pio_asm_error(a, "invalid mov operand", dst < 0 ? tok[1] : src);
+            instr = 0xA000 | dst << 5 | opr << 3 | s;
+        }
+    } else if(!strcasecmp(op, "irq") && count >= 2){
+        bool clear = false, wait = false;
+        int i = 1;
+        // The mode can come before the operation, as in "irq next set 1"
+        char *rest[4];
+        int rest_count = 0;
+        for(; i < count; i++){
+            if(!strcasecmp(tok[i], "set") || !strcasecmp(tok[i], "nowait"))
+                ;
+            else if(!strcasecmp(tok[i], "wait"))
+                wait = true;
+            else if(!strcasecmp(tok[i], "clear"))
+                clear = true;
+            else if(rest_count < 4)
+                rest[rest_count++] = tok[i];
+        }
+        index = 0;
+        if(!pio_asm_irq_index(a, rest, rest_count, &index))
+            return false;
+        instr = 0xC000 | clear << 6 | wait << 5 | index;
+    } else if(!strcasecmp(op, "set") && count == 3){
+        int dst = pio_asm_lookup(tok[1], set_dsts, 8);
+        if(dst < 0)
+            return pio_asm_error(a, "invalid set destination", tok[1]);
+        if(!pio_asm_number(tok[2], &value) || value < 0 || value > 31)
+            return pio_asm_error(a, "invalid set value", tok[2]);
+        instr = 0xE000 | dst << 5 | value;
+    } else {
+        return pio_asm_error(a, "invalid instruction", op);
+    }
+
+    // Side-set in the top bits of the delay field, with the enable bit first if optional
+    int ss_bits = p->sideset_count + p->sideset_opt;
+    if(delay >= (1 << (5 - ss_bits)))
+        return pio_asm_error(a, "delay too long", NULL);
+    int field = delay;
+    if(side >= 0){
+        if(!p->sideset_count || side >= (1 << p->sideset_count))
+            return pio_asm_error(a, "invalid side-set", NULL);
+        field |= ((p->sideset_opt ? 1 << p->sideset_count : 0) | side) << (5 - ss_bits);
+    } else if(p->sideset_count && !p->sideset_opt){
+        return pio_asm_error(a, "side-set required", NULL);
+    }
+    p->instructions[p->length++] = instr | field << 8;
+    return true;
+}
+
+static bool pio_asm_shift(pio_asm_t *a, char **tok, int count, uint8_t *pins, bool *right,
+                          bool *autox, uint8_t *threshold){
+    int value;
+    if(count < 2 || !pio_asm_number(tok[1], &value) || value < 0 || value > 32)
+        return pio_asm_error(a, "invalid pin count", count < 2 ? NULL : tok[1]);
+    *pins = value;
+    for(int i = 2; i < count; i++){
+        if(!strcasecmp(tok[i], "left"))
+            *right = false;
+        else if(!strcasecmp(tok[i], "right"))
+            *right = true;
+        else if(!strcasecmp(tok[i], "auto"))
+            *autox = true;
+        else if(!strcasecmp(tok[i], "manual"))
+            *autox = false;
+        else if(pio_asm_number(tok[i], &value) && value >= 1 && value <= 32)
+            *threshold = value;
+        else
+            return pio_asm_error(a, "invalid shift option", tok[i]);
+    }
+    return true;
+}
+
+static bool pio_asm_directive(pio_asm_t *a, char **tok, int count){
+    static const char *const fifos[6] = {"txrx", "tx", "rx", "txput", "txget", "putget"};
+    pio_asm_program_t *p = a->program;
+    int value;
+    if(!strcasecmp(tok[0], ".wrap_target")){
+        p->wrap_target = p->length;
+    } else if(!strcasecmp(tok[0], ".wrap")){
+        if(!p->length)
+            return pio_asm_error(a, ".wrap before any instruction", NULL);
+        p->wrap = p->length - 1;
+        a->wrap_set = true;
+    } else if(!strcasecmp(tok[0], ".origin")){
+        if(count != 2 || !pio_asm_number(tok[1], &value) || value < 0 || value > 31)
+            return pio_asm_error(a, "invalid origin", NULL);
+        p->origin = value;
+    } else if(!strcasecmp(tok[0], ".side_set")){
+        if(count < 2 || !pio_asm_number(tok[1], &value) || value < 0 || value > 5)
+            return pio_asm_error(a, "invalid side_set", NULL);
+        p->sideset_count = value;
+        for(int i = 2; i < count; i++){
+            if(!strcasecmp(tok[i], "opt"))
+                p->sideset_opt = true;
+            else if(!strcasecmp(tok[i], "pindirs"))
+                p->sideset_pindirs = true;
+            else
+                return pio_asm_error(a, "invalid side_set option", tok[i]);
+        }
+    } else if(!strcasecmp(tok[0], ".clock_div")){
+        char *end;
+        if(count != 2 || (p->clock_div = strtof(tok[1], &end)) < 1.0f || *end)
+            return pio_asm_error(a, "invalid clock_div", NULL);
+    } else if(!strcasecmp(tok[0], ".in")){
+        return pio_asm_shift(a, tok, count, &p->in_count, &p->in_right, &p->in_auto, &p->in_threshold);
+    } else if(!strcasecmp(tok[0], ".out")){
+        return pio_asm_shift(a, tok, count, &p->out_count, &p->out_right, &p->out_auto, &p->out_threshold);
+    } else if(!strcasecmp(tok[0], ".set")){
+        if(count != 2 || !pio_asm_number(tok[1], &value) || value < 0 || value > 5)
+            return pio_asm_error(a, "invalid set count", NULL);
+        p->set_count = value;
+    } else if(!strcasecmp(tok[0], ".fifo")){
+        if(count != 2 || (value = pio_asm_lookup(tok[1], fifos, 6)) < 0)
+            return pio_asm_error(a, "invalid fifo", NULL);
+        p->fifo = value;
+    } else {
+        return pio_asm_error(a, "unsupported directive", tok[0]);
+    }
+    return true;
+}
+
+static bool pio_asm_label_add(pio_asm_t *a, const char *name, bool public){
+    pio_asm_program_t *p = a->program;
+    if(a->symbol_count == PIO_ASM_MAX_SYMBOLS)
+        return pio_asm_error(a, "too many labels", NULL);
+    pio_asm_label_t *s = &a->symbols[a->symbol_count++];
+    snprintf(s->name, sizeof(s->name), "%s", name);
+    s->offset = p->length;
+    if(public){
+        if(p->label_count == PIO_ASM_MAX_LABELS)
+            return pio_asm_error(a, "too many public labels", NULL);
+        p->labels[p->label_count++] = *s;
+    }
+    return true;
+}
+
+// Parses one line of the wanted program. Returns false on error.
+static bool pio_asm_line(pio_asm_t *a, char *line){
+    char *c;
+    if((c = strchr(line, ';')))
+        *c = 0;
+    if((c = strstr(line, "//")))
+        *c = 0;
+
+    // Pull out [delay] and side n before splitting the operands
+    int delay = 0;
+    int side = -1;
+    for(c = strchr(line, '['); c && c > line && !isspace((unsigned char)c[-1]); c = strchr(c + 1, '['))
+        ;   // Skip rxfifo[n]
+    if(c){
+        char *end = strchr(c, ']');
+        if(!end || sscanf(c + 1, "%d", &delay) != 1 || delay < 0)
+            return pio_asm_error(a, "invalid delay", NULL);
+        memset(c, ' ', end - c + 1);
+    }
+    char *tok[PIO_ASM_MAX_TOKENS];
+    int count = 0;
+    for(char *t = strtok(line, " \t\r\n,"); t; t = strtok(NULL, " \t\r\n,")){
+        if(count == PIO_ASM_MAX_TOKENS)
+            return pio_asm_error(a, "line too long", NULL);
+        tok[count++] = t;
+    }
+    for(int i = 0; i + 1 < count; i++)
+        if(!strcasecmp(tok[i], "side")){
+            if(!pio_asm_number(tok[i + 1], &side) || side < 0)
+                return pio_asm_error(a, "invalid side-set", tok[i + 1]);
+            memmove(&tok[i], &tok[i + 2], (count - i - 2) * sizeof(*tok));
+            count -= 2;
+            break;
+        }
+
+    // Labels
+    while(count){
+        bool public = count >= 2 && !strcasecmp(tok[0], "public");
+        char *name = tok[public];
+        size_t len = strlen(name);
+        if(!len || name[len - 1] != ':')
+            break;
+        name[len - 1] = 0;
+        if(!pio_asm_label_add(a, name, public))
+            return false;
+        memmove(&tok[0], &tok[public + 1], (count - public - 1) * sizeof(*tok));
+        count -= public + 1;
+    }
+    if(!count)
+        return true;
+    if(tok[0][0] == '.')
+        return pio_asm_directive(a, tok, count);
+    return pio_asm_instruction(a, tok, count, delay, side);
+}
+
+static bool pio_asm_finish(pio_asm_t *a){
+    pio_asm_program_t *p = a->program;
+    if(!p->length)
+        return pio_asm_error(a, "empty program", p->name);
+    if(!a->wrap_set)
+        p->wrap = p->length - 1;
+    for(int i = 0; i < p->length; i++){
+        if(!a->fixups[i][0])
+            continue;
+        int s;
+        for(s = 0; s < a->symbol_count; s++)
+            if(!strcmp(a->symbols[s].name, a->fixups[i]))
+                break;
+        if(s == a->symbol_count)
+            return pio_asm_error(a, "unknown label", a->fixups[i]);
+        // JMP targets are absolute, programs loaded at offset 0 in the simulator
+        p->instructions[i] |= a->symbols[s].offset;
+    }
+    return true;
+}
+
+bool pio_asm_load(const char *path, const char *name, pio_asm_program_t *program){
+    FILE *f = fopen(path, "r");
+    if(!f){
+        fprintf(stderr, "?Error opening %s (%s)\n", path, strerror(errno));
+        return false;
+    }
+    static pio_asm_t a;
+    memset(&a, 0, sizeof(a));
+    memset(program, 0, sizeof(*program));
+    a.path = path;
+    a.program = program;
+    snprintf(program->name, sizeof(program->name), "%s", name);
+    program->origin = -1;
+    program->clock_div = 1.0f;
+    program->in_count = program->out_count = 32;
+    program->in_right = program->out_right = true;
+    program->in_threshold = program->out_threshold = 32;
+
+    bool in_program = false;
+    bool found = false;
+    bool ok = true;
+    char line[256];
+    while(ok && fgets(line, sizeof(line), f)){
+        a.line++;
+        char word[64];
+        if(sscanf(line, " .program %63s", word) == 1){
+            if(in_program)
+                break;
+            in_program = !strcmp(word, name);
+            found |= in_program;
+            continue;
+        }
+        if(in_program)
+            ok = pio_asm_line(&a, line);
+    }
+    fclose(f);
+    if(ok && !found){
+        fprintf(stderr, "?%s: no program %s\n", path, name);
+        return false;
+    }
+    return ok && pio_asm_finish(&a);
+}
+
+int pio_asm_label(const pio_asm_program_t *program, const char *name){
+    for(int i = 0; i < program->label_count; i++)
+        if(!strcmp(program->labels[i].name, name))
+            return program->labels[i].offset;
+    return -1;
+}
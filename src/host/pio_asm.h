@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2026 Sodiumlightbaby
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+// Assembler for the subset of pioasm used by the firmware .pio files, so the
+// host tools can load the programs without the Pico SDK. Instructions are
+// encoded as pioasm does (RP2350 flavour) and the directives give the same
+// values as the generated <name>_program_get_default_config().
+
+#ifndef _PIO_ASM_H_
+#define _PIO_ASM_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define PIO_ASM_MAX_INSTR  32
+#define PIO_ASM_MAX_LABELS 16
+
+// FIFO join, as set by .fifo
+#define PIO_ASM_FIFO_TXRX   0
+#define PIO_ASM_FIFO_TX     1
+#define PIO_ASM_FIFO_RX     2
+#define PIO_ASM_FIFO_TXPUT  3
+#define PIO_ASM_FIFO_TXGET  4
+#define PIO_ASM_FIFO_PUTGET 5
+
+typedef struct {
+    char name[32];
+    uint8_t offset;
+} pio_asm_label_t;
+
+typedef struct {
+    char name[32];
+    uint16_t instructions[PIO_ASM_MAX_INSTR];
+    uint8_t length;
+    int8_t origin;              // -1 if not set
+    uint8_t wrap_target;
+    uint8_t wrap;
+    uint8_t sideset_count;      // Side-set value bits, excluding the opt bit
+    bool sideset_opt;
+    bool sideset_pindirs;
+    float clock_div;            // 1.0 if not set
+    uint8_t in_count;
+    bool in_right;
+    bool in_auto;
+    uint8_t in_threshold;
+    uint8_t out_count;
+    bool out_right;
+    bool out_auto;
+    uint8_t out_threshold;
+    uint8_t set_count;
+    uint8_t fifo;               // PIO_ASM_FIFO_*
+    pio_asm_label_t labels[PIO_ASM_MAX_LABELS];   // Public labels
+    uint8_t label_count;
+} pio_asm_program_t;
+
+// Assemble program name from a .pio file. Prints errors to stderr.
+bool pio_asm_load(const char *path, const char *name, pio_asm_program_t *program);
+
+// Offset of a public label, -1 if missing
+int pio_asm_label(const pio_asm_program_t *program, const char *name);
+
+#endif /* _PIO_ASM_H_ */
@@ -0,0 +1,407 @@
+/*
+ * Copyright (c) 2026 Sodiumlightbaby
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "pio_sim.h"
+#include <stdio.h>
+#include <string.h>
+
+void pio_sim_init(pio_sim_t *sim){
+    memset(sim, 0, sizeof(*sim));
+}
+
+int pio_sim_add_program(pio_sim_t *sim, int pio, const pio_asm_program_t *program){
+    pio_sim_block_t *blk = &sim->pio[pio];
+    uint32_t mask = (program->length == 32) ? 0xFFFFFFFFu : ((1u << program->length) - 1);
+    int offset = -1;
+    if(program->origin >= 0){
+        if(program->origin + program->length <= 32 && !(blk->used & (mask << program->origin)))
+            offset = program->origin;
+    } else {
+        // Highest free offset first, as pio_add_program
+        for(int i = 32 - program->length; i >= 0; i--)
+            if(!(blk->used & (mask << i))){
+                offset = i;
+                break;
+            }
+    }
+    if(offset < 0)
+        return -1;
+    blk->used |= mask << offset;
+    for(int i = 0; i < program->length; i++){
+        uint16_t instr = program->instructions[i];
+        if(!(instr & 0xE000))
+            instr = (instr & ~0x1F) | ((instr + offset) & 0x1F);
+        blk->instr[offset + i] = instr;
+    }
+    return offset;
+}
+
+void pio_sim_set_clkdiv(pio_sim_sm_t *sm, float div){
+    sm->clkdiv = (uint32_t)(div * 256.0f + 0.5f);
+}
+
+pio_sim_sm_t *pio_sim_sm_init(pio_sim_t *sim, int pio, int sm_num, int offset, const pio_asm_program_t *program){
+    pio_sim_sm_t *sm = &sim->pio[pio].sm[sm_num];
+    memset(sm, 0, sizeof(*sm));
+    sm->wrap_bottom = offset + program->wrap_target;
+    sm->wrap_top = offset + program->wrap;
+    sm->sideset_count = program->sideset_count;
+    sm->sideset_opt = program->sideset_opt;
+    sm->sideset_pindirs = program->sideset_pindirs;
+    sm->in_count = program->in_count;
+    sm->out_count = program->out_count;
+    sm->set_count = program->set_count;
+    sm->in_right = program->in_right;
+    sm->out_right = program->out_right;
+    sm->autopush = program->in_auto;
+    sm->autopull = program->out_auto;
+    sm->push_threshold = program->in_threshold;
+    sm->pull_threshold = program->out_threshold;
+    sm->fifo = program->fifo;
+    pio_sim_set_clkdiv(sm, program->clock_div);
+    sm->pc = offset;
+    // OSR starts empty, so autopull fetches before the first OUT
+    sm->osr_count = 32;
+    return sm;
+}
+
+void pio_sim_enable(pio_sim_t *sim, int pio, uint32_t mask){
+    for(int i = 0; i < PIO_SIM_SMS; i++)
+        if(mask & (1u << i)){
+            sim->pio[pio].sm[i].enabled = true;
+            sim->pio[pio].sm[i].div_acc = 0;
+        }
+}
+
+static int pio_sim_tx_depth(const pio_sim_sm_t *sm){
+    switch(sm->fifo){
+        case PIO_ASM_FIFO_TX:     return 8;
+        case PIO_ASM_FIFO_RX:     return 0;
+        case PIO_ASM_FIFO_PUTGET: return 0;
+        default:                  return 4;
+    }
+}
+
+static int pio_sim_rx_depth(const pio_sim_sm_t *sm){
+    switch(sm->fifo){
+        case PIO_ASM_FIFO_TXRX: return 4;
+        case PIO_ASM_FIFO_RX:   return 8;
+        default:                return 0;
+    }
+}
+
+bool pio_sim_tx_full(const pio_sim_sm_t *sm){
+    return sm->tx_level >= pio_sim_tx_depth(sm);
+}
+
+bool pio_sim_put(pio_sim_sm_t *sm, uint32_t value){
+    if(pio_sim_tx_full(sm))
+        return false;
+    sm->tx[(sm->tx_head + sm->tx_level++) & 7] = value;
+    return true;
+}
+
+static uint32_t pio_sim_tx_pop(pio_sim_sm_t *sm){
+    uint32_t value = sm->tx[sm->tx_head];
+    sm->tx_head = (sm->tx_head + 1) & 7;
+    sm->tx_level--;
+    return value;
+}
+
+static bool pio_sim_rx_push(pio_sim_sm_t *sm, uint32_t value){
+    if(sm->rx_level >= pio_sim_rx_depth(sm))
+        return false;
+    sm->rx[(sm->rx_head + sm->rx_level++) & 7] = value;
+    return true;
+}
+
+bool pio_sim_get(pio_sim_sm_t *sm, uint32_t *value){
+    if(!sm->rx_level)
+        return false;
+    *value = sm->rx[sm->rx_head];
+    sm->rx_head = (sm->rx_head + 1) & 7;
+    sm->rx_level--;
+    return true;
+}
+
+// GPIO of pin i counted from base, wrapping within the 32 GPIO window of the block
+static inline int pio_sim_pin(const pio_sim_block_t *blk, int base, int i){
+    return blk->gpio_base + ((base - blk->gpio_base + i) & 31);
+}
+
+static uint32_t pio_sim_read_pins(const pio_sim_block_t *blk, uint64_t levels, int base, int count){
+    uint32_t value = 0;
+    for(int i = 0; i < count; i++)
+        value |= (uint32_t)((levels >> pio_sim_pin(blk, base, i)) & 1) << i;
+    return value;
+}
+
+static void pio_sim_write_pins(pio_sim_t *sim, const pio_sim_block_t *blk, bool dirs, int base, int count, uint32_t value){
+    uint64_t *reg = dirs ? &sim->gpio_oe : &sim->gpio_out;
+    for(int i = 0; i < count; i++){
+        uint64_t bit = 1ull << pio_sim_pin(blk, base, i);
+        *reg = (value >> i) & 1 ? *reg | bit : *reg & ~bit;
+    }
+}
+
+// Block and flag number of an irq index with its prev/rel/next mode
+static uint8_t *pio_sim_irq(pio_sim_t *sim, uint8_t *flags, int pio, int sm, int index, uint8_t *bit){
+    int num = index & 7;
+    switch((index >> 3) & 3){
+        case 1: pio = (pio + PIO_SIM_BLOCKS - 1) % PIO_SIM_BLOCKS; break;
+        case 2: num = (num & 4) | ((num + sm) & 3); break;
+        case 3: pio = (pio + 1) % PIO_SIM_BLOCKS; break;
+    }
+    *bit = 1u << num;
+    return flags ? &flags[pio] : &sim->pio[pio].irq;
+}
+
+static uint32_t pio_sim_bitrev(uint32_t v){
+    uint32_t r = 0;
+    for(int i = 0; i < 32; i++)
+        r |= ((v >> i) & 1) << (31 - i);
+    return r;
+}
+
+static void pio_sim_tick(pio_sim_t *sim, int p, int s, uint64_t levels, uint8_t *irq_snap){
+    pio_sim_block_t *blk = &sim->pio[p];
+    pio_sim_sm_t *sm = &blk->sm[s];
+
+    // Autopull refills an empty OSR in the background
+    if(sm->autopull && sm->osr_count >= sm->pull_threshold && sm->tx_level){
+        sm->osr = pio_sim_tx_pop(sm);
+        sm->osr_count = 0;
+    }
+    if(sm->delay){
+        sm->delay--;
+        return;
+    }
+
+    uint16_t instr = blk->instr[sm->pc];
+    int ss_bits = sm->sideset_count + sm->sideset_opt;
+    int field = (instr >> 8) & 0x1F;
+    int delay = field & ((1 << (5 - ss_bits)) - 1);
+    if(ss_bits){
+        int side = field >> (5 - ss_bits);
+        if(!sm->sideset_opt || (side >> sm->sideset_count))
+            pio_sim_write_pins(sim, blk, sm->sideset_pindirs, sm->sideset_base, sm->sideset_count,
+                               side & ((1 << sm->sideset_count) - 1));
+    }
+
+    int arg1 = (instr >> 5) & 7;
+    int arg2 = instr & 0x1F;
+    int bits = arg2 ? arg2 : 32;
+    uint32_t mask = bits == 32 ? 0xFFFFFFFFu : (1u << bits) - 1;
+    bool stall = false;
+    bool jumped = false;
+    uint8_t bit;
+    uint8_t *flag;
+    uint32_t data = 0;
+
+    switch(instr >> 13){
+        case 0: {   // JMP
+            bool take;
+            switch(arg1){
+                case 0: take = true; break;
+                case 1: take = !sm->x; break;
+                case 2: take = sm->x--; break;
+                case 3: take = !sm->y; break;
+                case 4: take = sm->y--; break;
+                case 5: take = sm->x != sm->y; break;
+                case 6: take = (levels >> sm->jmp_pin) & 1; break;
+                default: take = sm->osr_count < sm->pull_threshold; break;
+            }
+            if(take){
+                sm->pc = arg2;
+                jumped = true;
+            }
+            break;
+        }
+        case 1: {   // WAIT
+            bool pol = instr & 0x80;
+            int index = instr & 0x1F;
+            bool level;
+            switch((instr >> 5) & 3){
+                case 0: level = (levels >> (blk->gpio_base + index)) & 1; break;
+                case 1: level = index < sm->in_count && ((levels >> pio_sim_pin(blk, sm->in_base, index)) & 1); break;
+                case 2:
+                    level = *pio_sim_irq(sim, irq_snap, p, s, index, &bit) & bit;
+                    if(level && pol)
+                        *pio_sim_irq(sim, NULL, p, s, index, &bit) &= ~bit;
+                    break;
+                default: level = (levels >> pio_sim_pin(blk, sm->jmp_pin, index & 3)) & 1; break;
+            }
+            stall = level != pol;
+            break;
+        }
+        case 2:     // IN
+            switch(arg1){
+                case 0: data = pio_sim_read_pins(blk, levels, sm->in_base, sm->in_count); break;
+                case 1: data = sm->x; break;
+                case 2: data = sm->y; break;
+                case 6: data = sm->isr; break;
+                case 7: data = sm->osr; break;
+                default: data = 0; break;
+            }
+            if(sm->autopush && sm->isr_count + bits >= sm->push_threshold &&
+               sm->rx_level >= pio_sim_rx_depth(sm)){
+                stall = true;
+                break;
+            }
+            data &= mask;
+            if(bits == 32)
+                sm->isr = data;
+            else if(sm->in_right)
+                sm->isr = (sm->isr >> bits) | (data << (32 - bits));
+            else
+                sm->isr = (sm->isr << bits) | data;
+            sm->isr_count = sm->isr_count + bits > 32 ? 32 : sm->isr_count + bits;
+            if(sm->autopush && sm->isr_count >= sm->push_threshold){
+                pio_sim_rx_push(sm, sm->isr);
+                sm->isr = 0;
+                sm->isr_count = 0;
+            }
+            break;
+        case 3:     // OUT
+            if(sm->autopull && sm->osr_count >= sm->pull_threshold){
+                if(!sm->tx_level){
+                    stall = true;
+                    break;
+                }
+                sm->osr = pio_sim_tx_pop(sm);
+                sm->osr_count = 0;
+            }
+            if(sm->out_right){
+                data = sm->osr & mask;
+                sm->osr = bits == 32 ? 0 : sm->osr >> bits;
+            } else {
+                data = bits == 32 ? sm->osr : sm->osr >> (32 - bits);
+                sm->osr = bits == 32 ? 0 : sm->osr << bits;
+            }
+            sm->osr_count = sm->osr_count + bits > 32 ? 32 : sm->osr_count + bits;
+            switch(arg1){
+                case 0: pio_sim_write_pins(sim, blk, false, sm->out_base, sm->out_count, data); break;
+                case 1: sm->x = data; break;
+                case 2: sm->y = data; break;
+                case 4: pio_sim_write_pins(sim, blk, true, sm->out_base, sm->out_count, data); break;
+                case 5: sm->pc = data & 0x1F; jumped = true; break;
+                case 6: sm->isr = data; sm->isr_count = bits; break;
+                case 7: fprintf(stderr, "?out exec not simulated\n"); break;
+                default: break;
+            }
+            break;
+        case 4:     // PUSH, PULL, MOV to/from RX FIFO registers
+            if(instr & 0x10){
+                int index = (instr & 0x08) ? (instr & 3) : (sm->y & 3);
+                if(instr & 0x80){
+                    sm->osr = sm->putget[index];
+                    sm->osr_count = 0;
+                } else {
+                    sm->putget[index] = sm->isr;
+                }
+            } else if(instr & 0x80){
+                if((instr & 0x40) && sm->osr_count < sm->pull_threshold)
+                    break;
+                if(sm->tx_level)
+                    sm->osr = pio_sim_tx_pop(sm);
+                else if(instr & 0x20){
+                    stall = true;
+                    break;
+                } else
+                    sm->osr = sm->x;
+                sm->osr_count = 0;
+            } else {
+                if((instr & 0x40) && sm->isr_count < sm->push_threshold)
+                    break;
+                if(sm->rx_level >= pio_sim_rx_depth(sm) && (instr & 0x20)){
+                    stall = true;
+                    break;
+                }
+                pio_sim_rx_push(sm, sm->isr);
+                sm->isr = 0;
+                sm->isr_count = 0;
+            }
+            break;
+        case 5:     // MOV
+            switch(instr & 7){
+                case 0: data = pio_sim_read_pins(blk, levels, sm->in_base, sm->in_count); break;
+                case 1: data = sm->x; break;
+                case 2: data = sm->y; break;
+                case 6: data = sm->isr; break;
+                case 7: data = sm->osr; break;
+                default: data = 0; break;
+            }
+            if(((instr >> 3) & 3) == 1)
+                data = ~data;
+            else if(((instr >> 3) & 3) == 2)
+                data = pio_sim_bitrev(data);
+            switch(arg1){
+                case 0: pio_sim_write_pins(sim, blk, false, sm->out_base, sm->out_count, data); break;
+                case 1: sm->x = data; break;
+                case 2: sm->y = data; break;
+                case 3: pio_sim_write_pins(sim, blk, true, sm->out_base, sm->out_count, data); break;
+                case 4: fprintf(stderr, "?mov exec not simulated\n"); break;
+                case 5: sm->pc = data & 0x1F; jumped = true; break;
+                case 6: sm->isr = data; sm->isr_count = 0; break;
+                default: sm->osr = data; sm->osr_count = 0; break;
+            }
+            break;
+        case 6:     // IRQ
+            flag = pio_sim_irq(sim, NULL, p, s, arg2, &bit);
+            if(instr & 0x40){
+                *flag &= ~bit;
+            } else if(sm->irq_waiting){
+                if(*pio_sim_irq(sim, irq_snap, p, s, arg2, &bit) & bit)
+                    stall = true;
+                else
+                    sm->irq_waiting = false;
+            } else {
+                *flag |= bit;
+                if(instr & 0x20){
+                    sm->irq_waiting = true;
+                    stall = true;
+                }
+            }
+            break;
+        default:    // SET
+            switch(arg1){
+                case 0: pio_sim_write_pins(sim, blk, false, sm->set_base, sm->set_count, arg2); break;
+                case 1: sm->x = arg2; break;
+                case 2: sm->y = arg2; break;
+                case 4: pio_sim_write_pins(sim, blk, true, sm->set_base, sm->set_count, arg2); break;
+                default: break;
+            }
+            break;
+    }
+
+    if(stall){
+        sm->stalls++;
+        return;
+    }
+    sm->executed++;
+    sm->delay = delay;
+    if(!jumped)
+        sm->pc = sm->pc == sm->wrap_top ? sm->wrap_bottom : (sm->pc + 1) & 0x1F;
+}
+
+void pio_sim_step(pio_sim_t *sim){
+    uint64_t levels = (sim->gpio_oe & sim->gpio_out) | (~sim->gpio_oe & sim->gpio_in);
+    uint8_t irq_snap[PIO_SIM_BLOCKS];
+    for(int p = 0; p < PIO_SIM_BLOCKS; p++)
+        irq_snap[p] = sim->pio[p].irq;
+    for(int p = 0; p < PIO_SIM_BLOCKS; p++)
+        for(int s = 0; s < PIO_SIM_SMS; s++){
+            pio_sim_sm_t *sm = &sim->pio[p].sm[s];
+            if(!sm->enabled)
+                continue;
+            sm->div_acc += 256;
+            if(sm->div_acc < sm->clkdiv)
+                continue;
+            sm->div_acc -= sm->clkdiv;
+            pio_sim_tick(sim, p, s, levels, irq_snap);
+        }
+    sim->clock++;
+}
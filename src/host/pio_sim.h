@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2026 Sodiumlightbaby
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+// Instruction level simulator of the three RP2350 PIO blocks, stepped one
+// sys clock at a time. Models clock dividers, delays and stalls, side-set,
+// shift counters with autopush/autopull, FIFOs with joins and the RP2350
+// FIFO registers, and IRQ flags including prev/next. Instructions see the
+// pins and IRQ flags as they were at the start of the sys clock, so a flag
+// set by one state machine is seen by the others one clock later.
+// Not modelled: exec, mov status, pin sync bypass and input synchronisers.
+
+#ifndef _PIO_SIM_H_
+#define _PIO_SIM_H_
+
+#include "pio_asm.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#define PIO_SIM_BLOCKS 3
+#define PIO_SIM_SMS    4
+#define PIO_SIM_GPIOS  48
+
+typedef struct {
+    // Configuration, GPIO numbers are absolute
+    uint8_t wrap_bottom;
+    uint8_t wrap_top;
+    uint8_t sideset_count;
+    bool sideset_opt;
+    bool sideset_pindirs;
+    uint8_t sideset_base;
+    uint8_t in_base;
+    uint8_t in_count;           // RP2350 masks pins above this to 0 on reads
+    uint8_t out_base;
+    uint8_t out_count;
+    uint8_t set_base;
+    uint8_t set_count;
+    uint8_t jmp_pin;
+    bool in_right;
+    bool out_right;
+    bool autopush;
+    bool autopull;
+    uint8_t push_threshold;
+    uint8_t pull_threshold;
+    uint8_t fifo;               // PIO_ASM_FIFO_*
+    uint32_t clkdiv;            // 16.8 fixed point
+
+    // State
+    bool enabled;
+    uint8_t pc;
+    uint32_t x;
+    uint32_t y;
+    uint32_t isr;
+    uint32_t osr;
+    uint8_t isr_count;
+    uint8_t osr_count;
+    uint8_t delay;
+    bool irq_waiting;           // irq wait set its flag, waiting for the clear
+    uint32_t div_acc;
+    uint32_t tx[8];
+    uint8_t tx_head;
+    uint8_t tx_level;
+    uint32_t rx[8];
+    uint8_t rx_head;
+    uint8_t rx_level;
+    uint32_t putget[4];         // FIFO registers in txput/txget/putget mode
+
+    // Statistics
+    uint64_t executed;
+    uint64_t stalls;
+} pio_sim_sm_t;
+
+typedef struct {
+    uint16_t instr[32];
+    uint32_t used;              // Instruction memory allocation
+    uint8_t irq;
+    uint8_t gpio_base;          // 0 or 16
+    pio_sim_sm_t sm[PIO_SIM_SMS];
+} pio_sim_block_t;
+
+typedef struct {
+    pio_sim_block_t pio[PIO_SIM_BLOCKS];
+    uint64_t clock;             // sys clocks stepped
+    uint64_t gpio_in;           // Levels driven from outside
+    uint64_t gpio_out;          // Levels and directions driven by the PIOs
+    uint64_t gpio_oe;
+} pio_sim_t;
+
+void pio_sim_init(pio_sim_t *sim);
+
+// Load a program into instruction memory, at its origin or the first free
+// offset, relocating JMP targets as pio_add_program does. Returns the offset
+// or -1 if it does not fit.
+int pio_sim_add_program(pio_sim_t *sim, int pio, const pio_asm_program_t *program);
+
+// Configure a state machine with the program defaults, as
+// pio_sm_init(pio, sm, offset, <name>_program_get_default_config(offset)).
+// Pin bases default to 0 and are set on the returned state machine.
+pio_sim_sm_t *pio_sim_sm_init(pio_sim_t *sim, int pio, int sm, int offset, const pio_asm_program_t *program);
+
+void pio_sim_set_clkdiv(pio_sim_sm_t *sm, float div);
+
+// Enable state machines of a block with their dividers in phase
+void pio_sim_enable(pio_sim_t *sim, int pio, uint32_t mask);
+
+bool pio_sim_put(pio_sim_sm_t *sm, uint32_t value);
+bool pio_sim_get(pio_sim_sm_t *sm, uint32_t *value);
+static inline bool pio_sim_rx_empty(const pio_sim_sm_t *sm) { return !sm->rx_level; }
+bool pio_sim_tx_full(const pio_sim_sm_t *sm);
+
+// Level seen on a GPIO, PIO output if enabled, else the external input
+static inline bool pio_sim_gpio(const pio_sim_t *sim, int gpio){
+    uint64_t bit = 1ull << gpio;
+    return (sim->gpio_oe & bit ? sim->gpio_out : sim->gpio_in) & bit;
+}
+
+// Advance all enabled state machines by one sys clock
+void pio_sim_step(pio_sim_t *sim);
+
+#endif /* _PIO_SIM_H_ */
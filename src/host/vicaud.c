@@ -0,0 +1,321 @@
+/*
+ * Copyright (c) 2026 Sodiumlightbaby
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+// VIC voice synthesis check. Renders single voice test tones at the DVI
+// audio sample rate with the aud_blep model, with hard edges as the firmware
+// has always sampled them and band limited, and measures the aliasing of
+// each: the energy outside the harmonics of the tone relative to the energy
+// on them. The hard edge render is checked sample by sample against
+// aud_tick_inline run every CPU cycle, as aud_task would see it. Also times
+// the render per sample with all four voices playing.
+
+#include "perf.h"
+#include "vic/aud.h"
+#include "vic/aud_blep.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define VICAUD_WARMUP 4096      // Samples rendered before measuring
+#define VICAUD_GUARD  6         // FFT bins either side of a harmonic counted as signal, at most
+#define VICAUD_FS     48000     // DVI_AUDIO_FS
+
+// aud_tick_inline state and event ring, normally in aud.c
+volatile aud_union_t aud_counters;
+volatile aud_union_t aud_ticks;
+volatile aud_union_t aud_regs;
+volatile aud_union_t aud_sr;
+volatile uint32_t aud_noise_count;
+aud_event_t aud_ev_ring[AUD_EV_RING_LEN];
+volatile uint32_t aud_ev_head;
+volatile uint32_t aud_ev_tail;
+volatile uint32_t aud_ev_lost;
+
+static const char *vicaud_mode_name = "PAL";
+static uint32_t vicaud_sys_hz = 319200000;
+static uint32_t vicaud_cycle_sys = 288;         // sys clocks per CPU cycle, see vic_pio_init
+static uint32_t vicaud_samples = 65536;
+static int vicaud_voice = -1;
+static double vicaud_min_gain;
+
+static uint32_t vicaud_step(void){
+    // As aud_init with dvi_audio_fs_period_x2()
+    uint32_t period_x2 = (2 * vicaud_sys_hz) / (VICAUD_FS + 64);
+    return ((uint64_t)period_x2 << 15) / vicaud_cycle_sys;
+}
+
+static double vicaud_fs(void){
+    return 2.0 * vicaud_sys_hz / ((2 * vicaud_sys_hz) / (VICAUD_FS + 64));
+}
+
+// Per CPU cycle reference. Voice levels as aud_calc_voice and aud_step_noise
+// leave them, if aud_task ran every CPU cycle.
+typedef struct {
+    uint8_t noise_sr;
+    uint16_t lfsr;
+    uint8_t val[4];
+    uint64_t pos;               // 16.16 CPU cycles rendered
+} vicaud_ref_t;
+
+static void vicaud_ref_init(vicaud_ref_t *r){
+    aud_counters.all = aud_ticks.all = aud_regs.all = aud_sr.all = 0;
+    r->noise_sr = 0;
+    r->lfsr = 0xFFFF;
+    memset(r->val, 1, sizeof(r->val));
+    r->pos = 0;
+}
+
+static int32_t vicaud_ref_render(vicaud_ref_t *r, uint8_t *regs, uint32_t step){
+    uint64_t end = r->pos + step;
+    // CPU cycle c, counted from 1, is in this sample if its time c<<16 is before the sample
+    uint64_t c = (r->pos + 0xFFFF) >> 16;
+    for(c = c ? c : 1; (c << 16) < end; c++){
+        uint32_t noise_count = aud_noise_count;
+        aud_tick_inline((uint32_t *)regs);
+        aud_ev_tail = aud_ev_head;
+        for(int i = 0; i < 3; i++)
+            r->val[i] = (aud_regs.ch[i] & 0x80) ? ((aud_sr.ch[i] & 1) ? 4 : 0) : 1;
+        if(aud_noise_count != noise_count){
+            uint8_t reg = aud_regs.ch[3];
+            uint8_t enable = reg >> 7;
+            uint16_t tmp = r->lfsr;
+            uint8_t next_lfsr_bit = ((((tmp >> 3) ^ (tmp >> 12) ^ (tmp >> 14) ^ (tmp >> 15)) | ~enable) & 1u);
+            uint8_t old_lfsr_bit = tmp & 1u;
+            r->lfsr = (tmp << 1) | next_lfsr_bit;
+            if(next_lfsr_bit == 1 && old_lfsr_bit == 0){
+                uint8_t next_sr_bit = (~r->noise_sr >> 7) & enable;
+                r->noise_sr = (r->noise_sr << 1) | next_sr_bit;
+                r->val[3] = enable ? (next_sr_bit ? 4 : 0) : 1;
+            }
+        }
+    }
+    r->pos = end;
+    return (r->val[0] + r->val[1] + r->val[2] + r->val[3]) << 8;
+}
+
+static void vicaud_fft(double *re, double *im, uint32_t n){
+    for(uint32_t i = 1, j = 0; i < n; i++){
+        uint32_t bit = n >> 1;
+        for(; j & bit; bit >>= 1)
+            j ^= bit;
+        j ^= bit;
+        if(i < j){
+            double t = re[i]; re[i] = re[j]; re[j] = t;
+            t = im[i]; im[i] = im[j]; im[j] = t;
+        }
+    }
+    for(uint32_t len = 2; len <= n; len <<= 1){
+        double a = -2 * M_PI / len;
+        for(uint32_t i = 0; i < n; i += len){
+            for(uint32_t k = 0; k < len / 2; k++){
+                double wr = cos(a * k), wi = sin(a * k);
+                double xr = re[i + k + len / 2] * wr - im[i + k + len / 2] * wi;
+                double xi = re[i + k + len / 2] * wi + im[i + k + len / 2] * wr;
+                re[i + k + len / 2] = re[i + k] - xr;
+                im[i + k + len / 2] = im[i + k] - xi;
+                re[i + k] += xr;
+                im[i + k] += xi;
+            }
+        }
+    }
+}
+
+// Energy off the harmonics of f0 relative to the energy on them, in dB
+static double vicaud_alias_db(const int32_t *samples, uint32_t n, double f0){
+    double *re = calloc(n, sizeof(double));
+    double *im = calloc(n, sizeof(double));
+    bool *signal = calloc(n / 2, sizeof(bool));
+    double mean = 0;
+    for(uint32_t i = 0; i < n; i++)
+        mean += samples[i];
+    mean /= n;
+    // 4 term Blackman-Harris, sidelobes below -92 dB
+    for(uint32_t i = 0; i < n; i++){
+        double w = 2 * M_PI * i / n;
+        re[i] = (samples[i] - mean) * (0.35875 - 0.48829 * cos(w) + 0.14128 * cos(2 * w) - 0.01168 * cos(3 * w));
+    }
+    vicaud_fft(re, im, n);
+    double fs = vicaud_fs();
+    // Keep a third of the bins between low harmonics as the off part
+    int guard = (int)(f0 * n / fs / 3);
+    if(guard > VICAUD_GUARD)
+        guard = VICAUD_GUARD;
+    for(int b = 0; b <= guard; b++)
+        signal[b] = true;
+    for(double f = f0; f < fs / 2; f += f0){
+        int c = (int)lround(f * n / fs);
+        for(int b = c - guard; b <= c + guard; b++)
+            if(b >= 0 && b < (int)n / 2)
+                signal[b] = true;
+    }
+    double on = 0, off = 0;
+    for(uint32_t b = 0; b < n / 2; b++){
+        double p = re[b] * re[b] + im[b] * im[b];
+        if(signal[b])
+            on += p;
+        else
+            off += p;
+    }
+    free(re);
+    free(im);
+    free(signal);
+    return 10 * log10((off + 1e-30) / (on + 1e-30));
+}
+
+typedef struct {
+    uint32_t tones;
+    uint32_t mismatches;
+    double hard_sum;
+    double blep_sum;
+    double hard_worst;
+    double blep_worst;
+} vicaud_result_t;
+
+static void vicaud_tone(int voice, uint8_t value, int32_t *hard, int32_t *blep, vicaud_result_t *res){
+    uint8_t regs[4] = { 0, 0, 0, 0 };
+    regs[voice] = value | 0x80;
+    uint32_t step = vicaud_step();
+    aud_blep_t bh, bb;
+    vicaud_ref_t ref;
+    aud_blep_init(&bh, step, false);
+    aud_blep_init(&bb, step, true);
+    vicaud_ref_init(&ref);
+    aud_blep_seed(&bh, 0, 0, 0, 0, 0, 0xFFFF);
+    aud_blep_seed(&bb, 0, 0, 0, 0, 0, 0xFFFF);
+    uint32_t mismatches = 0;
+    for(uint32_t i = 0; i < VICAUD_WARMUP + vicaud_samples; i++){
+        int32_t h = aud_blep_render(&bh, regs);
+        int32_t b = aud_blep_render(&bb, regs);
+        if(vicaud_ref_render(&ref, regs, step) != h)
+            mismatches++;
+        if(i >= VICAUD_WARMUP){
+            hard[i - VICAUD_WARMUP] = h;
+            blep[i - VICAUD_WARMUP] = b;
+        }
+    }
+    static const uint8_t prescale[3] = { 16, 8, 4 };
+    double cpu_hz = (double)vicaud_sys_hz / vicaud_cycle_sys;
+    double f0 = cpu_hz / (prescale[voice] * (0x80 - ((value + 1) & 0x7F)) * 16);
+    double ah = vicaud_alias_db(hard, vicaud_samples, f0);
+    double ab = vicaud_alias_db(blep, vicaud_samples, f0);
+    printf(" %d  $%02X %9.1f %8.1f %8.1f %7.1f%s\n", voice, value | 0x80, f0, ah, ab, ah - ab,
+           mismatches ? "  reference mismatch" : "");
+    res->tones++;
+    res->mismatches += mismatches;
+    res->hard_sum += ah;
+    res->blep_sum += ab;
+    if(ah > res->hard_worst)
+        res->hard_worst = ah;
+    if(ab > res->blep_worst)
+        res->blep_worst = ab;
+}
+
+static void vicaud_bench(void){
+    // All voices playing, noise included
+    uint8_t regs[4] = { 0x80 | 0x55, 0x80 | 0x6A, 0x80 | 0x73, 0x80 | 0x7E };
+    uint32_t n = 1u << 20;
+    uint32_t step = vicaud_step();
+    printf("Render cost, 4 voices, %u samples\n", n);
+    for(int blep = 0; blep < 2; blep++){
+        aud_blep_t b;
+        aud_blep_init(&b, step, blep);
+        aud_blep_seed(&b, 0, 0, 0, 0, 0, 0xFFFF);
+        int32_t acc = 0;
+        perf_t p;
+        perf_start(&p);
+        for(uint32_t i = 0; i < n; i++)
+            acc += aud_blep_render(&b, regs);
+        perf_stop(&p);
+        printf(" %-5s %6.1f ns/sample", blep ? "blep" : "hard", p.ns / n);
+        if(p.insns)
+            printf(" %6.1f instructions/sample", (double)p.insns / n);
+        printf(" (%d)\n", acc & 1);
+    }
+}
+
+static void vicaud_usage(void){
+    printf("Usage: vicaud [options]\n"
+           " -m pal|ntsc        Video standard, sets the CPU clock (default pal)\n"
+           " -n samples         FFT length per tone, power of 2 (default 65536)\n"
+           " -v voice           Only test voice 0-2\n"
+           " -g dB              Fail unless BLEP lowers the mean aliasing this much\n"
+           " -h                 This help\n");
+}
+
+int main(int argc, char **argv){
+    int opt;
+    while((opt = getopt(argc, argv, "m:n:v:g:h")) != -1){
+        switch(opt){
+            case 'm':
+                if(!strcmp(optarg, "ntsc")){
+                    vicaud_mode_name = "NTSC";
+                    vicaud_sys_hz = 315000000;
+                    vicaud_cycle_sys = 308;
+                }else if(strcmp(optarg, "pal")){
+                    fprintf(stderr, "?invalid mode %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'n':
+                vicaud_samples = strtoul(optarg, NULL, 0);
+                if(vicaud_samples < 256 || (vicaud_samples & (vicaud_samples - 1))){
+                    fprintf(stderr, "?invalid length %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'v':
+                vicaud_voice = atoi(optarg);
+                if(vicaud_voice < 0 || vicaud_voice > 2){
+                    fprintf(stderr, "?invalid voice %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'g':
+                vicaud_min_gain = atof(optarg);
+                break;
+            case 'h':
+            default:
+                vicaud_usage();
+                return opt == 'h' ? 0 : 1;
+        }
+    }
+
+    int32_t *hard = malloc(vicaud_samples * sizeof(int32_t));
+    int32_t *blep = malloc(vicaud_samples * sizeof(int32_t));
+    vicaud_result_t res = { 0 };
+    res.hard_worst = res.blep_worst = -INFINITY;
+    printf("VIC %s, %.1f Hz sample rate, %.4f CPU cycles per sample\n",
+           vicaud_mode_name, vicaud_fs(), vicaud_step() / 65536.0);
+    printf("Aliasing, dB relative to the harmonics\n");
+    printf(" V  Reg      Tone     Hard     BLEP    Gain\n");
+    for(int v = 0; v < 3; v++){
+        if(vicaud_voice >= 0 && v != vicaud_voice)
+            continue;
+        for(int value = 0x00; value < 0x80; value += 0x08)
+            vicaud_tone(v, value, hard, blep, &res);
+        vicaud_tone(v, 0x7E, hard, blep, &res);
+    }
+    double hard_mean = res.hard_sum / res.tones;
+    double blep_mean = res.blep_sum / res.tones;
+    printf("Mean %.1f dB hard, %.1f dB BLEP, gain %.1f dB. Worst %.1f dB hard, %.1f dB BLEP\n",
+           hard_mean, blep_mean, hard_mean - blep_mean, res.hard_worst, res.blep_worst);
+    free(hard);
+    free(blep);
+    vicaud_bench();
+
+    bool ok = true;
+    if(res.mismatches){
+        printf("?%u samples differ from the per cycle reference\n", res.mismatches);
+        ok = false;
+    }
+    if(hard_mean - blep_mean < vicaud_min_gain){
+        printf("?BLEP gain below %.1f dB\n", vicaud_min_gain);
+        ok = false;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) 2026 Sodiumlightbaby
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+// Host micro benchmarks for the VIC core hot paths. Each bench checks the
+// optimised version against the reference code it replaced before timing.
+
+#include "perf.h"
+#include "vic/vic_lut.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define BENCH_CELLS 65536
+
+typedef struct {
+    uint8_t data;
+    bool hires;
+    bool non_reverse;
+} bench_cell_t;
+
+static bench_cell_t bench_cells[BENCH_CELLS];
+static uint32_t bench_rounds = 200;
+
+// Bit by bit decode as done by the VIC loops before the lookup tables
+static inline void cell_decode_ref(const bench_cell_t *c, uint8_t *pixel){
+    uint8_t charData = c->data;
+    if (c->hires) {
+        uint8_t on = c->non_reverse ? 2 : 0;
+        uint8_t off = c->non_reverse ? 0 : 2;
+        pixel[0] = ((charData & 0x80)? on : off);
+        pixel[1] = ((charData & 0x40)? on : off);
+        pixel[2] = ((charData & 0x20)? on : off);
+        pixel[3] = ((charData & 0x10)? on : off);
+        pixel[4] = ((charData & 0x08)? on : off);
+        pixel[5] = ((charData & 0x04)? on : off);
+        pixel[6] = ((charData & 0x02)? on : off);
+        pixel[7] = ((charData & 0x01)? on : off);
+    } else {
+        pixel[0] = pixel[1] = ((charData >> 6) & 0x03);
+        pixel[2] = pixel[3] = ((charData >> 4) & 0x03);
+        pixel[4] = pixel[5] = ((charData >> 2) & 0x03);
+        pixel[6] = pixel[7] = (charData & 0x03);
+    }
+}
+
+static inline void cell_decode_lut(const bench_cell_t *c, uint8_t *pixel){
+    uint16_t cell = vic_lut_cell(c->data, c->hires, c->non_reverse);
+    for(int n = 0; n < 8; n++)
+        pixel[n] = VIC_LUT_PIXEL(cell, n + 1);
+}
+
+static bool bench_cell_check(void){
+    for(uint32_t i = 0; i < 256 * 4; i++){
+        bench_cell_t c = {(uint8_t)i, (i >> 8) & 1, (i >> 9) & 1};
+        uint8_t ref[8], lut[8];
+        cell_decode_ref(&c, ref);
+        cell_decode_lut(&c, lut);
+        if(memcmp(ref, lut, 8)){
+            printf("?mismatch data:%02x hires:%d non_reverse:%d\n", c.data, c.hires, c.non_reverse);
+            return false;
+        }
+    }
+    return true;
+}
+
+// The colour lookup in the loops uses each index, so fold them all into the result
+#define BENCH_CELL_LOOP(decode) \
+    uint32_t sum = 0; \
+    for(uint32_t r = 0; r < bench_rounds; r++){ \
+        for(uint32_t i = 0; i < BENCH_CELLS; i++){ \
+            uint8_t pixel[8]; \
+            decode(&bench_cells[i], pixel); \
+            for(int n = 0; n < 8; n++) \
+                sum = (sum << 1 | sum >> 31) ^ pixel[n]; \
+        } \
+    } \
+    return sum;
+
+static __attribute__((noinline)) uint32_t bench_cell_ref(void){ BENCH_CELL_LOOP(cell_decode_ref) }
+static __attribute__((noinline)) uint32_t bench_cell_lut(void){ BENCH_CELL_LOOP(cell_decode_lut) }
+
+static void bench_report(const char *name, const perf_t *p, uint64_t n){
+    printf(" %-10s %6.2f ns/cell", name, p->ns / n);
+    if(p->cpu_cycles)
+        printf(" %6.2f cycles/cell", (double)p->cpu_cycles / n);
+    if(p->insns)
+        printf(" %6.2f instructions/cell", (double)p->insns / n);
+    printf("\n");
+}
+
+static bool bench_cell(void){
+    if(!bench_cell_check())
+        return false;
+    // Typical screen mix, mostly hires text with some multicolour and reversed cells
+    srand(1);
+    for(uint32_t i = 0; i < BENCH_CELLS; i++){
+        bench_cells[i].data = rand();
+        bench_cells[i].hires = (rand() & 3) != 0;
+        bench_cells[i].non_reverse = (rand() & 7) != 0;
+    }
+    uint64_t n = (uint64_t)BENCH_CELLS * bench_rounds;
+    perf_t p;
+    printf("Cell decode, %llu cells\n", (unsigned long long)n);
+    perf_start(&p);
+    uint32_t ref = bench_cell_ref();
+    perf_stop(&p);
+    bench_report("bitwise", &p, n);
+    perf_start(&p);
+    uint32_t lut = bench_cell_lut();
+    perf_stop(&p);
+    bench_report("lookup", &p, n);
+    if(ref != lut){
+        printf("?result mismatch %08x %08x\n", ref, lut);
+        return false;
+    }
+    return true;
+}
+
+static void vicbench_usage(void){
+    printf("Usage: vicbench [options]\n"
+           " -r rounds          Passes over the test data (default 200)\n"
+           " -h                 This help\n");
+}
+
+int main(int argc, char **argv){
+    int opt;
+    while((opt = getopt(argc, argv, "r:h")) != -1){
+        switch(opt){
+            case 'r':
+                bench_rounds = strtoul(optarg, NULL, 0);
+                break;
+            case 'h':
+            default:
+                vicbench_usage();
+                return opt == 'h' ? 0 : 1;
+        }
+    }
+    vic_lut_init();
+    return bench_cell() ? 0 : 1;
+}
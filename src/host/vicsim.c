@@ -0,0 +1,495 @@
+/*
+ * Copyright (c) 2026 Sodiumlightbaby
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+// Host native VIC simulator. Runs the unmodified vic_core1_loop_pal/ntsc
+// against the HAL shim, one F1 cycle per IRQ poll, and dumps the results.
+
+#include "main.h"
+#include "hal.h"
+#include "perf.h"
+#include "vic/cvbs.h"
+#include "vic/cvbs_ntsc.h"
+#include "vic/cvbs_pal.h"
+#include "vic/cvbs_ring.h"
+#include "vic/reg_ring.h"
+#include "vic/vic.h"
+#include "vic/vic_lut.h"
+#include "vic/vic_ntsc.h"
+#include "vic/vic_pal.h"
+#include "sys/cfg.h"
+#include "sys/dvi.h"
+#include "sys/mem.h"
+#include "sys/rev.h"
+#include "hardware/pio.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Defined in vic/vic.c without a public prototype
+void vic_memory_init(void);
+void vic_splash_init(void);
+
+#define VICSIM_MAX_POKES 256
+
+// Screen and colour RAM locations used by the splash page, as in vic/vic.c
+#define VICSIM_ADDR_UNEXPANDED_SCR 0x3E00
+#define VICSIM_ADDR_8KPLUS_EXP_SCR 0x3000
+#define VICSIM_ADDR_COLOUR_RAM     0x1600
+
+typedef struct {
+    uint64_t cycle;
+    uint16_t addr;
+    uint8_t value;
+} vicsim_poke_t;
+
+static uint8_t vicsim_mode = VIC_MODE_PAL;
+static uint8_t vicsim_splash = 0;
+static vicsim_poke_t vicsim_pokes[VICSIM_MAX_POKES];
+static size_t vicsim_poke_count;
+static size_t vicsim_poke_next;
+static uint32_t vicsim_frames;
+static uint32_t vicsim_frames_target = 1;
+static uint16_t vicsim_prev_raster;
+
+// Firmware dependencies of vic.c, answered from the command line
+uint8_t cfg_get_mode(void) { return vicsim_mode; }
+uint8_t cfg_get_splash(void) { return vicsim_splash; }
+uint8_t cfg_get_dvi(void) { return 0; }
+int strnicmp(const char *string1, const char *string2, int n) { return strncasecmp(string1, string2, n); }
+rev_t rev_get(void) { return REV_1_3; }
+void vic_dvi_init_pal(void) {}
+void vic_dvi_init_ntsc(void) {}
+
+// Register/RAM snapshots on top of the splash page, for golden frame runs
+static void vicsim_scene_origin(void){
+    xram[0x1000] += 3;      // Screen origin X three cells right
+    xram[0x1001] -= 6;      // Screen origin Y twelve lines up
+}
+
+static void vicsim_scene_double(void){
+    xram[0x1003] = 0x17;    // 11 rows of double height chars
+}
+
+static void vicsim_scene_multi(void){
+    for(int i = 0; i < 0x200; i++)
+        xram[VICSIM_ADDR_COLOUR_RAM + i] |= 0x08;
+    xram[0x100e] = 0x80;    // Orange auxiliary colour
+}
+
+static void vicsim_scene_reverse(void){
+    xram[0x100f] &= ~0x08;
+}
+
+static void vicsim_scene_exp8k(void){
+    // Same page from the 8K+ expanded screen, colour RAM follows to $1400
+    memcpy((void*)&xram[VICSIM_ADDR_8KPLUS_EXP_SCR], (void*)&xram[VICSIM_ADDR_UNEXPANDED_SCR], 0x200);
+    memcpy((void*)&xram[0x1400], (void*)&xram[VICSIM_ADDR_COLOUR_RAM], 0x200);
+    memset((void*)&xram[VICSIM_ADDR_UNEXPANDED_SCR], 0x20, 0x200);
+    xram[0x1002] &= 0x7F;
+    xram[0x1005] = (xram[0x1005] & 0x0F) | (VICSIM_ADDR_8KPLUS_EXP_SCR >> 6);
+}
+
+static const struct {
+    const char *name;
+    void (*setup)(void);
+} vicsim_scenes[] = {
+    {"splash", NULL},
+    {"origin", vicsim_scene_origin},
+    {"double", vicsim_scene_double},
+    {"multi", vicsim_scene_multi},
+    {"reverse", vicsim_scene_reverse},
+    {"exp8k", vicsim_scene_exp8k},
+};
+#define VICSIM_SCENE_COUNT (sizeof(vicsim_scenes) / sizeof(vicsim_scenes[0]))
+
+static void vicsim_on_cycle(uint64_t cycle){
+    while(vicsim_poke_next < vicsim_poke_count && vicsim_pokes[vicsim_poke_next].cycle <= cycle){
+        hal_xwrite(vicsim_pokes[vicsim_poke_next].addr, vicsim_pokes[vicsim_poke_next].value);
+        vicsim_poke_next++;
+    }
+    reg_ring_task();
+    // Frame boundary is where the raster line published in CR3/CR4 wraps to 0
+    uint16_t raster = (vic_cr4 << 1) | (vic_cr3 >> 7);
+    if(raster == 0 && vicsim_prev_raster != 0){
+        if(++vicsim_frames >= vicsim_frames_target)
+            hal_stop();
+    }
+    vicsim_prev_raster = raster;
+}
+
+static int vicsim_poke_cmp(const void *a, const void *b){
+    const vicsim_poke_t *pa = a, *pb = b;
+    return (pa->cycle > pb->cycle) - (pa->cycle < pb->cycle);
+}
+
+static bool vicsim_load(const char *path, size_t offs, size_t max){
+    FILE *f = fopen(path, "rb");
+    if(!f){
+        fprintf(stderr, "?Error opening %s (%s)\n", path, strerror(errno));
+        return false;
+    }
+    size_t n = fread((void*)&xram[offs], 1, max, f);
+    fclose(f);
+    printf(" Loaded %zu bytes from %s at $%04zx\n", n, path, offs);
+    return true;
+}
+
+// Framebuffer pixel as RGB332, through the palette when packed
+static uint8_t vicsim_fb_pixel(int x, int y){
+    const volatile uint8_t *line = dvi_fb_line(y);
+    if(dvi_fb_packed)
+        return cvbs_rgb332[(line[x >> 1] >> ((x & 1) * 4)) & 0xF];
+    return line[x];
+}
+
+static void vicsim_rgb332(uint8_t c, uint8_t rgb[3]){
+    rgb[0] = ((c >> 5) & 0x7) * 255 / 7;
+    rgb[1] = ((c >> 2) & 0x7) * 255 / 7;
+    rgb[2] = (c & 0x3) * 255 / 3;
+}
+
+static bool vicsim_write_ppm(const char *path){
+    FILE *f = fopen(path, "wb");
+    if(!f){
+        fprintf(stderr, "?Error opening %s (%s)\n", path, strerror(errno));
+        return false;
+    }
+    fprintf(f, "P6\n%u %u\n255\n", dvi_fb_width, dvi_fb_height);
+    for(int y = 0; y < dvi_fb_height; y++){
+        for(int x = 0; x < dvi_fb_width; x++){
+            uint8_t rgb[3];
+            vicsim_rgb332(vicsim_fb_pixel(x, y), rgb);
+            fwrite(rgb, 1, 3, f);
+        }
+    }
+    fclose(f);
+    return true;
+}
+
+static bool vicsim_write_cvbs(const char *path){
+    FILE *f = fopen(path, "wb");
+    if(!f){
+        fprintf(stderr, "?Error opening %s (%s)\n", path, strerror(errno));
+        return false;
+    }
+    for(size_t i = 0; i < hal_sim.cvbs_len; i++){
+        uint32_t w = hal_sim.cvbs_buf[i];
+        uint8_t le[4] = { w, w >> 8, w >> 16, w >> 24 };
+        fwrite(le, 1, 4, f);
+    }
+    fclose(f);
+    return true;
+}
+
+// Read a whole file, or return NULL with *len 0 if it does not exist
+static uint8_t *vicsim_read_file(const char *path, size_t *len){
+    *len = 0;
+    FILE *f = fopen(path, "rb");
+    if(!f)
+        return NULL;
+    fseek(f, 0, SEEK_END);
+    long n = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    uint8_t *buf = malloc(n > 0 ? n : 1);
+    if(buf && fread(buf, 1, n, f) == (size_t)n)
+        *len = n;
+    fclose(f);
+    return buf;
+}
+
+// Compare the framebuffer with a golden PPM. Mismatches are written to diff_path
+// in red over a dimmed copy of the golden frame. Returns the mismatching pixels.
+static long vicsim_compare_ppm(const char *path, const char *diff_path){
+    size_t len;
+    uint8_t *gold = vicsim_read_file(path, &len);
+    char header[32];
+    int hlen = snprintf(header, sizeof(header), "P6\n%u %u\n255\n", dvi_fb_width, dvi_fb_height);
+    if(!gold || len != hlen + dvi_fb_width * dvi_fb_height * 3 || memcmp(gold, header, hlen)){
+        fprintf(stderr, "?invalid golden frame %s\n", path);
+        free(gold);
+        return -1;
+    }
+    const uint8_t *px = gold + hlen;
+    long mismatches = 0;
+    int first_x = 0, first_y = 0;
+    for(int y = 0; y < dvi_fb_height; y++){
+        for(int x = 0; x < dvi_fb_width; x++){
+            uint8_t rgb[3];
+            vicsim_rgb332(vicsim_fb_pixel(x, y), rgb);
+            if(memcmp(rgb, &px[(y * dvi_fb_width + x) * 3], 3) && !mismatches++){
+                first_x = x;
+                first_y = y;
+            }
+        }
+    }
+    if(mismatches){
+        printf(" DVI %ld pixels differ, first at %d,%d\n", mismatches, first_x, first_y);
+        FILE *f = fopen(diff_path, "wb");
+        if(f){
+            fwrite(header, 1, hlen, f);
+            for(int y = 0; y < dvi_fb_height; y++){
+                for(int x = 0; x < dvi_fb_width; x++){
+                    const uint8_t *g = &px[(y * dvi_fb_width + x) * 3];
+                    uint8_t rgb[3];
+                    vicsim_rgb332(vicsim_fb_pixel(x, y), rgb);
+                    if(memcmp(rgb, g, 3)){
+                        rgb[0] = 255;
+                        rgb[1] = rgb[2] = 0;
+                    }else{
+                        rgb[0] = g[0] / 4;
+                        rgb[1] = g[1] / 4;
+                        rgb[2] = g[2] / 4;
+                    }
+                    fwrite(rgb, 1, 3, f);
+                }
+            }
+            fclose(f);
+            printf(" Wrote %s\n", diff_path);
+        }
+    }
+    free(gold);
+    return mismatches;
+}
+
+// Compare the captured CVBS stream with a golden one. Returns the mismatching words.
+static long vicsim_compare_cvbs(const char *path){
+    size_t len;
+    uint8_t *gold = vicsim_read_file(path, &len);
+    if(!gold || len % 4){
+        fprintf(stderr, "?invalid golden CVBS stream %s\n", path);
+        free(gold);
+        return -1;
+    }
+    size_t words = len / 4;
+    size_t n = words < hal_sim.cvbs_len ? words : hal_sim.cvbs_len;
+    long mismatches = 0;
+    size_t first = 0;
+    for(size_t i = 0; i < n; i++){
+        const uint8_t *le = &gold[i * 4];
+        uint32_t w = le[0] | (le[1] << 8) | (le[2] << 16) | ((uint32_t)le[3] << 24);
+        if(w != hal_sim.cvbs_buf[i] && !mismatches++)
+            first = i;
+    }
+    if(words != hal_sim.cvbs_len){
+        if(!mismatches)
+            first = n;
+        mismatches += (words > n ? words : hal_sim.cvbs_len) - n;
+    }
+    if(mismatches)
+        printf(" CVBS %ld words differ (%zu vs %zu golden), first at word %zu\n",
+               mismatches, hal_sim.cvbs_len, words, first);
+    free(gold);
+    return mismatches;
+}
+
+// Record the golden files, or compare against them. A missing golden is an error.
+// Returns 0 for a match or a recording, 2 for a mismatch, 1 for errors.
+static int vicsim_golden(const char *dir, const char *scene, bool record){
+    char ppm[512], cvbs[512], diff[512];
+    const char *mode = vicsim_mode == VIC_MODE_PAL ? "pal" : "ntsc";
+    snprintf(ppm, sizeof(ppm), "%s/%s_%s_%u.ppm", dir, mode, scene, vicsim_frames_target);
+    snprintf(cvbs, sizeof(cvbs), "%s/%s_%s_%u.cvbs", dir, mode, scene, vicsim_frames_target);
+    snprintf(diff, sizeof(diff), "%s/%s_%s_%u.diff.ppm", dir, mode, scene, vicsim_frames_target);
+    if(record){
+        if(!vicsim_write_ppm(ppm) || !vicsim_write_cvbs(cvbs))
+            return 1;
+        fprintf(stderr, "Recorded %s %s\n", mode, scene);
+        return 0;
+    }
+    FILE *f = fopen(ppm, "rb");
+    if(!f){
+        fprintf(stderr, "?no golden %s, record it with -G\n", ppm);
+        return 1;
+    }
+    fclose(f);
+    long dvi_bad = vicsim_compare_ppm(ppm, diff);
+    long cvbs_bad = vicsim_compare_cvbs(cvbs);
+    if(dvi_bad < 0 || cvbs_bad < 0)
+        return 1;
+    if(dvi_bad || cvbs_bad){
+        fprintf(stderr, "?%s %s differs from golden\n", mode, scene);
+        return 2;
+    }
+    remove(diff);
+    return 0;
+}
+
+static void vicsim_usage(void){
+    printf("Usage: vicsim [options]\n"
+           " -m pal|ntsc        Video standard (default pal)\n"
+           " -f frames          Frames to run (default 1)\n"
+           " -s                 Load the splash test page\n"
+           " -t scene           Splash page variant: splash origin double multi reverse exp8k\n"
+           " -x file            Load VIC address space image ($0000-$3FFF)\n"
+           " -r file            Load VIC registers ($1000-$100F)\n"
+           " -p cycle:addr:val  Poke a byte at the start of an F1 cycle\n"
+           " -u val             Value read from unconnected bus (default ff)\n"
+           " -o file.ppm        Write the DVI framebuffer\n"
+           " -4                 Packed 4 bit framebuffer, as the pal16 modelines\n"
+           " -c file            Write the CVBS command stream (32 bit LE words)\n"
+           " -g dir             Compare DVI and CVBS output with golden files in dir\n"
+           " -G dir             Record the golden files into dir, replacing any there\n"
+           " -q                 Only print errors\n");
+}
+
+int main(int argc, char **argv){
+    const char *xram_path = NULL;
+    const char *regs_path = NULL;
+    const char *ppm_path = NULL;
+    const char *cvbs_path = NULL;
+    const char *golden_dir = NULL;
+    bool golden_record = false;
+    int scene = -1;
+    uint8_t uncon = 0xFF;
+    bool quiet = false;
+    bool packed = false;
+    int opt;
+    while((opt = getopt(argc, argv, "m:f:st:x:r:p:u:o:c:g:G:q4h")) != -1){
+        switch(opt){
+            case 'm':
+                if(!strcmp(optarg, "pal"))
+                    vicsim_mode = VIC_MODE_PAL;
+                else if(!strcmp(optarg, "ntsc"))
+                    vicsim_mode = VIC_MODE_NTSC;
+                else{
+                    fprintf(stderr, "?invalid mode %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'f':
+                vicsim_frames_target = strtoul(optarg, NULL, 0);
+                break;
+            case 's':
+                vicsim_splash = 1;
+                if(scene < 0)
+                    scene = 0;
+                break;
+            case 't':
+                for(scene = VICSIM_SCENE_COUNT - 1; scene >= 0; scene--)
+                    if(!strcmp(optarg, vicsim_scenes[scene].name))
+                        break;
+                if(scene < 0){
+                    fprintf(stderr, "?invalid scene %s\n", optarg);
+                    return 1;
+                }
+                vicsim_splash = 1;
+                break;
+            case 'x':
+                xram_path = optarg;
+                break;
+            case 'r':
+                regs_path = optarg;
+                break;
+            case 'p':{
+                unsigned long long cycle;
+                unsigned addr, val;
+                if(vicsim_poke_count >= VICSIM_MAX_POKES ||
+                   sscanf(optarg, "%llu:%x:%x", &cycle, &addr, &val) != 3 || addr > 0x3FFF){
+                    fprintf(stderr, "?invalid poke %s\n", optarg);
+                    return 1;
+                }
+                vicsim_pokes[vicsim_poke_count++] = (vicsim_poke_t){ cycle, addr, val };
+                break;
+            }
+            case 'u':
+                uncon = strtoul(optarg, NULL, 16);
+                break;
+            case 'o':
+                ppm_path = optarg;
+                break;
+            case 'c':
+                cvbs_path = optarg;
+                break;
+            case 'G':
+                golden_record = true;
+                // fall through
+            case 'g':
+                golden_dir = optarg;
+                break;
+            case 'q':
+                quiet = true;
+                break;
+            case '4':
+                packed = true;
+                break;
+            default:
+                vicsim_usage();
+                return opt == 'h' ? 0 : 1;
+        }
+    }
+    if(quiet)
+        freopen("/dev/null", "w", stdout);
+
+    hal_reset();
+    // As dvi_set_modeline and vic_dvi_init_pal/ntsc for a pal16 modeline
+    dvi_fb_packed = packed;
+    dvi_fb_stride = packed ? dvi_fb_width / 2 : dvi_fb_width;
+    cvbs_set_dvi_index(packed);
+    vic_memory_init();
+    vic_lut_init();
+    if(vicsim_splash)
+        vic_splash_init();
+    if(scene > 0)
+        vicsim_scenes[scene].setup();
+    if(xram_path && !vicsim_load(xram_path, 0, 0x4000))
+        return 1;
+    if(regs_path && !vicsim_load(regs_path, 0x1000, 16))
+        return 1;
+    XUNCON_REG = uncon;
+    qsort(vicsim_pokes, vicsim_poke_count, sizeof(vicsim_poke_t), vicsim_poke_cmp);
+
+    cvbs_palette_t palette;
+    if(vicsim_mode == VIC_MODE_PAL)
+        memcpy(&palette, &palette_default_pal, sizeof(palette));
+    else
+        memcpy(&palette, &palette_default_ntsc, sizeof(palette));
+    cvbs_calc_palette(vicsim_mode, &palette);
+    cvbs_ring_init();
+    reg_ring_init();
+
+    if(cvbs_path || golden_dir){
+        // Generous upper bound of command words per frame
+        hal_sim.cvbs_cap = (size_t)(vicsim_frames_target + 1) * 320 * 312;
+        hal_sim.cvbs_buf = malloc(hal_sim.cvbs_cap * sizeof(uint32_t));
+        if(!hal_sim.cvbs_buf){
+            fprintf(stderr, "?out of memory\n");
+            return 1;
+        }
+    }
+    hal_sim.on_cycle = vicsim_on_cycle;
+
+    perf_t perf;
+    perf_start(&perf);
+    uint64_t cycles = hal_run(vicsim_mode == VIC_MODE_PAL ? vic_core1_loop_pal : vic_core1_loop_ntsc, 0);
+    perf_stop(&perf);
+    double ns = perf.ns;
+    uint64_t insns = perf.insns;
+    printf("VIC %s: %u frames, %llu F1 cycles\n", vicsim_mode == VIC_MODE_PAL ? "PAL" : "NTSC",
+           vicsim_frames, (unsigned long long)cycles);
+    printf(" Host %.1f ns/cycle, %.0f frames/s", ns / cycles, vicsim_frames * 1e9 / ns);
+    if(insns)
+        printf(", %.1f instructions/cycle", (double)insns / cycles);
+    printf("\n CVBS %llu words, %.2f per cycle\n", (unsigned long long)hal_sim.cvbs_puts,
+           (double)hal_sim.cvbs_puts / cycles);
+    printf(" CVBS words per cycle:");
+    for(int i = 0; i < HAL_PUTS_HIST_SIZE; i++){
+        if(hal_sim.puts_hist[i])
+            printf(" %d%s:%llu", i, i == HAL_PUTS_HIST_SIZE - 1 ? "+" : "",
+                   (unsigned long long)hal_sim.puts_hist[i]);
+    }
+    printf("\n ");
+    reg_ring_print_status();
+
+    if(ppm_path && !vicsim_write_ppm(ppm_path))
+        return 1;
+    if(cvbs_path && !vicsim_write_cvbs(cvbs_path))
+        return 1;
+    if(golden_dir)
+        return vicsim_golden(golden_dir, scene < 0 ? "custom" : vicsim_scenes[scene].name, golden_record);
+    return 0;
+}
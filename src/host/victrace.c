@@ -0,0 +1,177 @@
+/*
+ * Copyright (c) 2026 Sodiumlightbaby
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+// Decoder for the PIVIC TRACE STREAM bus trace, see vic/trace.h for the
+// format. Prints one line per record with the raster position of the access.
+
+#include "vic/trace.h"
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+// Raster timing per video standard, as in vic_pal.c and vic_ntsc.c
+typedef struct {
+    const char *name;
+    unsigned cycles_per_line;
+    unsigned mark_hc;       // HC when the VIC loop resets VC and marks the frame
+    unsigned vc_inc_hc;     // HC when VC increments
+} victrace_timing_t;
+
+static const victrace_timing_t victrace_timings[2] = {
+    {"NTSC", 65, 62, 29},
+    {"PAL",  71,  1,  1},
+};
+
+static const char *const victrace_reg_names[16] = {
+    "origin x", "origin y", "columns", "rows", "raster", "memory", "pen x", "pen y",
+    "paddle x", "paddle y", "voice 1", "voice 2", "voice 3", "noise", "aux/volume", "colours"};
+
+static bool victrace_varint(FILE *f, uint64_t *value){
+    *value = 0;
+    for(int shift = 0; shift < 64; shift += 7){
+        int ch = fgetc(f);
+        if(ch == EOF)
+            return false;
+        *value |= (uint64_t)(ch & 0x7F) << shift;
+        if(!(ch & 0x80))
+            return true;
+    }
+    return false;
+}
+
+// The stream follows the echoed TRACE STREAM command on the console
+static int victrace_sync(FILE *f){
+    static const char magic[4] = {'P', 'V', 'T', 'R'};
+    int matched = 0;
+    int ch;
+    while(matched < 4 && (ch = fgetc(f)) != EOF){
+        if(ch == magic[matched])
+            matched++;
+        else
+            matched = (ch == magic[0]);
+    }
+    int version = fgetc(f);
+    int mode = fgetc(f);
+    if(matched < 4 || version == EOF || mode == EOF){
+        fprintf(stderr, "?no trace stream header\n");
+        return -1;
+    }
+    if(version != TRACE_STREAM_VERSION || mode > 1){
+        fprintf(stderr, "?unsupported trace stream version %d mode %d\n", version, mode);
+        return -1;
+    }
+    return mode;
+}
+
+static void victrace_usage(void){
+    printf("Usage: victrace [options] [file]\n"
+           " -c            Print cycle numbers\n"
+           " -h            This help\n"
+           "Reads the binary output of the TRACE STREAM monitor command from file or stdin.\n");
+}
+
+int main(int argc, char **argv){
+    bool cycles = false;
+    int opt;
+    while((opt = getopt(argc, argv, "ch")) != -1){
+        switch(opt){
+            case 'c':
+                cycles = true;
+                break;
+            default:
+                victrace_usage();
+                return opt == 'h' ? 0 : 1;
+        }
+    }
+    FILE *f = stdin;
+    if(optind < argc){
+        f = fopen(argv[optind], "rb");
+        if(!f){
+            fprintf(stderr, "?Error opening %s (%s)\n", argv[optind], strerror(errno));
+            return 1;
+        }
+    }
+    int mode = victrace_sync(f);
+    if(mode < 0)
+        return 1;
+    const victrace_timing_t *t = &victrace_timings[mode];
+    unsigned vc_offset = (t->mark_hc + t->cycles_per_line - t->vc_inc_hc) % t->cycles_per_line;
+    printf("%s trace\n", t->name);
+
+    uint64_t cycle = 0;
+    uint64_t frame_cycle = 0;
+    unsigned frame = 0;
+    bool framed = false;
+    bool raster = false;
+    uint16_t addr = 0;
+    uint64_t tag, value;
+    while(victrace_varint(f, &tag)){
+        cycle += tag >> 3;
+        uint8_t kind = tag & 7;
+        char pos[40] = "";
+        int n = 0;
+        if(cycles)
+            n = snprintf(pos, sizeof(pos), "%10llu ", (unsigned long long)cycle);
+        if(raster){
+            uint64_t c = cycle - frame_cycle;
+            snprintf(&pos[n], sizeof(pos) - n, "%4u %3u %2u", frame,
+                     (unsigned)((c + vc_offset) / t->cycles_per_line),
+                     (unsigned)((c + t->mark_hc) % t->cycles_per_line));
+        } else {
+            snprintf(&pos[n], sizeof(pos) - n, "   -   -  -");
+        }
+        switch(kind){
+            case TRACE_REC_READ:
+            case TRACE_REC_WRITE:{
+                if(!victrace_varint(f, &value))
+                    goto truncated;
+                int data = fgetc(f);
+                if(data == EOF)
+                    goto truncated;
+                int16_t delta = (int16_t)((value >> 1) ^ -(value & 1));
+                addr = (addr + delta) & 0x3FFF;
+                printf("%s %c $%04X $%02X", pos, kind == TRACE_REC_READ ? 'R' : 'W', addr, data);
+                if((addr & 0x3F00) == 0x1000)
+                    printf(" CR%X %s", addr & 0xF, victrace_reg_names[addr & 0xF]);
+                else if((addr & 0x3C00) == 0x1400)
+                    printf(" colour");
+                printf("\n");
+                break;
+            }
+            case TRACE_REC_FRAME:
+                if(framed)
+                    frame++;
+                framed = true;
+                frame_cycle = cycle;
+                raster = true;
+                break;
+            case TRACE_REC_LOST:
+                if(!victrace_varint(f, &value))
+                    goto truncated;
+                if(value){
+                    printf("%s lost %llu cycles\n", pos, (unsigned long long)value);
+                    cycle += value;
+                } else {
+                    printf("%s lost cycles\n", pos);
+                    raster = false;
+                }
+                break;
+            case TRACE_REC_END:
+                printf("%s end\n", pos);
+                return 0;
+            default:
+                fprintf(stderr, "?invalid record kind %d\n", kind);
+                return 1;
+        }
+    }
+    return 0;
+truncated:
+    fprintf(stderr, "?truncated record\n");
+    return 1;
+}
@@ -0,0 +1,337 @@
+/*
+ * Copyright (c) 2026 Sodiumlightbaby
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+// VIC voice and noise stepping regression check. Runs aud_tick_inline and the
+// aud_task update path (vic/aud_voice.c) as built for the host and compares
+// the voice levels against golden hashes, so bit level changes to the
+// counters, shift registers or LFSR show up. Checks the batched noise
+// stepping against single steps, then times the update path.
+
+#include "perf.h"
+#include "vic/aud.h"
+#include "vic/aud_voice.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define VICVOICE_CYCLES (1u << 20)      // CPU cycles per golden case
+#define VICVOICE_NOISE_STEPS (1u << 20) // Noise counter overflows in the noise golden
+#define VICVOICE_LFSR_PERIOD 65535      // Maximal length, taps 15, 14, 12, 3
+#define VICVOICE_BATCHES (1u << 16)     // Random batches in the batched noise check
+
+// aud_tick_inline state and event ring, normally in aud.c
+volatile aud_union_t aud_counters;
+volatile aud_union_t aud_ticks;
+volatile aud_union_t aud_regs;
+volatile aud_union_t aud_sr;
+volatile uint32_t aud_noise_count;
+volatile uint32_t aud_cycle;
+aud_event_t aud_ev_ring[AUD_EV_RING_LEN];
+volatile uint32_t aud_ev_head;
+volatile uint32_t aud_ev_tail;
+volatile uint32_t aud_ev_lost;
+
+// Voice registers CRA-CRD, flipped by toggle every 4096 cycles
+typedef struct {
+    uint8_t regs[4];
+    uint8_t toggle[4];
+    uint32_t hash;
+} vicvoice_case_t;
+
+static const vicvoice_case_t vicvoice_cases[] = {
+    {{0x80, 0x80, 0x80, 0x80}, {0x00, 0x00, 0x00, 0x00}, 0xb9ca1d55},
+    {{0xFE, 0xF0, 0xC3, 0xFF}, {0x00, 0x00, 0x00, 0x00}, 0xd098f8a5},
+    {{0x00, 0x00, 0x00, 0x00}, {0x00, 0x00, 0x00, 0x00}, 0xb25c9dc5},
+    {{0x9A, 0x00, 0xE1, 0xFE}, {0x00, 0x00, 0x00, 0x00}, 0x956c64a6},
+    {{0xFF, 0xA5, 0x3C, 0xF7}, {0x80, 0x0F, 0x80, 0x80}, 0x5cf37160},
+};
+
+// Noise shift register after each of the first 32 clocks, aud_step_noise($FF) from reset
+static const uint8_t vicvoice_noise_sr[32] = {
+    0x01, 0x03, 0x07, 0x0f, 0x1f, 0x3f, 0x7f, 0xff, 0xfe, 0xfc, 0xf8, 0xf0, 0xe0, 0xc0, 0x80, 0x00,
+    0x01, 0x03, 0x07, 0x0f, 0x1f, 0x3f, 0x7f, 0xff, 0xfe, 0xfc, 0xf8, 0xf0, 0xe0, 0xc0, 0x80, 0x00,
+};
+// Noise SR clocks and level hash over VICVOICE_NOISE_STEPS steps
+static const uint32_t vicvoice_noise_clocks = 262147;
+static const uint32_t vicvoice_noise_hash = 0x78fcb2f9;
+
+static bool vicvoice_print;
+static uint32_t vicvoice_noise_done;    // aud_noise_count as last stepped
+
+static inline uint32_t vicvoice_fnv(uint32_t hash, uint8_t byte){
+    return (hash ^ byte) * 16777619u;
+}
+
+static void vicvoice_reset(void){
+    aud_counters.all = aud_ticks.all = aud_regs.all = 0;
+    aud_noise_count = vicvoice_noise_done = 0;
+    aud_ev_head = aud_ev_tail = aud_ev_lost = 0;
+    aud_voice_reset();
+}
+
+// One CPU cycle of core1, then aud_task as if it ran every cycle
+static inline void vicvoice_cycle(uint8_t *regs){
+    aud_tick_inline((uint32_t *)regs);
+    aud_ev_tail = aud_ev_head;
+    aud_calc_voice(0, aud_regs.ch[0]);
+    aud_calc_voice(1, aud_regs.ch[1]);
+    aud_calc_voice(2, aud_regs.ch[2]);
+    uint32_t steps = aud_noise_count - vicvoice_noise_done;
+    vicvoice_noise_done = aud_noise_count;
+    aud_step_noise_n(steps, aud_regs.ch[3]);
+}
+
+static uint32_t vicvoice_run(const vicvoice_case_t *c, uint32_t cycles){
+    uint8_t regs[4];
+    memcpy(regs, c->regs, sizeof(regs));
+    vicvoice_reset();
+    uint32_t hash = 2166136261u;
+    for(uint32_t i = 1; i <= cycles; i++){
+        vicvoice_cycle(regs);
+        for(int v = 0; v < 4; v++)
+            hash = vicvoice_fnv(hash, aud_val[v]);
+        if(!(i & 4095))
+            for(int v = 0; v < 4; v++)
+                regs[v] ^= c->toggle[v];
+    }
+    return hash;
+}
+
+static bool vicvoice_check_lfsr(void){
+    bool ok = true;
+    vicvoice_reset();
+    uint32_t period = 0;
+    do{
+        aud_step_noise(0xFF);
+        period++;
+    }while(aud_lfsr != 0xFFFF && period <= 0x10000);
+    printf("LFSR period %u", period);
+    if(period != VICVOICE_LFSR_PERIOD){
+        printf(" ?expected %u", VICVOICE_LFSR_PERIOD);
+        ok = false;
+    }
+    printf("\n");
+
+    // Disabled, the LFSR fills with ones and the shift register holds
+    vicvoice_reset();
+    for(int i = 0; i < 100; i++)
+        aud_step_noise(0xFF);
+    uint8_t sr = aud_noise_sr;
+    for(int i = 0; i < 32; i++)
+        aud_step_noise(0x7F);
+    printf("LFSR disabled %04X, shift register %02X", aud_lfsr, aud_noise_sr);
+    if(aud_lfsr != 0xFFFF || aud_noise_sr != sr){
+        printf(" ?expected FFFF, %02X", sr);
+        ok = false;
+    }
+    printf("\n");
+    return ok;
+}
+
+static bool vicvoice_check_noise(void){
+    vicvoice_reset();
+    uint8_t first[32];
+    uint32_t clocks = 0;
+    uint32_t hash = 2166136261u;
+    for(uint32_t i = 0; i < VICVOICE_NOISE_STEPS; i++){
+        uint16_t lfsr = aud_lfsr;
+        aud_step_noise(0xFF);
+        // The LFSR rising edge clocks the shift register
+        if(!(lfsr & 1) && (aud_lfsr & 1)){
+            if(clocks < sizeof(first))
+                first[clocks] = aud_noise_sr;
+            clocks++;
+        }
+        hash = vicvoice_fnv(hash, aud_val[3]);
+    }
+    if(vicvoice_print){
+        printf("noise sr");
+        for(size_t i = 0; i < sizeof(first); i++)
+            printf(" 0x%02x,", first[i]);
+        printf("\nnoise clocks %u hash 0x%08x\n", clocks, hash);
+    }
+    bool ok = !memcmp(first, vicvoice_noise_sr, sizeof(first)) &&
+              clocks == vicvoice_noise_clocks && hash == vicvoice_noise_hash;
+    printf("Noise %u steps, %u shift register clocks, hash %08x%s\n",
+           VICVOICE_NOISE_STEPS, clocks, hash, ok ? "" : " ?mismatch");
+    return ok;
+}
+
+static bool vicvoice_check_cases(void){
+    bool ok = true;
+    printf("Voices, %u CPU cycles per case\n", VICVOICE_CYCLES);
+    printf(" CRA CRB CRC CRD  toggle        hash\n");
+    for(size_t i = 0; i < sizeof(vicvoice_cases) / sizeof(vicvoice_cases[0]); i++){
+        const vicvoice_case_t *c = &vicvoice_cases[i];
+        uint32_t hash = vicvoice_run(c, VICVOICE_CYCLES);
+        printf("  %02X  %02X  %02X  %02X  %02X%02X%02X%02X  %08x", c->regs[0], c->regs[1], c->regs[2], c->regs[3],
+               c->toggle[0], c->toggle[1], c->toggle[2], c->toggle[3], hash);
+        if(hash != c->hash){
+            printf(" ?expected %08x", c->hash);
+            ok = false;
+        }
+        printf("\n");
+    }
+    return ok;
+}
+
+typedef struct {
+    uint16_t lfsr;
+    uint8_t sr;
+    uint8_t val;
+} vicvoice_noise_t;
+
+static void vicvoice_noise_get(vicvoice_noise_t *n){
+    n->lfsr = aud_lfsr;
+    n->sr = aud_noise_sr;
+    n->val = aud_val[3];
+}
+
+static void vicvoice_noise_set(const vicvoice_noise_t *n){
+    aud_lfsr = n->lfsr;
+    aud_noise_sr = n->sr;
+    aud_val[3] = n->val;
+}
+
+// aud_step_noise_n against as many aud_step_noise calls, for random batch
+// sizes up to a few LFSR periods and the enable bit mostly on
+static bool vicvoice_check_batch(void){
+    vicvoice_reset();
+    srand(1);
+    uint64_t total = 0;
+    for(uint32_t i = 0; i < VICVOICE_BATCHES; i++){
+        uint32_t steps = rand() & 0x3FF;
+        if(!(i & 255))
+            steps = rand() & 0x3FFFF;
+        uint8_t reg = rand() | ((rand() & 7) ? 0x80 : 0);
+        vicvoice_noise_t start, ref, batch;
+        vicvoice_noise_get(&start);
+        for(uint32_t s = 0; s < steps; s++)
+            aud_step_noise(reg);
+        vicvoice_noise_get(&ref);
+        vicvoice_noise_set(&start);
+        aud_step_noise_n(steps, reg);
+        vicvoice_noise_get(&batch);
+        total += steps;
+        if(memcmp(&ref, &batch, sizeof(ref))){
+            printf("?batch %u of %u steps reg %02X from %04X %02X: %04X %02X %d, expected %04X %02X %d\n",
+                   i, steps, reg, start.lfsr, start.sr, batch.lfsr, batch.sr, batch.val,
+                   ref.lfsr, ref.sr, ref.val);
+            return false;
+        }
+    }
+    printf("Batched noise, %u batches of %llu steps match single steps\n",
+           VICVOICE_BATCHES, (unsigned long long)total);
+    return true;
+}
+
+static void vicvoice_bench(uint32_t rounds){
+    static const uint8_t regs[4] = {0xD5, 0xEA, 0xF3, 0xFE};
+    uint64_t n = (uint64_t)VICVOICE_CYCLES * rounds;
+    printf("Update cost, 4 voices, %llu CPU cycles\n", (unsigned long long)n);
+
+    // aud_task work per CPU cycle, with core1's aud_tick_inline kept out of the timing.
+    // Words as the old FIFO ones, registers with the noise overflow in bit 3.
+    uint32_t *words = malloc(VICVOICE_CYCLES * sizeof(uint32_t));
+    uint32_t *sr = malloc(VICVOICE_CYCLES * sizeof(uint32_t));
+    uint8_t r[4];
+    memcpy(r, regs, sizeof(r));
+    vicvoice_reset();
+    for(uint32_t i = 0; i < VICVOICE_CYCLES; i++){
+        uint32_t noise_count = aud_noise_count;
+        aud_tick_inline((uint32_t *)r);
+        aud_ev_tail = aud_ev_head;
+        words[i] = (aud_regs.all & 0xFFFFFFF0) | ((aud_noise_count != noise_count) << 3);
+        sr[i] = aud_sr.all;
+    }
+    perf_t p;
+    uint32_t acc = 0;
+    perf_start(&p);
+    for(uint32_t k = 0; k < rounds; k++){
+        for(uint32_t i = 0; i < VICVOICE_CYCLES; i++){
+            uint32_t upd = words[i];
+            aud_sr.all = sr[i];
+            aud_calc_voice(0, upd);
+            aud_calc_voice(1, upd >> 8);
+            aud_calc_voice(2, upd >> 16);
+            if(upd & 0x08)
+                aud_step_noise(upd >> 24);
+            acc += aud_val[0] + aud_val[1] + aud_val[2] + aud_val[3];
+        }
+    }
+    perf_stop(&p);
+    printf(" %-8s %6.2f ns/cycle", "update", p.ns / n);
+    if(p.insns)
+        printf(" %6.2f instructions/cycle", (double)p.insns / n);
+    printf(" (%u)\n", acc & 1);
+
+    // Noise LFSR alone, one call per noise counter overflow
+    perf_start(&p);
+    for(uint64_t i = 0; i < n; i++){
+        aud_step_noise(0xFE);
+        acc += aud_val[3];
+    }
+    perf_stop(&p);
+    printf(" %-8s %6.2f ns/step", "noise", p.ns / n);
+    if(p.insns)
+        printf(" %6.2f instructions/step", (double)p.insns / n);
+    printf(" (%u)\n", acc & 1);
+
+    // Batched, as aud_task after a gap of that many noise overflows
+    static const uint32_t batches[] = {1, 4, 16, 256, 4096};
+    for(size_t b = 0; b < sizeof(batches) / sizeof(batches[0]); b++){
+        uint32_t size = batches[b];
+        uint64_t calls = n / size;
+        perf_start(&p);
+        for(uint64_t i = 0; i < calls; i++){
+            aud_step_noise_n(size, 0xFE);
+            acc += aud_val[3];
+        }
+        perf_stop(&p);
+        char name[16];
+        snprintf(name, sizeof(name), "batch %u", size);
+        printf(" %-10s %6.2f ns/step", name, p.ns / (calls * size));
+        if(p.insns)
+            printf(" %6.2f instructions/step", (double)p.insns / (calls * size));
+        printf(" (%u)\n", acc & 1);
+    }
+    free(words);
+    free(sr);
+}
+
+static void vicvoice_usage(void){
+    printf("Usage: vicvoice [options]\n"
+           " -r rounds          Benchmark passes, 0 to skip (default 20)\n"
+           " -p                 Print the values the golden data is made from\n"
+           " -h                 This help\n");
+}
+
+int main(int argc, char **argv){
+    uint32_t rounds = 20;
+    int opt;
+    while((opt = getopt(argc, argv, "r:ph")) != -1){
+        switch(opt){
+            case 'r':
+                rounds = strtoul(optarg, NULL, 0);
+                break;
+            case 'p':
+                vicvoice_print = true;
+                break;
+            case 'h':
+            default:
+                vicvoice_usage();
+                return opt == 'h' ? 0 : 1;
+        }
+    }
+    bool ok = vicvoice_check_lfsr();
+    ok &= vicvoice_check_noise();
+    ok &= vicvoice_check_cases();
+    ok &= vicvoice_check_batch();
+    if(rounds)
+        vicvoice_bench(rounds);
+    return ok ? 0 : 1;
+}